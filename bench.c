@@ -0,0 +1,348 @@
+/* C Data Structures Benchmark - public domain - Bernhard Schelling 2020
+   https://github.com/schellingb/c-data-structures
+         no warranty implied; use at your own risk
+
+   This is some benchmark code for this project.
+   It times the hot paths of TinyBuf and TinyHashMap/TinyHashMap64 at
+   growing sizes with uniform random, sequential and adversarial keys
+   and the string key hash functions at a few key lengths.
+   Reported are nanoseconds per operation, the probe length percentiles
+   (distance of each key from its home slot), the slowest single insert
+   and the peak memory usage.
+
+   Build with optimizations and run with the maximum number of entries
+   and optionally the maximum load factor of the hash maps and 1 to
+   enable incremental growing:
+     cc -O2 bench.c -o bench
+     ./bench 100000000 0.875 1
+
+   The default maximum is 1000000 (1M) entries. Adversarial keys all share
+   the same low bits which degrades linear probing into quadratic runtime
+   without the seeded key mixing of the maps, so that pattern is limited to
+   BENCH_ADVERSARIAL_MAX entries.
+
+   PUBLIC DOMAIN (UNLICENSE)
+
+   This is free and unencumbered software released into the public domain.
+
+   Anyone is free to copy, modify, publish, use, compile, sell, or
+   distribute this software, either in source code form or as a compiled
+   binary, for any purpose, commercial or non-commercial, and by any
+   means.
+
+   In jurisdictions that recognize copyright laws, the author or authors
+   of this software dedicate any and all copyright interest in the
+   software to the public domain. We make this dedication for the benefit
+   of the public at large and to the detriment of our heirs and
+   successors. We intend this dedication to be an overt act of
+   relinquishment in perpetuity of all present and future rights to this
+   software under copyright law.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+   OTHER DEALINGS IN THE SOFTWARE.
+
+   For more information, please refer to <http://unlicense.org/>
+*/
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include "tinybuf.h"
+#include "tinyhashmap.h"
+#include "tinyhashmap64.h"
+
+#include <stdio.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <time.h>
+#include <sys/resource.h>
+#endif
+
+#ifndef BENCH_ADVERSARIAL_MAX
+#define BENCH_ADVERSARIAL_MAX 10000
+#endif
+#ifndef BENCH_BATCH
+#define BENCH_BATCH 256
+#endif
+
+enum { PATTERN_UNIFORM, PATTERN_SEQUENTIAL, PATTERN_ADVERSARIAL, PATTERN_COUNT };
+static const char* pattern_names[PATTERN_COUNT] = { "uniform", "sequential", "adversarial" };
+
+typedef struct { int a, b, c; } mytype_t;
+
+static volatile size_t bench_sink;
+static double bench_loadfactor = 0.5;
+static int bench_incremental = 0;
+
+static double bench_now()
+{
+	#ifdef _WIN32
+	LARGE_INTEGER freq, now;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&now);
+	return (double)now.QuadPart / (double)freq.QuadPart;
+	#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+	#endif
+}
+
+static double bench_peak_rss_mb()
+{
+	#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS pmc;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return 0;
+	return (double)pmc.PeakWorkingSetSize / (1024.0 * 1024.0);
+	#else
+	struct rusage ru;
+	if (getrusage(RUSAGE_SELF, &ru)) return 0;
+	#ifdef __APPLE__
+	return (double)ru.ru_maxrss / (1024.0 * 1024.0); /* bytes */
+	#else
+	return (double)ru.ru_maxrss / 1024.0; /* kilobytes */
+	#endif
+	#endif
+}
+
+static uint64_t bench_rand(uint64_t* state)
+{
+	/* splitmix64 */
+	uint64_t z = (*state += (uint64_t)0x9E3779B97F4A7C15);
+	z = (z ^ (z >> 30)) * (uint64_t)0xBF58476D1CE4E5B9;
+	z = (z ^ (z >> 27)) * (uint64_t)0x94D049BB133111EB;
+	return z ^ (z >> 31);
+}
+
+/* Returns n distinct non-zero keys, followed by n keys for miss lookups and then the first n keys shuffled */
+static uint64_t* bench_make_keys(size_t n, int pattern, int bits64)
+{
+	uint64_t *keys = NULL, seed = 1234567, mask = (bits64 ? ~(uint64_t)0 : (uint64_t)0xFFFFFFFF);
+	size_t i;
+	BUF_FIT(keys, n * 3);
+	BUF_RESIZE(keys, n * 2);
+	for (i = 0; i != n * 2; i++)
+	{
+		switch (pattern)
+		{
+			case PATTERN_UNIFORM:
+				/* even keys are stored, odd keys are guaranteed misses */
+				do { keys[i] = (bench_rand(&seed) & mask & ~(uint64_t)1) | (i >= n); } while (keys[i] <= 1);
+				break;
+			case PATTERN_SEQUENTIAL:
+				keys[i] = (uint64_t)i + 1;
+				break;
+			default: /* all keys share the same low 16 bits */
+				keys[i] = (((uint64_t)i + 1) << (bits64 ? 32 : 16)) | 0x5A5A;
+				break;
+		}
+	}
+	if (pattern == PATTERN_UNIFORM)
+	{
+		/* re-roll duplicates among the stored keys */
+		char* seen = NULL;
+		for (i = 0; i != n; i++)
+		{
+			while (HMAP64_HAS(seen, keys[i]))
+				do { keys[i] = (bench_rand(&seed) & mask & ~(uint64_t)1); } while (keys[i] <= 1);
+			HMAP64_SET(seen, keys[i], 1);
+		}
+		HMAP64_FREE(seen);
+	}
+	/* append a shuffled copy of the stored keys as the deletion order */
+	memcpy(BUF_ADD(keys, n), keys, n * sizeof(uint64_t)); /* fits without realloc */
+	for (i = n - 1; i; i--)
+	{
+		size_t j = (size_t)(bench_rand(&seed) % (i + 1));
+		uint64_t tmp = keys[n * 2 + i];
+		keys[n * 2 + i] = keys[n * 2 + j];
+		keys[n * 2 + j] = tmp;
+	}
+	return keys;
+}
+
+/* Distance of every key from its home slot */
+static void bench_print_probes(size_t* dist_hist, size_t hist_len, size_t count)
+{
+	static const double pcts[] = { 0.50, 0.90, 0.99, 0.999 };
+	size_t i, j = 0, sum = 0, maxd = 0;
+	printf("  probe");
+	for (i = 0; i != hist_len; i++) if (dist_hist[i]) maxd = i;
+	for (i = 0; i != sizeof(pcts)/sizeof(pcts[0]); i++)
+	{
+		while (j < hist_len && (double)(sum + dist_hist[j]) < pcts[i] * (double)count) sum += dist_hist[j++];
+		printf(" p%g %lu", pcts[i] * 100, (unsigned long)j);
+	}
+	printf(" max %lu", (unsigned long)maxd);
+}
+
+#define BENCH_PROBES(map, LEN, CAP, MAX, KEY, HOME) do { \
+	size_t *hist = NULL, i, cap = CAP(map); \
+	BUF_ADDZEROED(hist, cap); \
+	for (i = 0; i != cap; i++) \
+		if (KEY(map, i)) \
+			hist[(i - HOME(map, KEY(map, i))) & MAX(map)]++; \
+	bench_print_probes(hist, cap, LEN(map)); \
+	BUF_FREE(hist); \
+} while (0)
+
+#define BENCH_NS(t0, ops) ((bench_now() - (t0)) * 1e9 / (double)((ops) ? (ops) : 1))
+
+static void bench_buf(size_t n)
+{
+	mytype_t *buf = NULL, elem = { 1, 2, 3 };
+	size_t i, inserts = ((size_t)1 << 26) / n;
+	uint64_t seed = 7654321;
+	double t0, ns_push, ns_add, ns_insert;
+
+	t0 = bench_now();
+	for (i = 0; i != n; i++) { elem.a = (int)i; BUF_PUSH(buf, elem); }
+	ns_push = BENCH_NS(t0, n);
+	bench_sink += (size_t)buf[n / 2].a;
+	BUF_FREE(buf);
+
+	t0 = bench_now();
+	for (i = 0; i < n; i += 64) BUF_ADD(buf, 64)[0] = elem;
+	ns_add = BENCH_NS(t0, (n + 63) / 64);
+	bench_sink += (size_t)buf[0].a;
+
+	if (inserts > 1000) inserts = 1000;
+	if (inserts < 1) inserts = 1;
+	t0 = bench_now();
+	for (i = 0; i != inserts; i++)
+	{
+		size_t pos = (size_t)(bench_rand(&seed) % BUF_LEN(buf));
+		BUF_INSERT(buf, pos, elem);
+	}
+	ns_insert = BENCH_NS(t0, inserts);
+	BUF_FREE(buf);
+
+	printf("buf    %-11s %10lu  push %8.2f  add64 %8.2f  insert %12.2f ns/op  rss %.1f MB\n",
+		"-", (unsigned long)n, ns_push, ns_add, ns_insert, bench_peak_rss_mb());
+}
+
+#define BENCH_HMAP(label, key_type, PFX, n, pattern) do { \
+	uint32_t *map = NULL; \
+	uint64_t *keys = bench_make_keys(n, pattern, sizeof(key_type) > 4); \
+	key_type *batch_keys = (key_type *)malloc(n * sizeof(key_type)); \
+	ptrdiff_t batch_idx[BENCH_BATCH]; \
+	size_t i, j, hits = 0; \
+	uint32_t *frozen = NULL; \
+	double t0, t1, ns_set, ns_get, ns_batch, ns_frozen, ns_miss, ns_grow, ns_del, us_setmax = 0; \
+	PFX##_SETLOADFACTOR(map, bench_loadfactor); \
+	PFX##_SETINCREMENTAL(map, bench_incremental); \
+	for (i = 0; i != n; i++) batch_keys[i] = (key_type)keys[i]; \
+	t0 = bench_now(); \
+	for (i = 0; i != n; i++) PFX##_SET(map, (key_type)keys[i], (uint32_t)i); \
+	ns_set = BENCH_NS(t0, n); \
+	t0 = bench_now(); \
+	for (i = 0; i != n; i++) hits += PFX##_GET(map, (key_type)keys[i]); \
+	ns_get = BENCH_NS(t0, n); \
+	t0 = bench_now(); \
+	for (i = 0; i < n; i += BENCH_BATCH) \
+	{ \
+		size_t batch_n = (n - i < BENCH_BATCH ? n - i : BENCH_BATCH); \
+		PFX##_GET_BATCH(map, batch_keys + i, batch_n, batch_idx); \
+		for (j = 0; j != batch_n; j++) hits += map[batch_idx[j]]; \
+	} \
+	ns_batch = BENCH_NS(t0, n); \
+	PFX##_FREEZE(frozen, map); \
+	t0 = bench_now(); \
+	for (i = 0; i != n; i++) hits += PFX##F_GET(frozen, (key_type)keys[i]); \
+	ns_frozen = BENCH_NS(t0, n); \
+	PFX##F_FREE(frozen); \
+	t0 = bench_now(); \
+	for (i = n; i != n * 2; i++) hits += (size_t)PFX##_HAS(map, (key_type)keys[i]); \
+	ns_miss = BENCH_NS(t0, n); \
+	printf("%-6s %-11s %10lu  set %8.2f  get %8.2f  batch %8.2f  frozen %8.2f  miss %8.2f", label, pattern_names[pattern], (unsigned long)n, ns_set, ns_get, ns_batch, ns_frozen, ns_miss); \
+	BENCH_PROBES(map, PFX##_LEN, PFX##_CAP, PFX##_MAX, PFX##_KEY, PFX##_HOME); \
+	t0 = bench_now(); \
+	PFX##_FIT(map, PFX##_CAP(map)); \
+	ns_grow = BENCH_NS(t0, n); \
+	t0 = bench_now(); \
+	for (i = n * 2; i != n * 3; i++) hits += (size_t)PFX##_DEL(map, (key_type)keys[i]); \
+	ns_del = BENCH_NS(t0, n); \
+	PFX##_FREE(map); \
+	PFX##_SETLOADFACTOR(map, bench_loadfactor); \
+	PFX##_SETINCREMENTAL(map, bench_incremental); \
+	for (i = 0, t0 = bench_now(); i != n; i++, t0 = t1) \
+	{ \
+		PFX##_SET(map, (key_type)keys[i], (uint32_t)i); \
+		if ((t1 = bench_now()) - t0 > us_setmax) us_setmax = t1 - t0; \
+	} \
+	us_setmax *= 1e6; \
+	printf("  grow %6.2f  del %8.2f ns/op  setmax %8.1f us  rss %.1f MB\n", ns_grow, ns_del, us_setmax, bench_peak_rss_mb()); \
+	bench_sink += hits + PFX##_LEN(map); \
+	PFX##_FREE(map); \
+	BUF_FREE(keys); \
+	free(batch_keys); \
+} while (0)
+
+static void bench_hmap(size_t n, int pattern)
+{
+	BENCH_HMAP("hmap", uint32_t, HMAP, n, pattern);
+}
+
+static void bench_hmap64(size_t n, int pattern)
+{
+	BENCH_HMAP("hmap64", uint64_t, HMAP64, n, pattern);
+}
+
+static void bench_hash(void)
+{
+	static const size_t lens[] = { 8, 32, 200 };
+	static char keys[16][201];
+	size_t i, j, l, iters;
+	uint64_t seed = 13579;
+	double t0, ns_fnv, ns_bytes, ns_bytes64;
+	for (i = 0; i != 16 * 201; i++) keys[i / 201][i % 201] = (char)('a' + bench_rand(&seed) % 26);
+	for (l = 0; l != sizeof(lens) / sizeof(*lens); l++)
+	{
+		iters = ((size_t)1 << 24) / lens[l];
+		for (i = 0; i != 16; i++) keys[i][lens[l]] = '\0';
+		t0 = bench_now();
+		for (j = 0; j != iters; j++) bench_sink += hash_string(keys[j & 15]);
+		ns_fnv = BENCH_NS(t0, iters);
+		t0 = bench_now();
+		for (j = 0; j != iters; j++) bench_sink += hash_bytes(keys[j & 15], lens[l]);
+		ns_bytes = BENCH_NS(t0, iters);
+		t0 = bench_now();
+		for (j = 0; j != iters; j++) bench_sink += (size_t)hash64_bytes(keys[j & 15], lens[l]);
+		ns_bytes64 = BENCH_NS(t0, iters);
+		for (i = 0; i != 16; i++) keys[i][lens[l]] = 'a';
+		printf("hash   len %-7lu %10s  fnv1a %7.2f  bytes %7.2f  bytes64 %7.2f ns/op\n", (unsigned long)lens[l], "-", ns_fnv, ns_bytes, ns_bytes64);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	size_t n, max_n = (argc > 1 ? (size_t)strtod(argv[1], NULL) : (size_t)1000000);
+	int pattern;
+	if (argc > 2) bench_loadfactor = strtod(argv[2], NULL);
+	if (argc > 3) bench_incremental = atoi(argv[3]);
+	printf("Benchmarking up to %lu entries with load factor %g%s (grow is per existing entry)...\n", (unsigned long)max_n, bench_loadfactor, (bench_incremental ? " and incremental growing" : ""));
+	bench_hash();
+	for (n = 1000; n <= max_n; n *= 10)
+	{
+		bench_buf(n);
+		for (pattern = 0; pattern != PATTERN_COUNT; pattern++)
+		{
+			if (pattern == PATTERN_ADVERSARIAL && n > BENCH_ADVERSARIAL_MAX) continue;
+			bench_hmap(n, pattern);
+			bench_hmap64(n, pattern);
+		}
+	}
+	printf("Done! (%lu)\n", (unsigned long)(bench_sink & 1));
+	return 0;
+}
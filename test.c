@@ -33,12 +33,82 @@
    For more information, please refer to <http://unlicense.org/>
 */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* for mremap and MAP_ANONYMOUS */
+#endif
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L /* for fileno */
+#endif
+#include <stdlib.h>
+
+/* Custom allocator counting live allocations per context (NULL context counts in test_allocs) */
+static size_t test_allocs;
+static void* test_malloc(void* ctx, size_t size) { void* p = malloc(size); if (p) ++*(ctx ? (size_t*)ctx : &test_allocs); return p; }
+static void* test_realloc(void* ctx, void* ptr, size_t old_size, size_t new_size) { (void)ctx; (void)old_size; return realloc(ptr, new_size); }
+static void test_free(void* ctx, void* ptr) { if (ptr) --*(ctx ? (size_t*)ctx : &test_allocs); free(ptr); }
+#define TINYBUF_MALLOC(ctx, size) test_malloc(ctx, size)
+#define TINYBUF_REALLOC(ctx, ptr, old_size, new_size) test_realloc(ctx, ptr, old_size, new_size)
+#define TINYBUF_FREE(ctx, ptr) test_free(ctx, ptr)
+#define TINYHASHMAP_MALLOC(ctx, size) test_malloc(ctx, size)
+#define TINYHASHMAP_FREE(ctx, ptr) test_free(ctx, ptr)
+#define TINYBLOOM_MALLOC(ctx, size) test_malloc(ctx, size)
+#define TINYBLOOM_FREE(ctx, ptr) test_free(ctx, ptr)
+#define TINYOMAP_MALLOC(ctx, size) test_malloc(ctx, size)
+#define TINYOMAP_FREE(ctx, ptr) test_free(ctx, ptr)
+
+#define TINYHASHMAP_MMAP
+#define TINYHASHMAP_STATS
+#define TINYHASHMAP_THREADS
+#define TINYHASHMAP_BLOOM
+#define TINYBUF_MMAP
+#define TINYBUF_MMAP_THRESHOLD (1 << 20)
 #include "tinybuf.h"
+#include "tinysbuf.h"
+#include "tinyrbuf.h"
+#include "tinyheap.h"
+#include "tinysort.h"
+#include "tinybloom.h"
 #include "tinyhashmap.h"
 #include "tinyhashmap64.h"
+#include "tinyhashmaps.h"
+#include "tinyhashmapc.h"
+#include "tinyhashmapsh.h"
+#include "tinyhashmapd.h"
+#include "tinycache.h"
+#include "tinyomap.h"
+#ifdef __cplusplus
+#include "tinycpp.h"
+#include <memory>
+#include <stdexcept>
+#endif
 
 #include <stdio.h>
 #define CDS_ASSERT(cond) (void)((cond) ? ((int)0) : (*(volatile int*)0 = 0xbad|fprintf(stderr, "FAILED ASSERT (%s)\n", #cond )))
+#ifndef _WIN32
+#include <sys/wait.h> /* for waitpid */
+#include <signal.h> /* for signal */
+#include <unistd.h> /* for fork and _exit */
+#endif
+
+/* Returns whether writing to p crashes (tried in a child process, always 1 on Windows) */
+static int test_writecrashes(void* p)
+{
+	#ifndef _WIN32
+	int status = 0;
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		signal(SIGSEGV, SIG_DFL); /* crash without the report of a sanitizer */
+		signal(SIGBUS, SIG_DFL);
+		*(volatile char*)p = 1;
+		_exit(0);
+	}
+	return (pid > 0 && waitpid(pid, &status, 0) == pid && !(WIFEXITED(status) && WEXITSTATUS(status) == 0));
+	#else
+	(void)p;
+	return 1;
+	#endif
+}
 
 typedef struct { int a, b, c; } mytype_t;
 
@@ -48,6 +118,10 @@ static void test_buf()
 	mytype_t some_element = { 1, 2, 3 };
 	mytype_t other_element = { 500, 10, 99 };
 	int i, ran_out_of_memory;
+	size_t j, arena_allocs = 0;
+	char* big = NULL;
+	BUF_INLINE(mytype_t, 8) storage;
+	mytype_t* small;
 
 	/* Add elements: */
 	BUF_PUSH(buf, some_element);
@@ -118,7 +192,374 @@ static void test_buf()
 	CDS_ASSERT(BUF_LEN(buf) == 230);
 	CDS_ASSERT(BUF_CAP(buf) == 1000);
 
+	/* Use a custom allocator: */
+	CDS_ASSERT(test_allocs == 1);
+	BUF_SETALLOC(buf, &arena_allocs);
+	CDS_ASSERT(test_allocs == 0 && arena_allocs == 1);
+	CDS_ASSERT(BUF_LEN(buf) == 230 && BUF_CAP(buf) == 1000 && !memcmp(&buf[215], &some_element, sizeof(some_element)));
+	BUF_RESIZE(buf, 2000);
+	CDS_ASSERT(test_allocs == 0 && arena_allocs == 1 && !memcmp(&buf[215], &some_element, sizeof(some_element)));
+	BUF_FREE(buf);
+	CDS_ASSERT(arena_allocs == 0);
+	BUF_SETALLOC(buf, &arena_allocs);
+	CDS_ASSERT(arena_allocs == 1 && BUF_LEN(buf) == 0 && BUF_CAP(buf) == 16);
+	BUF_PUSH(buf, other_element);
+	CDS_ASSERT(arena_allocs == 1 && !memcmp(&buf[0], &other_element, sizeof(other_element)));
+
+	/* Release unused memory: */
+	BUF_SHRINK(buf);
+	CDS_ASSERT(arena_allocs == 1 && BUF_LEN(buf) == 1 && BUF_CAP(buf) == 1 && !memcmp(&buf[0], &other_element, sizeof(other_element)));
+	BUF_CLEAR(buf);
+	BUF_SHRINK(buf);
+	CDS_ASSERT(arena_allocs == 1 && buf && BUF_LEN(buf) == 0 && BUF_CAP(buf) == 0);
+	BUF_PUSH(buf, some_element);
+	CDS_ASSERT(arena_allocs == 1 && BUF_LEN(buf) == 1 && BUF_CAP(buf) == 16 && !memcmp(&buf[0], &some_element, sizeof(some_element)));
+
+	BUF_FREE(buf);
+	CDS_ASSERT(arena_allocs == 0 && test_allocs == 0);
+
+	/* Growth settings: */
+	BUF_FITEXACT(buf, 100);
+	CDS_ASSERT(test_allocs == 1 && BUF_LEN(buf) == 0 && BUF_CAP(buf) == 100);
+	BUF_RESIZE(buf, 101);
+	CDS_ASSERT(BUF_CAP(buf) == 200);
+	BUF_SETGROWTH(buf, 150, 0);
+	BUF_RESIZE(buf, 201);
+	CDS_ASSERT(BUF_CAP(buf) == 300);
+	BUF_SETGROWTH(buf, 150, 50);
+	BUF_RESIZE(buf, 301);
+	CDS_ASSERT(BUF_CAP(buf) == 350);
+	BUF_RESIZE(buf, 500);
+	CDS_ASSERT(BUF_CAP(buf) == 500);
+	BUF_FITEXACT(buf, 400);
+	CDS_ASSERT(BUF_LEN(buf) == 500 && BUF_CAP(buf) == 500);
+	BUF_FREE(buf);
+	BUF_SETGROWTH(buf, 120, 0);
+	CDS_ASSERT(test_allocs == 1 && BUF_LEN(buf) == 0 && BUF_CAP(buf) == 16);
+	for (i = 0; i != 17; i++) BUF_PUSH(buf, some_element);
+	CDS_ASSERT(BUF_CAP(buf) == 19 && !memcmp(&buf[16], &some_element, sizeof(some_element)));
+	BUF_FREE(buf);
+	CDS_ASSERT(test_allocs == 0);
+
+	/* Start with inline storage: */
+	small = BUF_INITINLINE(storage);
+	CDS_ASSERT(small == storage.elems && BUF_LEN(small) == 0 && BUF_CAP(small) == 8 && test_allocs == 0);
+	for (i = 0; i != 8; i++) { BUF_PUSH(small, some_element); small[i].a = i; }
+	CDS_ASSERT(small == storage.elems && BUF_LEN(small) == 8 && BUF_CAP(small) == 8 && test_allocs == 0);
+	(void)BUF_POP(small);
+	BUF_SHRINK(small);
+	CDS_ASSERT(small == storage.elems && BUF_LEN(small) == 7 && BUF_CAP(small) == 8);
+	BUF_INSERT(small, 0, other_element);
+	BUF_PUSH(small, some_element);
+	CDS_ASSERT(small != storage.elems && BUF_LEN(small) == 9 && BUF_CAP(small) == 16 && test_allocs == 1);
+	CDS_ASSERT(!memcmp(&small[0], &other_element, sizeof(other_element)) && small[1].a == 0 && small[7].a == 6 && small[8].a == some_element.a);
+	BUF_FREE(small);
+	CDS_ASSERT(small == NULL && test_allocs == 0);
+	small = BUF_INITINLINE(storage);
+	BUF_PUSH(small, other_element);
+	BUF_FREE(small);
+	CDS_ASSERT(small == NULL && test_allocs == 0);
+	small = BUF_INITINLINE(storage);
+	BUF_PUSH(small, other_element);
+	BUF_SETALLOC(small, &arena_allocs);
+	CDS_ASSERT(small != storage.elems && arena_allocs == 1 && BUF_LEN(small) == 1 && BUF_CAP(small) == 8 && small[0].a == other_element.a);
+	BUF_FREE(small);
+	CDS_ASSERT(arena_allocs == 0 && test_allocs == 0);
+
+	/* Huge buffers in their own mapping (the threshold is 1 MB here): */
+	for (j = 0; j != 600000; j++) BUF_PUSH(big, (char)j);
+	CDS_ASSERT(test_allocs == 0 && BUF_LEN(big) == 600000 && BUF_CAP(big) >= (1 << 20) && (BUF_CAP(big) + sizeof(struct buf__hdr)) % 65536 == 0);
+	BUF_RESIZE(big, 20 << 20);
+	CDS_ASSERT(test_allocs == 0 && BUF_CAP(big) >= (20 << 20) && (BUF_CAP(big) + sizeof(struct buf__hdr)) % 65536 == 0);
+	for (j = 0; j != 600000 && big[j] == (char)j; j++) {}
+	CDS_ASSERT(j == 600000);
+	big[(20 << 20) - 1] = 1;
+	BUF_RESIZE(big, 1000);
+	BUF_SHRINK(big);
+	CDS_ASSERT(BUF_LEN(big) == 1000 && BUF_CAP(big) == 65536 - sizeof(struct buf__hdr));
+	for (j = 0; j != 1000 && big[j] == (char)j; j++) {}
+	CDS_ASSERT(j == 1000);
+	BUF_SETALLOC(big, &arena_allocs);
+	CDS_ASSERT(arena_allocs == 1 && BUF_LEN(big) == 1000 && big[999] == (char)999);
+	BUF_RESIZE(big, 2 << 20);
+	CDS_ASSERT(arena_allocs == 0 && big[999] == (char)999);
+	BUF_FREE(big);
+	CDS_ASSERT(test_allocs == 0 && arena_allocs == 0);
+}
+
+static void test_sbuf()
+{
+	mytype_t **buf = NULL, *p_first, *p_elem;
+	mytype_t some_element = { 1, 2, 3 };
+	mytype_t other_element = { 500, 10, 99 };
+	size_t i;
+
+	/* Add elements: */
+	SBUF_PUSH(buf, some_element);
+	SBUF_PUSH(buf, other_element);
+	CDS_ASSERT(SBUF_LEN(buf) == 2 && SBUF_CAP(buf) == 16 && test_allocs == 2);
+	CDS_ASSERT(!memcmp(&SBUF_AT(buf, 0), &some_element, sizeof(some_element)) && SBUF_AT(buf, 1).a == 500);
+	p_elem = SBUF_ADD(buf);
+	CDS_ASSERT(SBUF_LEN(buf) == 3 && p_elem == &SBUF_AT(buf, 2));
+	p_elem->a = 7;
+	CDS_ASSERT(SBUF_POP(buf).a == 7 && SBUF_LEN(buf) == 2);
+
+	/* Elements never move when growing: */
+	p_first = &SBUF_AT(buf, 0);
+	for (i = 2; i != 100000; i++) { p_elem = SBUF_ADD(buf); p_elem->a = (int)i; }
+	CDS_ASSERT(SBUF_LEN(buf) == 100000 && SBUF_CAP(buf) == 131056 && p_first == &SBUF_AT(buf, 0) && p_elem == &SBUF_AT(buf, 99999));
+	for (i = 2; i != 100000 && SBUF_AT(buf, i).a == (int)i; i++) {}
+	CDS_ASSERT(i == 100000 && SBUF_AT(buf, 1).a == 500);
+	CDS_ASSERT(&SBUF_AT(buf, 0) + 15 == &SBUF_AT(buf, 15) && &SBUF_AT(buf, 16) + 31 == &SBUF_AT(buf, 47) && &SBUF_AT(buf, 32752) + 32767 == &SBUF_AT(buf, 65519));
+
+	/* Clear and reserve: */
+	SBUF_CLEAR(buf);
+	CDS_ASSERT(SBUF_LEN(buf) == 0 && SBUF_CAP(buf) == 131056);
+	SBUF_PUSH(buf, other_element);
+	CDS_ASSERT(p_first == &SBUF_AT(buf, 0) && SBUF_AT(buf, 0).a == 500);
+	CDS_ASSERT(SBUF_TRYFIT(buf, 200000) && SBUF_CAP(buf) == 262128 && SBUF_LEN(buf) == 1);
+	CDS_ASSERT(!SBUF_TRYFIT(buf, (sizeof(void*) > 4 ? 0xFFFF000000000000 : 0xFFFF0000) / sizeof(mytype_t)) && SBUF_CAP(buf) == 262128 && test_allocs == 15);
+
+	/* Free allocated memory: */
+	SBUF_FREE(buf);
+	CDS_ASSERT(buf == NULL && SBUF_LEN(buf) == 0 && SBUF_CAP(buf) == 0 && test_allocs == 0);
+	CDS_ASSERT(SBUF_TRYFIT(buf, 20) && SBUF_CAP(buf) == 48 && SBUF_LEN(buf) == 0);
+	SBUF_FREE(buf);
+	CDS_ASSERT(test_allocs == 0);
+}
+
+static void test_rbuf()
+{
+	mytype_t *queue = NULL, *span;
+	mytype_t some_element = { 1, 2, 3 };
+	mytype_t other_element = { 500, 10, 99 };
+	int *ints = NULL, *ref = NULL, next_back = 0, next_front = -1;
+	size_t i, n, seed = 12345;
+
+	/* Add and remove at both ends: */
+	CDS_ASSERT(RBUF_LEN(queue) == 0 && RBUF_CAP(queue) == 0 && RBUF_SPANLEN(queue) == 0 && RBUF_SPAN(queue) == NULL);
+	RBUF_PUSH_BACK(queue, some_element);
+	RBUF_PUSH_BACK(queue, other_element);
+	RBUF_PUSH_FRONT(queue, other_element);
+	RBUF_AT(queue, 0).a = 7;
+	CDS_ASSERT(RBUF_LEN(queue) == 3 && RBUF_CAP(queue) == 16 && test_allocs == 1);
+	CDS_ASSERT(RBUF_AT(queue, 0).a == 7 && !memcmp(&RBUF_AT(queue, 1), &some_element, sizeof(some_element)) && RBUF_AT(queue, 2).a == 500);
+	CDS_ASSERT(&RBUF_AT(queue, 0) == &queue[15] && RBUF_SPAN(queue) == &queue[15] && RBUF_SPANLEN(queue) == 1);
+	CDS_ASSERT(RBUF_POP_FRONT(queue).a == 7 && RBUF_POP_BACK(queue).a == 500 && RBUF_LEN(queue) == 1 && RBUF_AT(queue, 0).a == 1);
+	CDS_ASSERT(RBUF_POP_FRONT(queue).a == 1 && RBUF_LEN(queue) == 0 && RBUF_SPANLEN(queue) == 0);
+
+	/* Growing while wrapped keeps the order (moving the part after or before the end): */
+	RBUF_CLEAR(queue);
+	for (i = 0; i != 10; i++) RBUF_PUSH_BACK(queue, some_element);
+	for (i = 0; i != 6; i++) { RBUF_PUSH_FRONT(queue, other_element); RBUF_AT(queue, 0).a = (int)i; }
+	CDS_ASSERT(RBUF_LEN(queue) == 16 && RBUF_CAP(queue) == 16 && RBUF_SPANLEN(queue) == 6);
+	RBUF_PUSH_BACK(queue, other_element);
+	CDS_ASSERT(RBUF_LEN(queue) == 17 && RBUF_CAP(queue) == 32 && RBUF_SPANLEN(queue) == 6 && RBUF_SPAN(queue) == &queue[26]);
+	for (i = 0; i != 6; i++) CDS_ASSERT(RBUF_AT(queue, i).a == (int)(5 - i));
+	for (i = 6; i != 16; i++) CDS_ASSERT(RBUF_AT(queue, i).a == 1);
+	CDS_ASSERT(RBUF_AT(queue, 16).a == 500);
+	RBUF_CLEAR(queue);
+	for (i = 0; i != 8; i++) RBUF_PUSH_BACK(queue, some_element);
+	RBUF_DROP_FRONT(queue, 6);
+	for (i = 0; i != 30; i++) { RBUF_PUSH_BACK(queue, other_element); RBUF_AT(queue, RBUF_LEN(queue) - 1).a = (int)i; }
+	CDS_ASSERT(RBUF_LEN(queue) == 32 && RBUF_CAP(queue) == 32 && RBUF_SPANLEN(queue) == 26);
+	RBUF_PUSH_FRONT(queue, some_element);
+	CDS_ASSERT(RBUF_LEN(queue) == 33 && RBUF_CAP(queue) == 64 && RBUF_SPANLEN(queue) == 33 && RBUF_SPAN(queue) == &queue[5]);
+	for (i = 0; i != 30; i++) CDS_ASSERT(RBUF_AT(queue, i + 3).a == (int)i);
+
+	/* Drain in spans: */
+	for (n = 0; RBUF_LEN(queue); n++)
+	{
+		span = RBUF_SPAN(queue);
+		CDS_ASSERT(span == &RBUF_AT(queue, 0) && span + RBUF_SPANLEN(queue) - 1 == &RBUF_AT(queue, RBUF_SPANLEN(queue) - 1));
+		RBUF_DROP_FRONT(queue, RBUF_SPANLEN(queue));
+	}
+	CDS_ASSERT(n == 1 && RBUF_CAP(queue) == 64);
+	for (i = 0; i != 64; i++) { RBUF_PUSH_BACK(queue, other_element); RBUF_AT(queue, i).a = (int)i; }
+	for (n = 0, i = 0; RBUF_LEN(queue); n++)
+	{
+		size_t j, len = RBUF_SPANLEN(queue);
+		for (span = RBUF_SPAN(queue), j = 0; j != len; j++) CDS_ASSERT(span[j].a == (int)i++);
+		RBUF_DROP_FRONT(queue, len);
+	}
+	CDS_ASSERT(n == 2 && i == 64 && RBUF_CAP(queue) == 64);
+	RBUF_PUSH_BACK(queue, some_element);
+	RBUF_PUSH_BACK(queue, other_element);
+	RBUF_DROP_BACK(queue, 1);
+	CDS_ASSERT(RBUF_LEN(queue) == 1 && RBUF_AT(queue, 0).a == 1);
+
+	/* Reserve, out of memory and free: */
+	CDS_ASSERT(RBUF_TRYFIT(queue, 100) && RBUF_CAP(queue) == 128 && RBUF_LEN(queue) == 1 && RBUF_AT(queue, 0).a == 1);
+	CDS_ASSERT(!RBUF_TRYFIT(queue, (sizeof(void*) > 4 ? 0xFFFF000000000000 : 0xFFFF0000) / sizeof(mytype_t)) && RBUF_CAP(queue) == 128 && test_allocs == 1);
+	RBUF_FREE(queue);
+	CDS_ASSERT(queue == NULL && RBUF_LEN(queue) == 0 && RBUF_CAP(queue) == 0 && test_allocs == 0);
+	CDS_ASSERT(RBUF_TRYFIT(queue, 20) && RBUF_CAP(queue) == 32 && RBUF_LEN(queue) == 0);
+	RBUF_FREE(queue);
+
+	/* Random operations compared with a plain array: */
+	for (i = 0; i != 100000; i++)
+	{
+		size_t op = (seed = seed * 6364136223846793005u + 1442695040888963407u) >> 60;
+		if (op < 5) { RBUF_PUSH_BACK(ints, next_back); BUF_PUSH(ref, next_back); next_back++; }
+		else if (op < 10) { RBUF_PUSH_FRONT(ints, next_front); BUF_INSERT(ref, 0, next_front); next_front--; }
+		else if (op < 12 && BUF_LEN(ref)) { CDS_ASSERT(RBUF_POP_FRONT(ints) == ref[0]); BUF_REMOVE(ref, 0); }
+		else if (op < 14 && BUF_LEN(ref)) CDS_ASSERT(RBUF_POP_BACK(ints) == BUF_POP(ref));
+		else if (BUF_LEN(ref) > 3) { RBUF_DROP_FRONT(ints, 1); BUF_REMOVE(ref, 0); RBUF_DROP_BACK(ints, 1); BUF_RESIZE(ref, BUF_LEN(ref) - 1); }
+		CDS_ASSERT(RBUF_LEN(ints) == BUF_LEN(ref) && (!BUF_LEN(ref) || (RBUF_AT(ints, 0) == ref[0] && RBUF_AT(ints, BUF_LEN(ref) - 1) == BUF_END(ref)[-1])));
+	}
+	for (i = 0; i != BUF_LEN(ref); i++) CDS_ASSERT(RBUF_AT(ints, i) == ref[i]);
+	CDS_ASSERT(BUF_LEN(ref) > 1000 && RBUF_CAP(ints) >= BUF_LEN(ref) && !(RBUF_CAP(ints) & (RBUF_CAP(ints) - 1)));
+	RBUF_FREE(ints);
+	BUF_FREE(ref);
+	CDS_ASSERT(test_allocs == 0);
+}
+
+static int test_cmp_int(const void* a, const void* b) { return (*(const int*)a > *(const int*)b) - (*(const int*)a < *(const int*)b); }
+static int test_cmp_mytype_desc(const void* a, const void* b) { return (((const mytype_t*)a)->a < ((const mytype_t*)b)->a) - (((const mytype_t*)a)->a > ((const mytype_t*)b)->a); }
+typedef struct { int key; char payload[150]; } test_big_t;
+static int test_cmp_big(const void* a, const void* b) { return test_cmp_int(&((const test_big_t*)a)->key, &((const test_big_t*)b)->key); }
+#define TEST_BY_A_DESC test_cmp_mytype_desc
+
+static void test_heap()
+{
+	int *heap = NULL, *buf = NULL, last, x;
+	mytype_t *mheap = NULL, elem = { 0, 0, 0 };
+	test_big_t *bheap = NULL, big;
+	size_t i, j, seed = 12345;
+
+	/* Push and pop: */
+	HEAP_PUSH(heap, 30, test_cmp_int);
+	HEAP_PUSH(heap, 10, test_cmp_int);
+	HEAP_PUSH(heap, 20, test_cmp_int);
+	CDS_ASSERT(BUF_LEN(heap) == 3 && HEAP_TOP(heap) == 10 && test_allocs == 1);
+	CDS_ASSERT(HEAP_POP(heap, test_cmp_int) == 10 && BUF_LEN(heap) == 2 && HEAP_TOP(heap) == 20);
+	HEAP_REPLACETOP(heap, 25, test_cmp_int);
+	CDS_ASSERT(HEAP_TOP(heap) == 25 && HEAP_POP(heap, test_cmp_int) == 25 && HEAP_POP(heap, test_cmp_int) == 30 && BUF_LEN(heap) == 0);
+
+	/* Many elements (with duplicates) come out in order: */
+	for (i = 0; i != 10000; i++)
+		HEAP_PUSH(heap, (int)((seed = seed * 6364136223846793005u + 1442695040888963407u) >> 52), test_cmp_int);
+	for (i = 1; i != BUF_LEN(heap); i++)
+		CDS_ASSERT(heap[(i - 1) / 4] <= heap[i]);
+	for (last = -1, i = 0; i != 10000; i++, last = x)
+	{
+		CDS_ASSERT((x = HEAP_POP(heap, test_cmp_int)) >= last);
+		if (i % 3 == 0 && i < 6000) HEAP_PUSH(heap, x + 1, test_cmp_int), HEAP_PUSH(heap, x, test_cmp_int), HEAP_POP(heap, test_cmp_int), HEAP_POP(heap, test_cmp_int);
+	}
+	CDS_ASSERT(BUF_LEN(heap) == 0);
+
+	/* Keep the 100 largest elements with a min-heap: */
+	for (i = 0; i != 10000; i++)
+	{
+		x = (int)((i * 7919) % 10000);
+		if (BUF_LEN(heap) < 100) HEAP_PUSH(heap, x, test_cmp_int);
+		else if (x > HEAP_TOP(heap)) HEAP_REPLACETOP(heap, x, test_cmp_int);
+	}
+	for (i = 9900; i != 10000; i++) CDS_ASSERT(HEAP_POP(heap, test_cmp_int) == (int)i);
+	BUF_FREE(heap);
+
+	/* Heapify existing buffers of all small sizes: */
+	for (i = 0; i != 40; i++)
+	{
+		BUF_CLEAR(buf);
+		for (j = 0; j != i; j++) BUF_PUSH(buf, (int)((j * 13) % 17));
+		HEAP_HEAPIFY(buf, test_cmp_int);
+		for (j = 1; j < i; j++) CDS_ASSERT(buf[(j - 1) / 4] <= buf[j]);
+		for (last = -1, j = 0; j != i; j++, last = x) CDS_ASSERT((x = HEAP_POP(buf, test_cmp_int)) >= last);
+	}
+	BUF_FREE(buf);
+
+	/* Comparison given as a macro, structs ordered descending: */
+	for (i = 0; i != 1000; i++) { elem.a = (int)((i * 389) % 1000); elem.b = elem.a * 2; HEAP_PUSH(mheap, elem, TEST_BY_A_DESC); }
+	for (i = 1000; i--;) { elem = HEAP_POP(mheap, TEST_BY_A_DESC); CDS_ASSERT(elem.a == (int)i && elem.b == (int)i * 2); }
+	BUF_FREE(mheap);
+
+	/* Elements larger than the swap step: */
+	for (i = 0; i != 500; i++) { big.key = (int)((i * 211) % 500); memset(big.payload, big.key & 0xFF, sizeof(big.payload)); BUF_PUSH(bheap, big); }
+	HEAP_HEAPIFY(bheap, test_cmp_big);
+	for (i = 0; i != 500; i++)
+	{
+		big = HEAP_POP(bheap, test_cmp_big);
+		CDS_ASSERT(big.key == (int)i && big.payload[0] == (char)(i & 0xFF) && big.payload[149] == (char)(i & 0xFF));
+	}
+	BUF_FREE(bheap);
+	CDS_ASSERT(test_allocs == 0);
+}
+
+typedef struct { uint32_t pad; uint64_t id; uint32_t order; } test_entry_t;
+
+static void test_sort()
+{
+	uint32_t *buf = NULL, sum, sum_sorted;
+	uint64_t *buf64 = NULL;
+	test_entry_t *entries = NULL, entry;
+	size_t i, j, n, arena_allocs = 0, seed = 12345;
+
+	/* Small buffers of all lengths (insertion sort and radix sort), with the allocator of the buffer: */
+	BUF_SETALLOC(buf, &arena_allocs);
+	CDS_ASSERT(BUF_SORT_U32(buf) && BUF_LOWER_BOUND(buf, 5) == 0);
+	for (n = 1; n != 80; n++)
+	{
+		BUF_CLEAR(buf);
+		for (i = 0; i != n; i++) BUF_PUSH(buf, (uint32_t)((i * 7919) % 31) << (n % 4 * 8));
+		CDS_ASSERT(BUF_SORT_U32(buf) && arena_allocs == 1 && test_allocs == 0);
+		for (i = 1; i < n; i++) CDS_ASSERT(buf[i - 1] <= buf[i]);
+		for (i = 0; i != 34; i++)
+		{
+			uint32_t key = (uint32_t)i << (n % 4 * 8);
+			for (j = 0; j != n && buf[j] < key; j++) {}
+			CDS_ASSERT(BUF_LOWER_BOUND(buf, key) == j);
+		}
+	}
+	CDS_ASSERT(BUF_LOWER_BOUND(buf, 0) == 0 && BUF_LOWER_BOUND(buf, 0xFFFFFFFF) == BUF_LEN(buf) && BUF_LOWER_BOUND(buf, 0x100000000) == BUF_LEN(buf));
+
+	/* Large buffers, the result is a permutation and lookups find every element: */
+	BUF_CLEAR(buf);
+	for (sum = 0, i = 0; i != 100000; i++)
+		sum += *BUF_ADD(buf, 1) = (uint32_t)((seed = seed * 6364136223846793005u + 1442695040888963407u) >> 32);
+	CDS_ASSERT(BUF_SORT_U32(buf) && arena_allocs == 1);
+	for (sum_sorted = buf[0], i = 1; i != 100000; i++) { sum_sorted += buf[i]; CDS_ASSERT(buf[i - 1] <= buf[i]); }
+	CDS_ASSERT(sum == sum_sorted);
+	for (i = 0; i < 100000; i += 7) CDS_ASSERT(buf[j = BUF_LOWER_BOUND(buf, buf[i])] == buf[i] && (j == 0 || buf[j - 1] < buf[i]));
+	for (i = 0; i != 100000; i++) buf[i] = (uint32_t)(i & 0xFF00) | 0x55000000;
+	CDS_ASSERT(BUF_SORT_U32(buf) && buf[0] == 0x55000000 && buf[99999] == 0x5500FF00 && BUF_LOWER_BOUND(buf, 0x55000100) == 512);
 	BUF_FREE(buf);
+	CDS_ASSERT(arena_allocs == 0);
+
+	for (i = 0; i != 50000; i++)
+		BUF_PUSH(buf64, (seed = seed * 6364136223846793005u + 1442695040888963407u) >> (i % 3 * 20));
+	CDS_ASSERT(BUF_SORT_U64(buf64) && test_allocs == 1);
+	for (i = 1; i != 50000; i++) CDS_ASSERT(buf64[i - 1] <= buf64[i]);
+	CDS_ASSERT(BUF_LOWER_BOUND(buf64, buf64[12345]) <= 12345 && buf64[BUF_LOWER_BOUND(buf64, buf64[12345])] == buf64[12345]);
+	CDS_ASSERT(BUF_LOWER_BOUND(buf64, 0) == 0 && BUF_LOWER_BOUND(buf64, buf64[49999] + 1) == 50000);
+	BUF_FREE(buf64);
+
+	/* Structs by a member, elements with the same key keep their order: */
+	for (i = 0; i != 5000; i++)
+	{
+		entry.pad = 0xAAAAAAAA;
+		entry.id = (uint64_t)((i * 7919) % 1000) << 33;
+		entry.order = (uint32_t)i;
+		BUF_PUSH(entries, entry);
+	}
+	CDS_ASSERT(BUF_SORT_BY(entries, id) && test_allocs == 1);
+	for (i = 1; i != 5000; i++)
+		CDS_ASSERT(entries[i - 1].id < entries[i].id || (entries[i - 1].id == entries[i].id && entries[i - 1].order < entries[i].order));
+	CDS_ASSERT(entries[0].pad == 0xAAAAAAAA && BUF_LOWER_BOUND_BY(entries, id, (uint64_t)10 << 33) == 50 && BUF_LOWER_BOUND_BY(entries, id, ((uint64_t)10 << 33) + 1) == 55);
+	CDS_ASSERT(BUF_SORT_BY(entries, order) && entries[1234].order == 1234 && BUF_LOWER_BOUND_BY(entries, order, 4000) == 4000 && BUF_LOWER_BOUND_BY(entries, order, 9000) == 5000);
+	BUF_FREE(entries);
+	CDS_ASSERT(test_allocs == 0 && BUF_LOWER_BOUND_BY(entries, id, 1) == 0);
+
+	#ifdef TEST_SORT_WRONG_KEY
+	/* Keys other than 4 or 8 bytes must not compile (building with -DTEST_SORT_WRONG_KEY has to fail): */
+	{
+		struct { uint16_t id; uint32_t order; } *shorts = NULL;
+		uint16_t *buf16 = NULL;
+		(void)BUF_SORT_BY(shorts, id);
+		(void)BUF_LOWER_BOUND_BY(shorts, id, 1);
+		(void)BUF_LOWER_BOUND(buf16, 1);
+	}
+	#endif
 }
 
 static uint32_t hash_nocase_nospace(const char* str)
@@ -131,6 +572,54 @@ static uint32_t hash_nocase_nospace(const char* str)
 	return (hash ? hash : 1);
 }
 
+/* Returns the first key above after whose lookup in map starts at slot home */
+static uint32_t test_hmap_keyat(const mytype_t* map, size_t home, uint32_t after)
+{
+	while (HMAP_HOME(map, ++after) != home) {}
+	return after;
+}
+
+static uint64_t test_hmap64_keyat(const mytype_t* map, size_t home, uint64_t after)
+{
+	while (HMAP64_HOME(map, ++after) != home) {}
+	return after;
+}
+
+static void test_bloom()
+{
+	uint64_t* filter = NULL;
+	uint64_t i;
+	size_t false_positives = 0;
+
+	/* A filter without BLOOM_INIT is made for 1024 keys: */
+	CDS_ASSERT(BLOOM_LEN(filter) == 0 && BLOOM_CAP(filter) == 0 && BLOOM_SIZEOF(filter) == 0 && !BLOOM_HAS(filter, 123));
+	BLOOM_ADD(filter, 123);
+	CDS_ASSERT(BLOOM_LEN(filter) == 1 && BLOOM_CAP(filter) == 1024 && BLOOM_SIZEOF(filter) == 2048 && ((size_t)filter & 63) == 0 && test_allocs == 1);
+	CDS_ASSERT(BLOOM_HAS(filter, 123) && !BLOOM_HAS(filter, 456) && !BLOOM_HAS(filter, 0));
+
+	/* Making it again drops all keys, added keys are always found and few others are: */
+	CDS_ASSERT(BLOOM_INIT(filter, 100000, 12) && BLOOM_LEN(filter) == 0 && BLOOM_CAP(filter) == 100000 && BLOOM_SIZEOF(filter) == 262144 && test_allocs == 1);
+	CDS_ASSERT(!BLOOM_HAS(filter, 123));
+	for (i = 1; i <= 100000; i++)
+		BLOOM_ADD(filter, i * 0x9E3779B97F4A7C15u);
+	CDS_ASSERT(BLOOM_LEN(filter) == 100000 && BLOOM_CAP(filter) == 100000);
+	for (i = 1; i <= 100000; i++)
+		CDS_ASSERT(BLOOM_HAS(filter, i * 0x9E3779B97F4A7C15u));
+	for (i = 1; i <= 100000; i++)
+		false_positives += BLOOM_HAS(filter, i * 0x9E3779B97F4A7C15u + 1);
+	CDS_ASSERT(false_positives < 500);
+	BLOOM_CLEAR(filter);
+	CDS_ASSERT(BLOOM_LEN(filter) == 0 && BLOOM_SIZEOF(filter) == 262144 && !BLOOM_HAS(filter, 0x9E3779B97F4A7C15u));
+
+	/* Out of memory: */
+	CDS_ASSERT(!BLOOM_INIT(filter, (size_t)-1 / 2, 12) && filter == NULL && test_allocs == 0);
+	CDS_ASSERT(BLOOM_INIT(filter, 0, 0) && BLOOM_SIZEOF(filter) == 64);
+	BLOOM_ADD(filter, 7);
+	CDS_ASSERT(BLOOM_HAS(filter, 7));
+	BLOOM_FREE(filter);
+	CDS_ASSERT(filter == NULL && BLOOM_LEN(filter) == 0 && BLOOM_CAP(filter) == 0 && test_allocs == 0);
+}
+
 static void test_hmap()
 {
 	mytype_t* map = NULL;
@@ -139,8 +628,21 @@ static void test_hmap()
 	mytype_t map_null = { -1, -1, -1 };
 	mytype_t* p_elem;
 	int has_foo, has_baz, removed, removed_again, it_found_count, ran_out_of_memory;
-	size_t i, cap;
+	size_t i, cap, arena_allocs = 0;
 	ptrdiff_t idx_foo, idx_invalid;
+	uint32_t batch_keys[600];
+	mytype_t batch_vals[600], *empty_map = NULL;
+	ptrdiff_t batch_idx[600];
+	mytype_t* loaded_map = NULL, *frozen_map = NULL;
+	uint32_t *set = NULL, *other_set = NULL;
+	mytype_t* chain_map = NULL;
+	uint32_t chain_keys[20], chain_key;
+	mytype_t* stats_map = NULL;
+	uint32_t stats_keys[151], stats_zero[3], cluster_keys[101];
+	struct hmap_stats stats;
+	size_t test_allocs_before;
+	int* wrong_map = NULL;
+	FILE* f;
 
 	/* Set 2 elements with string keys and mytype_t values: */
 	HMAP_SET_STR(map, "foo", some_element);
@@ -167,6 +669,15 @@ static void test_hmap()
 	p_elem->a = 123;
 	CDS_ASSERT(HMAP_GET_STR(map, "qux").a == 123);
 
+	/* Keys of arbitrary bytes (may contain zeros), hashed over their length: */
+	HMAP_SET_BYTES(map, "a\0b", 3, other_element);
+	CDS_ASSERT(HMAP_HAS_BYTES(map, "a\0b", 3) && !HMAP_HAS_BYTES(map, "a\0c", 3) && !HMAP_HAS_BYTES(map, "a", 1));
+	CDS_ASSERT(HMAP_GET_BYTES(map, "a\0b", 3).a == 500 && HMAP_IDX_BYTES(map, "a\0b", 3) >= 0);
+	CDS_ASSERT(hash_bytes("0123456789abcdefghijklmnopqrstuvwxyz0123456789ABCDEFGHIJ", 56) != hash_bytes("0123456789abcdefghijklmnopqrstuvwxyz0123456789ABCDEFGHIK", 56));
+	CDS_ASSERT(HMAP_PTR_BYTES(map, "a\0b", 3)->b == 10);
+	CDS_ASSERT(HMAP_DEL_BYTES(map, "a\0b", 3) && !HMAP_HAS_BYTES(map, "a\0b", 3));
+	CDS_ASSERT(hash_bytes("", 0) != 0);
+
 	/* Looking up an index of a key: */
 	idx_foo = HMAP_IDX_STR(map, "foo");
 	idx_invalid = HMAP_IDX_STR(map, "invalid");
@@ -223,12 +734,290 @@ static void test_hmap()
 	CDS_ASSERT(HMAP_LEN(map) == 0);
 	CDS_ASSERT(HMAP_CAP(map) == 2048);
 
+	/* Set a maximum load factor: */
+	HMAP_FREE(map);
+	HMAP_SETLOADFACTOR(map, 0.875);
+	HMAP_FIT(map, 100);
+	CDS_ASSERT(HMAP_CAP(map) == 128);
+	for (i = 1; i <= 100; i++) cluster_keys[i] = test_hmap_keyat(map, 120, (i > 1 ? cluster_keys[i - 1] : 0));
+	for (i = 1; i <= 100; i++) HMAP_PTR(map, cluster_keys[i])->a = (int)i; /* all in one cluster wrapping around the end */
+	CDS_ASSERT(HMAP_LEN(map) == 100);
+	CDS_ASSERT(HMAP_CAP(map) == 128);
+	for (i = 1; i <= 100; i += 2) CDS_ASSERT(HMAP_DEL(map, cluster_keys[i]));
+	CDS_ASSERT(HMAP_LEN(map) == 50);
+	for (i = 1; i <= 100; i++) CDS_ASSERT(HMAP_HAS(map, cluster_keys[i]) == !(i & 1) && (i & 1 || HMAP_GET(map, cluster_keys[i]).a == (int)i));
+
+	/* Spread the rehashing when growing: */
+	HMAP_FREE(map);
+	HMAP_SETINCREMENTAL(map, 1);
+	for (i = 1; i <= 1000; i++)
+	{
+		HMAP_PTR(map, (uint32_t)(i * 2654435761u))->a = (int)i;
+		CDS_ASSERT(HMAP_LEN(map) == i && HMAP_GET(map, (uint32_t)((i + 1) / 2 * 2654435761u)).a == (int)((i + 1) / 2));
+		if (i % 3 != 0) continue;
+		CDS_ASSERT(HMAP_DEL(map, (uint32_t)((i - 1) * 2654435761u)) && HMAP_LEN(map) == i - 1 && !HMAP_HAS(map, (uint32_t)((i - 1) * 2654435761u)));
+		HMAP_PTR(map, (uint32_t)((i - 1) * 2654435761u))->a = (int)(i - 1);
+	}
+	HMAP_FINISHGROW(map);
+	CDS_ASSERT(HMAP_LEN(map) == 1000);
+	for (i = 0, it_found_count = 0, cap = HMAP_CAP(map); i != cap; i++)
+		if (HMAP_KEY(map, i)) { it_found_count++; CDS_ASSERT(HMAP_KEY(map, i) == (uint32_t)(map[i].a * 2654435761u)); }
+	CDS_ASSERT(it_found_count == 1000);
+
+	/* Look up and set keys in batches: */
+	for (i = 0; i != 600; i++) { batch_keys[i] = (uint32_t)((i + 701) * 2654435761u); batch_vals[i] = other_element; batch_vals[i].a = (int)(i + 701); }
+	CDS_ASSERT(HMAP_GET_BATCH(empty_map, batch_keys, 600, batch_idx) == 0 && batch_idx[0] == -1 && batch_idx[599] == -1);
+	CDS_ASSERT(HMAP_GET_BATCH(map, batch_keys, 600, batch_idx) == 300);
+	for (i = 0; i != 600; i++) CDS_ASSERT(i < 300 ? map[batch_idx[i]].a == (int)(i + 701) : batch_idx[i] == -1);
+	HMAP_SET_BATCH(map, batch_keys, 600, batch_vals);
+	CDS_ASSERT(HMAP_LEN(map) == 1300 && HMAP_GET_BATCH(map, batch_keys, 600, batch_idx) == 600);
+	for (i = 0; i != 600; i++) CDS_ASSERT(map[batch_idx[i]].a == (int)(i + 701) && map[batch_idx[i]].b == 10);
+	HMAP_SET_BATCH(empty_map, batch_keys, 600, batch_vals);
+	CDS_ASSERT(HMAP_LEN(empty_map) == 600 && HMAP_GET(empty_map, batch_keys[599]).a == 1300);
+	HMAP_FREE(empty_map);
+	for (i = 300; i != 600; i++) CDS_ASSERT(HMAP_DEL(map, batch_keys[i]));
+
+	/* Set large arrays at once and merge maps: */
+	{
+		mytype_t *built = NULL, *ref = NULL, *merged = NULL, *small = NULL, *same = NULL, *none = NULL;
+		uint32_t* bkeys = (uint32_t*)malloc(200000 * sizeof(uint32_t)), k;
+		mytype_t* bvals = (mytype_t*)malloc(200000 * sizeof(mytype_t));
+		size_t* pick = (size_t*)malloc((131072 + 16000) * sizeof(size_t));
+		size_t n, j;
+		CDS_ASSERT(bkeys && bvals && pick);
+		for (i = 0; i != 200000; i++) { bkeys[i] = (uint32_t)((i % 150000) * 2654435761u); bvals[i] = other_element; bvals[i].a = (int)i; }
+		HMAP_BUILD(built, bkeys, bvals, 200000, 4);
+		CDS_ASSERT(HMAP_LEN(built) == 149999 && HMAP_GET(built, 0).a == 0);
+		for (i = 1, n = 0; i != 150000; i++) n += (HMAP_GET(built, bkeys[i]).a == (int)(i < 50000 ? i + 150000 : i));
+		CDS_ASSERT(n == 149999);
+		for (i = 0, n = 0, cap = HMAP_CAP(built); i != cap; i++) if (HMAP_KEY(built, i)) n += (HMAP_IDX(built, HMAP_KEY(built, i)) == (ptrdiff_t)i);
+		CDS_ASSERT(n == 149999);
+		HMAP_FREE(built);
+		HMAP_BUILD(built, bkeys, bvals, 1000, 1);
+		CDS_ASSERT(HMAP_LEN(built) == 999 && HMAP_GET(built, bkeys[999]).a == 999);
+		HMAP_BUILD(built, bkeys, bvals, 0, 1);
+		CDS_ASSERT(HMAP_LEN(built) == 999);
+		HMAP_FREE(built);
+
+		/* clusters across the end of a region and the end of the table, the first keys are picked by their home slot */
+		HMAP_SETLOADFACTOR(built, 0.9375);
+		HMAP_FIT(built, 100000);
+		CDS_ASSERT(HMAP_CAP(built) == 131072);
+		memset(pick, 0, 131072 * sizeof(size_t));
+		for (i = 16000; i--;)
+		{
+			size_t home = (i < 10000 ? 65536 - 5000 : 131072 - 3000) + i % 5000 % 3000;
+			pick[131072 + i] = pick[home];
+			pick[home] = i + 1;
+		}
+		for (k = 1 << 20, n = 16000; n;) /* above the keys of small below */
+		{
+			size_t home = HMAP_HOME(built, ++k);
+			if (!pick[home]) continue;
+			i = pick[home] - 1;
+			pick[home] = pick[131072 + i];
+			bkeys[i] = k;
+			n--;
+		}
+		for (i = 0; i != 100000; i++)
+		{
+			if (i >= 16000) bkeys[i] = (uint32_t)(i * 2654435761u);
+			bvals[i].a = (int)i;
+			HMAP_SET(ref, bkeys[i], bvals[i]);
+		}
+		HMAP_BUILD(built, bkeys, bvals, 100000, 4);
+		CDS_ASSERT(HMAP_CAP(built) == 131072 && HMAP_LEN(built) == HMAP_LEN(ref));
+		for (i = 0, n = 0; i != 100000; i++) n += (HMAP_GET(built, bkeys[i]).a == HMAP_GET(ref, bkeys[i]).a);
+		CDS_ASSERT(n == 100000);
+		for (i = 0, n = 0, cap = HMAP_CAP(built); i != cap; i++) if (HMAP_KEY(built, i)) n += (HMAP_IDX(built, HMAP_KEY(built, i)) == (ptrdiff_t)i);
+		CDS_ASSERT(n == HMAP_LEN(ref));
+
+		/* merging into nothing copies, merging what fits adds, merging into a smaller map makes a new table */
+		HMAP_MERGE(merged, built);
+		CDS_ASSERT(HMAP_LEN(merged) == HMAP_LEN(ref) && HMAP_GET(merged, bkeys[12345]).a == HMAP_GET(ref, bkeys[12345]).a);
+		for (i = 0; i != 2000; i++) { bvals[i].a = -(int)i; HMAP_SET(small, (uint32_t)(i < 1000 ? bkeys[i + 50000] : (i + 1) * 7), bvals[i]); }
+		HMAP_MERGE(merged, small);
+		CDS_ASSERT(HMAP_LEN(merged) == HMAP_LEN(ref) + 1000 && HMAP_GET(merged, bkeys[50000]).a == 0 && HMAP_GET(merged, 7 * 1001).a == -1000);
+		HMAP_MERGE(small, built);
+		CDS_ASSERT(HMAP_LEN(small) == HMAP_LEN(ref) + 1000 && HMAP_CAP(small) >= HMAP_CAP(built));
+		for (i = 0, n = 0; i != 100000; i++) n += (HMAP_GET(small, bkeys[i]).a == HMAP_GET(ref, bkeys[i]).a);
+		for (i = 1000, j = 0; i != 2000; i++) j += (HMAP_GET(small, (uint32_t)((i + 1) * 7)).a == -(int)i);
+		CDS_ASSERT(n == 100000 && j == 1000);
+		for (i = 0, n = 0, cap = HMAP_CAP(small); i != cap; i++) if (HMAP_KEY(small, i)) n += (HMAP_IDX(small, HMAP_KEY(small, i)) == (ptrdiff_t)i);
+		CDS_ASSERT(n == HMAP_LEN(small));
+		HMAP_MERGE(small, none);
+		HMAP_MERGE(small, small);
+		CDS_ASSERT(HMAP_LEN(small) == HMAP_LEN(ref) + 1000);
+
+		/* small had its own seed, with the seed of built (taken by merging into nothing and kept by shrinking) both get read in order */
+		HMAP_MERGE(same, built);
+		HMAP_CLEAR(same);
+		HMAP_SHRINK(same);
+		for (i = 0; i != 2000; i++) HMAP_SET(same, (uint32_t)(i < 1000 ? bkeys[i + 50000] : (i + 1) * 7), bvals[i]);
+		HMAP_MERGE(same, built);
+		CDS_ASSERT(HMAP_LEN(same) == HMAP_LEN(small) && HMAP_HOME(same, bkeys[777]) % HMAP_CAP(built) == HMAP_HOME(built, bkeys[777]));
+		for (i = 0, n = 0, cap = HMAP_CAP(small); i != cap; i++) if (HMAP_KEY(small, i)) n += (HMAP_GET(same, HMAP_KEY(small, i)).a == small[i].a);
+		CDS_ASSERT(n == HMAP_LEN(small));
+		for (i = 0, n = 0, cap = HMAP_CAP(same); i != cap; i++) if (HMAP_KEY(same, i)) n += (HMAP_IDX(same, HMAP_KEY(same, i)) == (ptrdiff_t)i);
+		CDS_ASSERT(n == HMAP_LEN(small));
+
+		HMAP_FREE(built);
+		HMAP_FREE(ref);
+		HMAP_FREE(merged);
+		HMAP_FREE(small);
+		HMAP_FREE(same);
+		free(bkeys);
+		free(bvals);
+		free(pick);
+	}
+
+	/* Use a custom allocator: */
+	cap = HMAP_CAP(map);
+	HMAP_SETALLOC(map, &arena_allocs);
+	CDS_ASSERT(arena_allocs == 1 && HMAP_CAP(map) == cap && HMAP_LEN(map) == 1000 && HMAP_GET(map, (uint32_t)(500 * 2654435761u)).a == 500);
+	for (i = 1001; i <= 3000; i++) HMAP_PTR(map, (uint32_t)(i * 2654435761u))->a = (int)i;
+	HMAP_FINISHGROW(map);
+	CDS_ASSERT(arena_allocs == 1 && ((size_t)&HMAP_KEY(map, 0) & 63) == 0 && HMAP_LEN(map) == 3000 && HMAP_GET(map, (uint32_t)(2500 * 2654435761u)).a == 2500);
+
+	/* Save to a file and map it back: */
+	f = fopen("test_hmap.bin", "wb");
+	CDS_ASSERT(f && HMAP_SAVE(map, fileno(f)));
+	fclose(f);
+	HMAP_MMAP(loaded_map, "test_hmap.bin");
+	CDS_ASSERT(loaded_map && HMAP_LEN(loaded_map) == 3000 && HMAP_CAP(loaded_map) == HMAP_CAP(map) && ((size_t)&HMAP_KEY(loaded_map, 0) & 63) == 0);
+	for (i = 1; i <= 3000; i++) CDS_ASSERT(HMAP_GET(loaded_map, (uint32_t)(i * 2654435761u)).a == (int)i && HMAP_IDX(loaded_map, (uint32_t)(i * 2654435761u)) == HMAP_IDX(map, (uint32_t)(i * 2654435761u)));
+	CDS_ASSERT(!HMAP_HAS(loaded_map, 12345) && HMAP_HAS(loaded_map, (uint32_t)2654435761u));
+	HMAP_STATS(loaded_map, &stats);
+	CDS_ASSERT(stats.lookups == 6002 && stats.misses == 1 && stats.len == 3000);
+	CDS_ASSERT(test_writecrashes(&HMAP_KEY(loaded_map, 0)) && test_writecrashes(HMAP__HDR(loaded_map)) && test_writecrashes(&loaded_map[-1]) && test_writecrashes(&loaded_map[0]));
+	HMAP_UNMAP(loaded_map);
+	CDS_ASSERT(loaded_map == NULL && HMAP_MMAP(wrong_map, "test_hmap.bin") == NULL && HMAP_MMAP(loaded_map, "test_invalid.bin") == NULL);
+	remove("test_hmap.bin");
+
+	/* Freeze into a minimal perfect hash table: */
+	HMAP_FREEZE(frozen_map, map);
+	CDS_ASSERT(frozen_map && arena_allocs == 2 && HMAPF_LEN(frozen_map) == 3000 && HMAP_LEN(map) == 3000);
+	for (i = 1; i <= 3000; i++) CDS_ASSERT(HMAPF_GET(frozen_map, (uint32_t)(i * 2654435761u)).a == (int)i && HMAPF_HAS(frozen_map, (uint32_t)(i * 2654435761u)));
+	for (i = 0; i != 3000; i++) CDS_ASSERT(HMAPF_IDX(frozen_map, HMAPF_KEY(frozen_map, i)) == (ptrdiff_t)i && frozen_map[i].a == HMAP_GET(map, HMAPF_KEY(frozen_map, i)).a);
+	CDS_ASSERT(!HMAPF_HAS(frozen_map, 12345) && HMAPF_IDX(frozen_map, 0) == -1 && HMAPF_GET(frozen_map, 12345).a == 0);
+	f = fopen("test_hmapf.bin", "wb");
+	CDS_ASSERT(f && HMAPF_SAVE(frozen_map, fileno(f)));
+	fclose(f);
+	HMAPF_MMAP(loaded_map, "test_hmapf.bin");
+	CDS_ASSERT(loaded_map && HMAPF_LEN(loaded_map) == 3000);
+	for (i = 1; i <= 3000; i++) CDS_ASSERT(HMAPF_GET(loaded_map, (uint32_t)(i * 2654435761u)).a == (int)i && HMAPF_IDX(loaded_map, (uint32_t)(i * 2654435761u)) == HMAPF_IDX(frozen_map, (uint32_t)(i * 2654435761u)));
+	CDS_ASSERT(!HMAPF_HAS(loaded_map, 12345) && test_writecrashes(&loaded_map[0]));
+	HMAPF_UNMAP(loaded_map);
+	CDS_ASSERT(loaded_map == NULL && HMAPF_MMAP(wrong_map, "test_hmapf.bin") == NULL && HMAP_MMAP(loaded_map, "test_hmapf.bin") == NULL);
+	remove("test_hmapf.bin");
+	HMAPF_FREE(frozen_map);
+	CDS_ASSERT(frozen_map == NULL && arena_allocs == 1);
+	HMAP_FREEZE(frozen_map, empty_map);
+	CDS_ASSERT(frozen_map && HMAPF_LEN(frozen_map) == 0 && !HMAPF_HAS(frozen_map, 1) && HMAPF_GET(frozen_map, 1).a == 0);
+	HMAPF_FREE(frozen_map);
+
+	/* Release memory after removing most keys: */
+	for (i = 11; i <= 3000; i++) CDS_ASSERT(HMAP_DEL(map, (uint32_t)(i * 2654435761u)));
+	cap = HMAP_CAP(map);
+	HMAP_SHRINK(map);
+	CDS_ASSERT(cap >= 4096 && arena_allocs == 1 && HMAP_LEN(map) == 10 && HMAP_CAP(map) == 32 && ((size_t)&HMAP_KEY(map, 0) & 63) == 0);
+	for (i = 1; i <= 3000; i++) CDS_ASSERT(i <= 10 ? HMAP_GET(map, (uint32_t)(i * 2654435761u)).a == (int)i : !HMAP_HAS(map, (uint32_t)(i * 2654435761u)));
+	HMAP_SHRINK(map);
+	CDS_ASSERT(arena_allocs == 1 && HMAP_CAP(map) == 32);
+	HMAP_SHRINK(empty_map);
+	CDS_ASSERT(empty_map == NULL);
+
+	/* A long probe chain across the end of the table: */
+	HMAP_FIT(chain_map, 100);
+	CDS_ASSERT(HMAP_CAP(chain_map) == 256);
+	for (i = 0, chain_key = 0; i != 20; i++) { chain_keys[i] = chain_key = test_hmap_keyat(chain_map, 250, chain_key); HMAP_PTR(chain_map, chain_keys[i])->a = (int)i; }
+	for (i = 0; i != 20; i++) CDS_ASSERT(HMAP_GET(chain_map, chain_keys[i]).a == (int)i && HMAP_IDX(chain_map, chain_keys[i]) == (ptrdiff_t)((250 + i) & 255));
+	CDS_ASSERT(!HMAP_HAS(chain_map, test_hmap_keyat(chain_map, 250, chain_key)) && !HMAP_HAS(chain_map, test_hmap_keyat(chain_map, 2, 0)));
+	for (i = 0; i < 20; i += 3) CDS_ASSERT(HMAP_DEL(chain_map, chain_keys[i]));
+	for (i = 0; i != 20; i++) CDS_ASSERT(i % 3 ? HMAP_GET(chain_map, chain_keys[i]).a == (int)i : !HMAP_HAS(chain_map, chain_keys[i]));
+	CDS_ASSERT(HMAP_LEN(chain_map) == 13 && HMAP_IDX(chain_map, chain_keys[19]) == (ptrdiff_t)((250 + 12) & 255));
+	HMAP_FREE(chain_map);
+
+	/* Statistics (with keys picked by their home slot in 256 slots, shrinking keeps the seed of the map): */
+	HMAP_STATS(stats_map, &stats);
+	CDS_ASSERT(stats.lookups == 0 && stats.len == 0 && stats.cap == 0 && stats.probe_hist[0] == 0);
+	HMAP_FIT(stats_map, 100);
+	CDS_ASSERT(HMAP_CAP(stats_map) == 256);
+	for (i = 1; i <= 150; i++) stats_keys[i] = test_hmap_keyat(stats_map, i, 0);
+	for (i = 0; i != 3; i++) stats_zero[i] = test_hmap_keyat(stats_map, 0, (i ? stats_zero[i - 1] : 0));
+	HMAP_SHRINK(stats_map);
+	HMAP_RESETSTATS(stats_map);
+	CDS_ASSERT(HMAP_CAP(stats_map) == 16 && HMAP_HOME(stats_map, stats_keys[150]) == (150 & 15));
+	for (i = 1; i <= 100; i++) HMAP_SET(stats_map, stats_keys[i], some_element);
+	HMAP_STATS(stats_map, &stats);
+	CDS_ASSERT(stats.lookups == 100 && stats.hits == 0 && stats.misses == 100 && stats.probes == 100 && stats.inserts == 100 && stats.insert_shifts == 0);
+	CDS_ASSERT(stats.grows == 4 && stats.grow_bytes == 120 * (sizeof(uint32_t) + sizeof(mytype_t)) && stats.len == 100 && stats.cap == 256);
+	CDS_ASSERT(stats.max_probe == 0 && stats.max_cluster == 100 && stats.probe_hist[0] == 100);
+	for (i = 1; i <= 150; i++) CDS_ASSERT(HMAP_HAS(stats_map, stats_keys[i]) == (i <= 100));
+	HMAP_SET(stats_map, stats_zero[0], some_element);
+	HMAP_SET(stats_map, stats_zero[1], some_element);
+	HMAP_SET(stats_map, stats_zero[2], some_element);
+	HMAP_STATS(stats_map, &stats);
+	CDS_ASSERT(stats.lookups == 253 && stats.hits == 100 && stats.misses == 153 && stats.probes == 256 && stats.inserts == 103 && stats.insert_shifts == 200);
+	CDS_ASSERT(stats.max_probe == 2 && stats.max_cluster == 103 && stats.probe_hist[0] == 1 && stats.probe_hist[1] == 1 && stats.probe_hist[2] == 101);
+	CDS_ASSERT(HMAP_DEL(stats_map, stats_zero[1]));
+	HMAP_STATS(stats_map, &stats);
+	CDS_ASSERT(stats.deletes == 1 && stats.delete_shifts == 101 && stats.max_probe == 1 && stats.max_cluster == 102 && stats.probe_hist[1] == 101);
+	HMAP_RESETSTATS(stats_map);
+	HMAP_STATS(stats_map, &stats);
+	CDS_ASSERT(stats.lookups == 0 && stats.deletes == 0 && stats.grows == 0 && stats.len == 102 && stats.probe_hist[1] == 101);
+	HMAP_FREE(stats_map);
+
+	/* Keys which only differ in their high bits still spread over all slots, every map has its own seed: */
+	for (i = 1; i <= 5000; i++) HMAP_SET(stats_map, (uint32_t)(i << 16), some_element);
+	HMAP_STATS(stats_map, &stats);
+	CDS_ASSERT(stats.len == 5000 && stats.cap == 16384 && stats.max_probe < 32 && stats.max_cluster < 128 && stats.probe_hist[0] > 3750);
+	HMAP_FIT(empty_map, 5000);
+	for (i = 1, cap = 0; i <= 16; i++) cap += (HMAP_HOME(empty_map, (uint32_t)(i << 16)) != HMAP_HOME(stats_map, (uint32_t)(i << 16)));
+	CDS_ASSERT(HMAP_CAP(empty_map) == 16384 && cap != 0);
+	HMAP_FREE(empty_map);
+	CDS_ASSERT(HMAP_HOME(empty_map, 1) == 0);
+	HMAP_FREE(stats_map);
+
+	/* Sets without values: */
+	test_allocs_before = test_allocs;
+	CDS_ASSERT(HSET_LEN(set) == 0 && HSET_CAP(set) == 0 && !HSET_HAS(set, 1) && !HSET_DEL(set, 1));
+	for (i = 1; i <= 1000; i++) CDS_ASSERT(HSET_ADD(set, ((uint32_t)(i * 2654435761u))));
+	CDS_ASSERT(!HSET_ADD(set, ((uint32_t)(1 * 2654435761u))) && HSET_LEN(set) == 1000 && HSET_CAP(set) == 2048);
+	for (i = 500; i <= 1500; i++) HSET_ADD(other_set, ((uint32_t)(i * 2654435761u)));
+	for (i = 1; i <= 1000; i += 2) CDS_ASSERT(HSET_DEL(set, ((uint32_t)(i * 2654435761u))));
+	CDS_ASSERT(HSET_LEN(set) == 500 && !HSET_DEL(set, ((uint32_t)(1 * 2654435761u))));
+	for (i = 1; i <= 2000; i++) CDS_ASSERT(HSET_HAS(set, ((uint32_t)(i * 2654435761u))) == (i <= 1000 && !(i & 1)));
+	for (it_found_count = 0, i = 0; i != HSET_CAP(set); i++) if (HSET_KEY(set, i)) it_found_count++;
+	CDS_ASSERT(it_found_count == 500);
+	HSET_INTERSECT(set, other_set);
+	CDS_ASSERT(HSET_LEN(set) == 251);
+	for (i = 1; i <= 2000; i++) CDS_ASSERT(HSET_HAS(set, ((uint32_t)(i * 2654435761u))) == (i >= 500 && i <= 1000 && !(i & 1)));
+	HSET_UNION(set, other_set);
+	CDS_ASSERT(HSET_LEN(set) == 1001 && HSET_LEN(other_set) == 1001);
+	for (i = 1; i <= 2000; i++) CDS_ASSERT(HSET_HAS(set, ((uint32_t)(i * 2654435761u))) == (i >= 500 && i <= 1500));
+	HSET_FREE(set);
+	HSET_UNION(set, other_set);
+	CDS_ASSERT(HSET_LEN(set) == 1001 && HSET_HAS(set, ((uint32_t)(1500 * 2654435761u))));
+	HSET_INTERSECT(set, (uint32_t*)NULL);
+	CDS_ASSERT(set && HSET_LEN(set) == 0 && !HSET_HAS(set, ((uint32_t)(1500 * 2654435761u))));
+	HSET_ADD(set, ((uint32_t)(7 * 2654435761u)));
+	HSET_SHRINK(set);
+	CDS_ASSERT(HSET_LEN(set) == 1 && HSET_CAP(set) == 16 && HSET_HAS(set, ((uint32_t)(7 * 2654435761u))));
+	HSET_CLEAR(set);
+	CDS_ASSERT(HSET_LEN(set) == 0 && HSET_CAP(set) == 16 && !HSET_HAS(set, ((uint32_t)(7 * 2654435761u))));
+	CDS_ASSERT(HSET_TRYFIT(set, 100) && HSET_CAP(set) == 256);
+	HSET_FREE(set);
+	HSET_FREE(other_set);
+	CDS_ASSERT(set == NULL && other_set == NULL && test_allocs == test_allocs_before);
+
 	/* Filtered string keys: */
 	HMAP_SET(map, hash_nocase_nospace("TEST A"), some_element);
 	CDS_ASSERT(HMAP_IDX(map, hash_nocase_nospace("TEST A")) == HMAP_IDX(map, hash_nocase_nospace("testa")));
 	CDS_ASSERT(HMAP_IDX(map, hash_nocase_nospace("TEST A")) != HMAP_IDX(map, hash_nocase_nospace("TEST B")));
 
 	HMAP_FREE(map);
+	CDS_ASSERT(arena_allocs == 0);
 }
 
 static void test_hmap64()
@@ -239,8 +1028,19 @@ static void test_hmap64()
 	mytype_t map_null = { -1, -1, -1 };
 	mytype_t* p_elem;
 	int has_foo, has_baz, removed, removed_again, it_found_count, ran_out_of_memory;
-	size_t i, cap;
+	size_t i, cap, arena_allocs = 0;
 	ptrdiff_t idx_foo, idx_invalid;
+	uint64_t batch_keys[600];
+	mytype_t batch_vals[600], *empty_map = NULL;
+	ptrdiff_t batch_idx[600];
+	mytype_t* loaded_map = NULL, *frozen_map = NULL;
+	uint64_t *set = NULL, *other_set = NULL;
+	mytype_t* stats_map = NULL;
+	uint64_t stats_keys[151], stats_zero[3], cluster_keys[101];
+	struct hmap_stats stats;
+	size_t test_allocs_before;
+	int* wrong_map = NULL;
+	FILE* f;
 
 	/* Set 2 elements with string keys and mytype_t values: */
 	HMAP64_SET_STR(map, "foo", some_element);
@@ -267,6 +1067,15 @@ static void test_hmap64()
 	p_elem->a = 123;
 	CDS_ASSERT(HMAP64_GET_STR(map, "qux").a == 123);
 
+	/* Keys of arbitrary bytes (may contain zeros), hashed over their length: */
+	HMAP64_SET_BYTES(map, "a\0b", 3, other_element);
+	CDS_ASSERT(HMAP64_HAS_BYTES(map, "a\0b", 3) && !HMAP64_HAS_BYTES(map, "a\0c", 3) && !HMAP64_HAS_BYTES(map, "a", 1));
+	CDS_ASSERT(HMAP64_GET_BYTES(map, "a\0b", 3).a == 500 && HMAP64_IDX_BYTES(map, "a\0b", 3) >= 0);
+	CDS_ASSERT(hash64_bytes("0123456789abcdefghijklmnopqrstuvwxyz0123456789ABCDEFGHIJ", 56) != hash64_bytes("0123456789abcdefghijklmnopqrstuvwxyz0123456789ABCDEFGHIK", 56));
+	CDS_ASSERT(HMAP64_PTR_BYTES(map, "a\0b", 3)->b == 10);
+	CDS_ASSERT(HMAP64_DEL_BYTES(map, "a\0b", 3) && !HMAP64_HAS_BYTES(map, "a\0b", 3));
+	CDS_ASSERT(hash64_bytes("", 0) != 0);
+
 	/* Looking up an index of a key: */
 	idx_foo = HMAP64_IDX_STR(map, "foo");
 	idx_invalid = HMAP64_IDX_STR(map, "invalid");
@@ -323,18 +1132,1133 @@ static void test_hmap64()
 	CDS_ASSERT(HMAP64_LEN(map) == 0);
 	CDS_ASSERT(HMAP64_CAP(map) == 2048);
 
+	/* Set a maximum load factor: */
 	HMAP64_FREE(map);
+	HMAP64_SETLOADFACTOR(map, 0.875);
+	HMAP64_FIT(map, 100);
+	CDS_ASSERT(HMAP64_CAP(map) == 128);
+	for (i = 1; i <= 100; i++) cluster_keys[i] = test_hmap64_keyat(map, 120, (i > 1 ? cluster_keys[i - 1] : 0));
+	for (i = 1; i <= 100; i++) HMAP64_PTR(map, cluster_keys[i])->a = (int)i; /* all in one cluster wrapping around the end */
+	CDS_ASSERT(HMAP64_LEN(map) == 100);
+	CDS_ASSERT(HMAP64_CAP(map) == 128);
+	for (i = 1; i <= 100; i += 2) CDS_ASSERT(HMAP64_DEL(map, cluster_keys[i]));
+	CDS_ASSERT(HMAP64_LEN(map) == 50);
+	for (i = 1; i <= 100; i++) CDS_ASSERT(HMAP64_HAS(map, cluster_keys[i]) == !(i & 1) && (i & 1 || HMAP64_GET(map, cluster_keys[i]).a == (int)i));
+
+	/* Spread the rehashing when growing: */
+	HMAP64_FREE(map);
+	HMAP64_SETINCREMENTAL(map, 1);
+	for (i = 1; i <= 1000; i++)
+	{
+		HMAP64_PTR(map, (uint64_t)i * (uint64_t)0x9E3779B97F4A7C15)->a = (int)i;
+		CDS_ASSERT(HMAP64_LEN(map) == i && HMAP64_GET(map, (uint64_t)((i + 1) / 2) * (uint64_t)0x9E3779B97F4A7C15).a == (int)((i + 1) / 2));
+		if (i % 3 != 0) continue;
+		CDS_ASSERT(HMAP64_DEL(map, (uint64_t)(i - 1) * (uint64_t)0x9E3779B97F4A7C15) && HMAP64_LEN(map) == i - 1 && !HMAP64_HAS(map, (uint64_t)(i - 1) * (uint64_t)0x9E3779B97F4A7C15));
+		HMAP64_PTR(map, (uint64_t)(i - 1) * (uint64_t)0x9E3779B97F4A7C15)->a = (int)(i - 1);
+	}
+	HMAP64_FINISHGROW(map);
+	CDS_ASSERT(HMAP64_LEN(map) == 1000);
+	for (i = 0, it_found_count = 0, cap = HMAP64_CAP(map); i != cap; i++)
+		if (HMAP64_KEY(map, i)) { it_found_count++; CDS_ASSERT(HMAP64_KEY(map, i) == (uint64_t)map[i].a * (uint64_t)0x9E3779B97F4A7C15); }
+	CDS_ASSERT(it_found_count == 1000);
+
+	/* Look up and set keys in batches: */
+	for (i = 0; i != 600; i++) { batch_keys[i] = (uint64_t)(i + 701) * (uint64_t)0x9E3779B97F4A7C15; batch_vals[i] = other_element; batch_vals[i].a = (int)(i + 701); }
+	CDS_ASSERT(HMAP64_GET_BATCH(empty_map, batch_keys, 600, batch_idx) == 0 && batch_idx[0] == -1 && batch_idx[599] == -1);
+	CDS_ASSERT(HMAP64_GET_BATCH(map, batch_keys, 600, batch_idx) == 300);
+	for (i = 0; i != 600; i++) CDS_ASSERT(i < 300 ? map[batch_idx[i]].a == (int)(i + 701) : batch_idx[i] == -1);
+	HMAP64_SET_BATCH(map, batch_keys, 600, batch_vals);
+	CDS_ASSERT(HMAP64_LEN(map) == 1300 && HMAP64_GET_BATCH(map, batch_keys, 600, batch_idx) == 600);
+	for (i = 0; i != 600; i++) CDS_ASSERT(map[batch_idx[i]].a == (int)(i + 701) && map[batch_idx[i]].b == 10);
+	HMAP64_SET_BATCH(empty_map, batch_keys, 600, batch_vals);
+	CDS_ASSERT(HMAP64_LEN(empty_map) == 600 && HMAP64_GET(empty_map, batch_keys[599]).a == 1300);
+	HMAP64_FREE(empty_map);
+	for (i = 300; i != 600; i++) CDS_ASSERT(HMAP64_DEL(map, batch_keys[i]));
+
+	/* Set large arrays at once and merge maps: */
+	{
+		mytype_t *built = NULL, *ref = NULL, *merged = NULL, *small = NULL, *same = NULL, *none = NULL;
+		uint64_t* bkeys = (uint64_t*)malloc(200000 * sizeof(uint64_t)), k;
+		mytype_t* bvals = (mytype_t*)malloc(200000 * sizeof(mytype_t));
+		size_t* pick = (size_t*)malloc((131072 + 16000) * sizeof(size_t));
+		size_t n, j;
+		CDS_ASSERT(bkeys && bvals && pick);
+		for (i = 0; i != 200000; i++) { bkeys[i] = (uint64_t)((i % 150000) * (uint64_t)0x9E3779B97F4A7C15); bvals[i] = other_element; bvals[i].a = (int)i; }
+		HMAP64_BUILD(built, bkeys, bvals, 200000, 4);
+		CDS_ASSERT(HMAP64_LEN(built) == 149999 && HMAP64_GET(built, 0).a == 0);
+		for (i = 1, n = 0; i != 150000; i++) n += (HMAP64_GET(built, bkeys[i]).a == (int)(i < 50000 ? i + 150000 : i));
+		CDS_ASSERT(n == 149999);
+		for (i = 0, n = 0, cap = HMAP64_CAP(built); i != cap; i++) if (HMAP64_KEY(built, i)) n += (HMAP64_IDX(built, HMAP64_KEY(built, i)) == (ptrdiff_t)i);
+		CDS_ASSERT(n == 149999);
+		HMAP64_FREE(built);
+		HMAP64_BUILD(built, bkeys, bvals, 1000, 1);
+		CDS_ASSERT(HMAP64_LEN(built) == 999 && HMAP64_GET(built, bkeys[999]).a == 999);
+		HMAP64_BUILD(built, bkeys, bvals, 0, 1);
+		CDS_ASSERT(HMAP64_LEN(built) == 999);
+		HMAP64_FREE(built);
+
+		/* clusters across the end of a region and the end of the table, the first keys are picked by their home slot */
+		HMAP64_SETLOADFACTOR(built, 0.9375);
+		HMAP64_FIT(built, 100000);
+		CDS_ASSERT(HMAP64_CAP(built) == 131072);
+		memset(pick, 0, 131072 * sizeof(size_t));
+		for (i = 16000; i--;)
+		{
+			size_t home = (i < 10000 ? 65536 - 5000 : 131072 - 3000) + i % 5000 % 3000;
+			pick[131072 + i] = pick[home];
+			pick[home] = i + 1;
+		}
+		for (k = 1 << 20, n = 16000; n;) /* above the keys of small below */
+		{
+			size_t home = HMAP64_HOME(built, ++k);
+			if (!pick[home]) continue;
+			i = pick[home] - 1;
+			pick[home] = pick[131072 + i];
+			bkeys[i] = k;
+			n--;
+		}
+		for (i = 0; i != 100000; i++)
+		{
+			if (i >= 16000) bkeys[i] = (uint64_t)(i * (uint64_t)0x9E3779B97F4A7C15);
+			bvals[i].a = (int)i;
+			HMAP64_SET(ref, bkeys[i], bvals[i]);
+		}
+		HMAP64_BUILD(built, bkeys, bvals, 100000, 4);
+		CDS_ASSERT(HMAP64_CAP(built) == 131072 && HMAP64_LEN(built) == HMAP64_LEN(ref));
+		for (i = 0, n = 0; i != 100000; i++) n += (HMAP64_GET(built, bkeys[i]).a == HMAP64_GET(ref, bkeys[i]).a);
+		CDS_ASSERT(n == 100000);
+		for (i = 0, n = 0, cap = HMAP64_CAP(built); i != cap; i++) if (HMAP64_KEY(built, i)) n += (HMAP64_IDX(built, HMAP64_KEY(built, i)) == (ptrdiff_t)i);
+		CDS_ASSERT(n == HMAP64_LEN(ref));
+
+		/* merging into nothing copies, merging what fits adds, merging into a smaller map makes a new table */
+		HMAP64_MERGE(merged, built);
+		CDS_ASSERT(HMAP64_LEN(merged) == HMAP64_LEN(ref) && HMAP64_GET(merged, bkeys[12345]).a == HMAP64_GET(ref, bkeys[12345]).a);
+		for (i = 0; i != 2000; i++) { bvals[i].a = -(int)i; HMAP64_SET(small, (uint64_t)(i < 1000 ? bkeys[i + 50000] : (i + 1) * 7), bvals[i]); }
+		HMAP64_MERGE(merged, small);
+		CDS_ASSERT(HMAP64_LEN(merged) == HMAP64_LEN(ref) + 1000 && HMAP64_GET(merged, bkeys[50000]).a == 0 && HMAP64_GET(merged, 7 * 1001).a == -1000);
+		HMAP64_MERGE(small, built);
+		CDS_ASSERT(HMAP64_LEN(small) == HMAP64_LEN(ref) + 1000 && HMAP64_CAP(small) >= HMAP64_CAP(built));
+		for (i = 0, n = 0; i != 100000; i++) n += (HMAP64_GET(small, bkeys[i]).a == HMAP64_GET(ref, bkeys[i]).a);
+		for (i = 1000, j = 0; i != 2000; i++) j += (HMAP64_GET(small, (uint64_t)((i + 1) * 7)).a == -(int)i);
+		CDS_ASSERT(n == 100000 && j == 1000);
+		for (i = 0, n = 0, cap = HMAP64_CAP(small); i != cap; i++) if (HMAP64_KEY(small, i)) n += (HMAP64_IDX(small, HMAP64_KEY(small, i)) == (ptrdiff_t)i);
+		CDS_ASSERT(n == HMAP64_LEN(small));
+		HMAP64_MERGE(small, none);
+		HMAP64_MERGE(small, small);
+		CDS_ASSERT(HMAP64_LEN(small) == HMAP64_LEN(ref) + 1000);
+
+		/* small had its own seed, with the seed of built (taken by merging into nothing and kept by shrinking) both get read in order */
+		HMAP64_MERGE(same, built);
+		HMAP64_CLEAR(same);
+		HMAP64_SHRINK(same);
+		for (i = 0; i != 2000; i++) HMAP64_SET(same, (uint64_t)(i < 1000 ? bkeys[i + 50000] : (i + 1) * 7), bvals[i]);
+		HMAP64_MERGE(same, built);
+		CDS_ASSERT(HMAP64_LEN(same) == HMAP64_LEN(small) && HMAP64_HOME(same, bkeys[777]) % HMAP64_CAP(built) == HMAP64_HOME(built, bkeys[777]));
+		for (i = 0, n = 0, cap = HMAP64_CAP(small); i != cap; i++) if (HMAP64_KEY(small, i)) n += (HMAP64_GET(same, HMAP64_KEY(small, i)).a == small[i].a);
+		CDS_ASSERT(n == HMAP64_LEN(small));
+		for (i = 0, n = 0, cap = HMAP64_CAP(same); i != cap; i++) if (HMAP64_KEY(same, i)) n += (HMAP64_IDX(same, HMAP64_KEY(same, i)) == (ptrdiff_t)i);
+		CDS_ASSERT(n == HMAP64_LEN(small));
+
+		HMAP64_FREE(built);
+		HMAP64_FREE(ref);
+		HMAP64_FREE(merged);
+		HMAP64_FREE(small);
+		HMAP64_FREE(same);
+		free(bkeys);
+		free(bvals);
+		free(pick);
+	}
+
+	/* Use a custom allocator: */
+	cap = HMAP64_CAP(map);
+	HMAP64_SETALLOC(map, &arena_allocs);
+	CDS_ASSERT(arena_allocs == 1 && HMAP64_CAP(map) == cap && HMAP64_LEN(map) == 1000 && HMAP64_GET(map, (uint64_t)500 * (uint64_t)0x9E3779B97F4A7C15).a == 500);
+	for (i = 1001; i <= 3000; i++) HMAP64_PTR(map, (uint64_t)i * (uint64_t)0x9E3779B97F4A7C15)->a = (int)i;
+	HMAP64_FINISHGROW(map);
+	CDS_ASSERT(arena_allocs == 1 && ((size_t)&HMAP64_KEY(map, 0) & 63) == 0 && HMAP64_LEN(map) == 3000 && HMAP64_GET(map, (uint64_t)2500 * (uint64_t)0x9E3779B97F4A7C15).a == 2500);
+
+	/* Save to a file and map it back: */
+	f = fopen("test_hmap64.bin", "wb");
+	CDS_ASSERT(f && HMAP64_SAVE(map, fileno(f)));
+	fclose(f);
+	HMAP64_MMAP(loaded_map, "test_hmap64.bin");
+	CDS_ASSERT(loaded_map && HMAP64_LEN(loaded_map) == 3000 && HMAP64_CAP(loaded_map) == HMAP64_CAP(map) && ((size_t)&HMAP64_KEY(loaded_map, 0) & 63) == 0);
+	for (i = 1; i <= 3000; i++) CDS_ASSERT(HMAP64_GET(loaded_map, (uint64_t)i * (uint64_t)0x9E3779B97F4A7C15).a == (int)i && HMAP64_IDX(loaded_map, (uint64_t)i * (uint64_t)0x9E3779B97F4A7C15) == HMAP64_IDX(map, (uint64_t)i * (uint64_t)0x9E3779B97F4A7C15));
+	CDS_ASSERT(!HMAP64_HAS(loaded_map, 12345) && HMAP64_HAS(loaded_map, (uint64_t)0x9E3779B97F4A7C15));
+	HMAP64_STATS(loaded_map, &stats);
+	CDS_ASSERT(stats.lookups == 6002 && stats.misses == 1 && stats.len == 3000);
+	CDS_ASSERT(test_writecrashes(&HMAP64_KEY(loaded_map, 0)) && test_writecrashes(HMAP64__HDR(loaded_map)) && test_writecrashes(&loaded_map[0]));
+	HMAP64_UNMAP(loaded_map);
+	CDS_ASSERT(loaded_map == NULL && HMAP64_MMAP(wrong_map, "test_hmap64.bin") == NULL && HMAP64_MMAP(loaded_map, "test_invalid.bin") == NULL);
+	remove("test_hmap64.bin");
+
+	/* Freeze into a minimal perfect hash table: */
+	HMAP64_FREEZE(frozen_map, map);
+	CDS_ASSERT(frozen_map && arena_allocs == 2 && HMAP64F_LEN(frozen_map) == 3000 && HMAP64_LEN(map) == 3000);
+	for (i = 1; i <= 3000; i++) CDS_ASSERT(HMAP64F_GET(frozen_map, (uint64_t)i * (uint64_t)0x9E3779B97F4A7C15).a == (int)i && HMAP64F_HAS(frozen_map, (uint64_t)i * (uint64_t)0x9E3779B97F4A7C15));
+	for (i = 0; i != 3000; i++) CDS_ASSERT(HMAP64F_IDX(frozen_map, HMAP64F_KEY(frozen_map, i)) == (ptrdiff_t)i && frozen_map[i].a == HMAP64_GET(map, HMAP64F_KEY(frozen_map, i)).a);
+	CDS_ASSERT(!HMAP64F_HAS(frozen_map, 12345) && HMAP64F_IDX(frozen_map, 0) == -1 && HMAP64F_GET(frozen_map, 12345).a == 0);
+	f = fopen("test_hmap64f.bin", "wb");
+	CDS_ASSERT(f && HMAP64F_SAVE(frozen_map, fileno(f)));
+	fclose(f);
+	HMAP64F_MMAP(loaded_map, "test_hmap64f.bin");
+	CDS_ASSERT(loaded_map && HMAP64F_LEN(loaded_map) == 3000);
+	for (i = 1; i <= 3000; i++) CDS_ASSERT(HMAP64F_GET(loaded_map, (uint64_t)i * (uint64_t)0x9E3779B97F4A7C15).a == (int)i && HMAP64F_IDX(loaded_map, (uint64_t)i * (uint64_t)0x9E3779B97F4A7C15) == HMAP64F_IDX(frozen_map, (uint64_t)i * (uint64_t)0x9E3779B97F4A7C15));
+	CDS_ASSERT(!HMAP64F_HAS(loaded_map, 12345));
+	HMAP64F_UNMAP(loaded_map);
+	CDS_ASSERT(loaded_map == NULL && HMAP64F_MMAP(wrong_map, "test_hmap64f.bin") == NULL && HMAP64_MMAP(loaded_map, "test_hmap64f.bin") == NULL);
+	remove("test_hmap64f.bin");
+	HMAP64F_FREE(frozen_map);
+	CDS_ASSERT(frozen_map == NULL && arena_allocs == 1);
+	HMAP64_FREEZE(frozen_map, empty_map);
+	CDS_ASSERT(frozen_map && HMAP64F_LEN(frozen_map) == 0 && !HMAP64F_HAS(frozen_map, 1) && HMAP64F_GET(frozen_map, 1).a == 0);
+	HMAP64F_FREE(frozen_map);
+
+	/* Release memory after removing most keys: */
+	for (i = 11; i <= 3000; i++) CDS_ASSERT(HMAP64_DEL(map, (uint64_t)i * (uint64_t)0x9E3779B97F4A7C15));
+	cap = HMAP64_CAP(map);
+	HMAP64_SHRINK(map);
+	CDS_ASSERT(cap >= 4096 && arena_allocs == 1 && HMAP64_LEN(map) == 10 && HMAP64_CAP(map) == 32 && ((size_t)&HMAP64_KEY(map, 0) & 63) == 0);
+	for (i = 1; i <= 3000; i++) CDS_ASSERT(i <= 10 ? HMAP64_GET(map, (uint64_t)i * (uint64_t)0x9E3779B97F4A7C15).a == (int)i : !HMAP64_HAS(map, (uint64_t)i * (uint64_t)0x9E3779B97F4A7C15));
+	HMAP64_SHRINK(map);
+	CDS_ASSERT(arena_allocs == 1 && HMAP64_CAP(map) == 32);
+	HMAP64_SHRINK(empty_map);
+	CDS_ASSERT(empty_map == NULL);
+
+	/* Statistics (with keys picked by their home slot in 256 slots, shrinking keeps the seed of the map): */
+	HMAP64_STATS(stats_map, &stats);
+	CDS_ASSERT(stats.lookups == 0 && stats.len == 0 && stats.cap == 0 && stats.probe_hist[0] == 0);
+	HMAP64_FIT(stats_map, 100);
+	CDS_ASSERT(HMAP64_CAP(stats_map) == 256);
+	for (i = 1; i <= 150; i++) stats_keys[i] = test_hmap64_keyat(stats_map, i, 0);
+	for (i = 0; i != 3; i++) stats_zero[i] = test_hmap64_keyat(stats_map, 0, (i ? stats_zero[i - 1] : 0));
+	HMAP64_SHRINK(stats_map);
+	HMAP64_RESETSTATS(stats_map);
+	CDS_ASSERT(HMAP64_CAP(stats_map) == 16 && HMAP64_HOME(stats_map, stats_keys[150]) == (150 & 15));
+	for (i = 1; i <= 100; i++) HMAP64_SET(stats_map, stats_keys[i], some_element);
+	HMAP64_STATS(stats_map, &stats);
+	CDS_ASSERT(stats.lookups == 100 && stats.hits == 0 && stats.misses == 100 && stats.probes == 100 && stats.inserts == 100 && stats.insert_shifts == 0);
+	CDS_ASSERT(stats.grows == 4 && stats.grow_bytes == 120 * (sizeof(uint64_t) + sizeof(mytype_t)) && stats.len == 100 && stats.cap == 256);
+	CDS_ASSERT(stats.max_probe == 0 && stats.max_cluster == 100 && stats.probe_hist[0] == 100);
+	for (i = 1; i <= 150; i++) CDS_ASSERT(HMAP64_HAS(stats_map, stats_keys[i]) == (i <= 100));
+	HMAP64_SET(stats_map, stats_zero[0], some_element);
+	HMAP64_SET(stats_map, stats_zero[1], some_element);
+	HMAP64_SET(stats_map, stats_zero[2], some_element);
+	HMAP64_STATS(stats_map, &stats);
+	CDS_ASSERT(stats.lookups == 253 && stats.hits == 100 && stats.misses == 153 && stats.probes == 256 && stats.inserts == 103 && stats.insert_shifts == 200);
+	CDS_ASSERT(stats.max_probe == 2 && stats.max_cluster == 103 && stats.probe_hist[0] == 1 && stats.probe_hist[1] == 1 && stats.probe_hist[2] == 101);
+	CDS_ASSERT(HMAP64_DEL(stats_map, stats_zero[1]));
+	HMAP64_STATS(stats_map, &stats);
+	CDS_ASSERT(stats.deletes == 1 && stats.delete_shifts == 101 && stats.max_probe == 1 && stats.max_cluster == 102 && stats.probe_hist[1] == 101);
+	HMAP64_RESETSTATS(stats_map);
+	HMAP64_STATS(stats_map, &stats);
+	CDS_ASSERT(stats.lookups == 0 && stats.deletes == 0 && stats.grows == 0 && stats.len == 102 && stats.probe_hist[1] == 101);
+	HMAP64_FREE(stats_map);
+
+	/* Keys which only differ in their high bits still spread over all slots, every map has its own seed: */
+	for (i = 1; i <= 5000; i++) HMAP64_SET(stats_map, (uint64_t)i << 40, some_element);
+	HMAP64_STATS(stats_map, &stats);
+	CDS_ASSERT(stats.len == 5000 && stats.cap == 16384 && stats.max_probe < 32 && stats.max_cluster < 128 && stats.probe_hist[0] > 3750);
+	HMAP64_FIT(empty_map, 5000);
+	for (i = 1, cap = 0; i <= 16; i++) cap += (HMAP64_HOME(empty_map, (uint64_t)i << 40) != HMAP64_HOME(stats_map, (uint64_t)i << 40));
+	CDS_ASSERT(HMAP64_CAP(empty_map) == 16384 && cap != 0);
+	HMAP64_FREE(empty_map);
+	CDS_ASSERT(HMAP64_HOME(empty_map, 1) == 0);
+	HMAP64_FREE(stats_map);
+
+	/* Sets without values: */
+	test_allocs_before = test_allocs;
+	CDS_ASSERT(HSET64_LEN(set) == 0 && HSET64_CAP(set) == 0 && !HSET64_HAS(set, 1) && !HSET64_DEL(set, 1));
+	for (i = 1; i <= 1000; i++) CDS_ASSERT(HSET64_ADD(set, ((uint64_t)i * (uint64_t)0x9E3779B97F4A7C15)));
+	CDS_ASSERT(!HSET64_ADD(set, ((uint64_t)1 * (uint64_t)0x9E3779B97F4A7C15)) && HSET64_LEN(set) == 1000 && HSET64_CAP(set) == 2048);
+	for (i = 500; i <= 1500; i++) HSET64_ADD(other_set, ((uint64_t)i * (uint64_t)0x9E3779B97F4A7C15));
+	for (i = 1; i <= 1000; i += 2) CDS_ASSERT(HSET64_DEL(set, ((uint64_t)i * (uint64_t)0x9E3779B97F4A7C15)));
+	CDS_ASSERT(HSET64_LEN(set) == 500 && !HSET64_DEL(set, ((uint64_t)1 * (uint64_t)0x9E3779B97F4A7C15)));
+	for (i = 1; i <= 2000; i++) CDS_ASSERT(HSET64_HAS(set, ((uint64_t)i * (uint64_t)0x9E3779B97F4A7C15)) == (i <= 1000 && !(i & 1)));
+	for (it_found_count = 0, i = 0; i != HSET64_CAP(set); i++) if (HSET64_KEY(set, i)) it_found_count++;
+	CDS_ASSERT(it_found_count == 500);
+	HSET64_INTERSECT(set, other_set);
+	CDS_ASSERT(HSET64_LEN(set) == 251);
+	for (i = 1; i <= 2000; i++) CDS_ASSERT(HSET64_HAS(set, ((uint64_t)i * (uint64_t)0x9E3779B97F4A7C15)) == (i >= 500 && i <= 1000 && !(i & 1)));
+	HSET64_UNION(set, other_set);
+	CDS_ASSERT(HSET64_LEN(set) == 1001 && HSET64_LEN(other_set) == 1001);
+	for (i = 1; i <= 2000; i++) CDS_ASSERT(HSET64_HAS(set, ((uint64_t)i * (uint64_t)0x9E3779B97F4A7C15)) == (i >= 500 && i <= 1500));
+	HSET64_FREE(set);
+	HSET64_UNION(set, other_set);
+	CDS_ASSERT(HSET64_LEN(set) == 1001 && HSET64_HAS(set, ((uint64_t)1500 * (uint64_t)0x9E3779B97F4A7C15)));
+	HSET64_INTERSECT(set, (uint64_t*)NULL);
+	CDS_ASSERT(set && HSET64_LEN(set) == 0 && !HSET64_HAS(set, ((uint64_t)1500 * (uint64_t)0x9E3779B97F4A7C15)));
+	HSET64_ADD(set, ((uint64_t)7 * (uint64_t)0x9E3779B97F4A7C15));
+	HSET64_SHRINK(set);
+	CDS_ASSERT(HSET64_LEN(set) == 1 && HSET64_CAP(set) == 16 && HSET64_HAS(set, ((uint64_t)7 * (uint64_t)0x9E3779B97F4A7C15)));
+	HSET64_CLEAR(set);
+	CDS_ASSERT(HSET64_LEN(set) == 0 && HSET64_CAP(set) == 16 && !HSET64_HAS(set, ((uint64_t)7 * (uint64_t)0x9E3779B97F4A7C15)));
+	CDS_ASSERT(HSET64_TRYFIT(set, 100) && HSET64_CAP(set) == 256);
+	HSET64_FREE(set);
+	HSET64_FREE(other_set);
+	CDS_ASSERT(set == NULL && other_set == NULL && test_allocs == test_allocs_before);
+
+	HMAP64_FREE(map);
+	CDS_ASSERT(arena_allocs == 0);
+}
+
+static void test_hmapbloom()
+{
+	int *map = NULL, *plain = NULL, *other = NULL, **shmap = NULL, vals[1000];
+	uint64_t* map64 = NULL;
+	uint32_t i, keys[1000];
+	ptrdiff_t idx[1000];
+	size_t s, passed = 0, arena_allocs = 0;
+	struct hmap_stats stats;
+
+	/* The filter is made for the maxload of the table and follows it when growing: */
+	CDS_ASSERT(HMAP_SETBLOOM(map, 12) && HMAP_CAP(map) == 16 && HMAP__HDR(map)->bloom && BLOOM_CAP(HMAP__HDR(map)->bloom) == 8 && test_allocs == 2);
+	for (i = 1; i <= 20000; i++)
+	{
+		HMAP_SET(map, i * 2, (int)i);
+		HMAP_SET(plain, i * 2, (int)i);
+	}
+	CDS_ASSERT(HMAP_LEN(map) == 20000 && HMAP_CAP(map) == 65536 && BLOOM_CAP(HMAP__HDR(map)->bloom) == 32768 && test_allocs == 3);
+	for (i = 1; i <= 40000; i++)
+		CDS_ASSERT(HMAP_HAS(map, i) == HMAP_HAS(plain, i) && HMAP_GET(map, i) == HMAP_GET(plain, i));
+
+	/* Misses are mostly answered without probing the table: */
+	HMAP_RESETSTATS(map);
+	for (i = 1; i <= 20000; i++)
+		CDS_ASSERT(!HMAP_HAS(map, i * 2 + 40001) && HMAP_IDX(map, i * 2 + 40001) == -1);
+	HMAP_STATS(map, &stats);
+	CDS_ASSERT(stats.lookups == 40000 && stats.misses == 40000 && stats.probes < 1000);
+	for (i = 0; i != 1000; i++)
+		keys[i] = i * 7;
+	HMAP_RESETSTATS(map);
+	s = HMAP_GET_BATCH(map, keys, 1000, idx);
+	HMAP_STATS(map, &stats);
+	CDS_ASSERT(s == HMAP_GET_BATCH(plain, keys, 1000, idx) && stats.lookups == 1000 && stats.hits == s && stats.misses == 1000 - s);
+	HMAP_GET_BATCH(map, keys, 1000, idx);
+	for (i = 0; i != 1000; i++)
+		CDS_ASSERT(idx[i] == HMAP_IDX(map, keys[i]) && (idx[i] == -1 ? !HMAP_HAS(plain, keys[i]) : map[idx[i]] == HMAP_GET(plain, keys[i])));
+
+	/* Deletes make the filter again after a quarter of the maxload: */
+	for (i = 1; i <= 10000; i++)
+		CDS_ASSERT(HMAP_DEL(map, i * 2) && HMAP_DEL(plain, i * 2));
+	CDS_ASSERT(HMAP_LEN(map) == 10000 && HMAP__HDR(map)->bloomstale == 10000 - 8192 && BLOOM_LEN(HMAP__HDR(map)->bloom) == 20000 - 8192 && test_allocs == 3);
+	for (i = 1; i <= 8000; i++)
+		passed += bloom__has(HMAP__HDR(map)->bloom, i * 2);
+	CDS_ASSERT(passed < 100);
+	for (i = 1; i <= 40000; i++)
+		CDS_ASSERT(HMAP_HAS(map, i) == HMAP_HAS(plain, i) && HMAP_GET(map, i) == HMAP_GET(plain, i));
+
+	/* Incremental growing, merging and building keep all keys in the filter: */
+	HMAP_SETINCREMENTAL(map, 1);
+	for (i = 40001; i <= 70000; i++)
+	{
+		HMAP_SET(map, i, (int)i);
+		HMAP_SET(plain, i, (int)i);
+		CDS_ASSERT(HMAP_HAS(map, i - 20000) == HMAP_HAS(plain, i - 20000));
+	}
+	for (i = 1; i <= 100; i++)
+		HMAP_SET(other, i * 1000003, (int)i);
+	HMAP_MERGE(map, other);
+	HMAP_MERGE(plain, other);
+	for (i = 0; i != 1000; i++)
+	{
+		keys[i] = i * 3 + 100000;
+		vals[i] = (int)i;
+	}
+	HMAP_BUILD(map, keys, vals, 1000, 1);
+	HMAP_BUILD(plain, keys, vals, 1000, 1);
+	for (i = 1; i <= 50000; i++)
+		HMAP_SET(other, i * 5 + 200000, (int)i);
+	HMAP_MERGE(map, other);
+	HMAP_MERGE(plain, other);
+	CDS_ASSERT(HMAP_LEN(map) == HMAP_LEN(plain) && HMAP_LEN(map) == 10000 + 30000 + 100 + 1000 + 50000);
+	for (i = 1; i <= 500000; i++)
+		CDS_ASSERT(HMAP_HAS(map, i) == HMAP_HAS(plain, i) && HMAP_GET(map, i) == HMAP_GET(plain, i));
+	CDS_ASSERT(HMAP_HAS(map, 100 * 1000003) && BLOOM_CAP(HMAP__HDR(map)->bloom) == HMAP__HDR(map)->maxload + 1);
+
+	/* The filter moves with the map to another allocator, clearing keeps it and setting 0 drops it: */
+	HMAP_SETALLOC(map, &arena_allocs);
+	CDS_ASSERT(arena_allocs == 2 && test_allocs == 2 && HMAP_HAS(map, 100 * 1000003) && !HMAP_HAS(map, 500001));
+	HMAP_CLEAR(map);
+	CDS_ASSERT(HMAP_LEN(map) == 0 && !HMAP_HAS(map, 100 * 1000003) && HMAP__HDR(map)->bloom && arena_allocs == 2);
+	CDS_ASSERT(HMAP_SETBLOOM(map, 0) && !HMAP__HDR(map)->bloom && arena_allocs == 1);
+	HMAP_SET(map, 5, 5);
+	CDS_ASSERT(HMAP_SETBLOOM(map, 16) && HMAP_HAS(map, 5) && !HMAP_HAS(map, 6) && arena_allocs == 2);
+	HMAP_FREE(map);
+	HMAP_FREE(plain);
+	HMAP_FREE(other);
+	CDS_ASSERT(arena_allocs == 0 && test_allocs == 0);
+
+	/* The same for 64-bit keys: */
+	CDS_ASSERT(HMAP64_SETBLOOM(map64, 12) && test_allocs == 2);
+	for (i = 1; i <= 10000; i++)
+		HMAP64_SET(map64, (uint64_t)i << 40, (uint64_t)i);
+	for (i = 1; i <= 10000; i++)
+		CDS_ASSERT(HMAP64_GET(map64, (uint64_t)i << 40) == i && !HMAP64_HAS(map64, ((uint64_t)i << 40) + 1));
+	for (i = 1; i <= 10000; i += 2)
+		CDS_ASSERT(HMAP64_DEL(map64, (uint64_t)i << 40));
+	for (i = 1; i <= 10000; i++)
+		CDS_ASSERT(HMAP64_HAS(map64, (uint64_t)i << 40) == !(i & 1));
+	HMAP64_FREE(map64);
+	CDS_ASSERT(map64 == NULL && test_allocs == 0);
+
+	/* Shards of a TinyHashMapSH can have a filter each, freeing the sharded map frees them: */
+	HMAPSH_INIT(shmap, 4);
+	for (s = 0; s != HMAPSH_SHARDS(shmap); s++)
+	{
+		HMAPSH_LOCKAT(shmap, s);
+		CDS_ASSERT(HMAP64_SETBLOOM(HMAPSH_AT(shmap, s), 12) && HMAP64__HDR(HMAPSH_AT(shmap, s))->bloom);
+		HMAPSH_UNLOCKAT(shmap, s);
+	}
+	CDS_ASSERT(test_allocs == 1 + 2 * 4);
+	for (i = 1; i <= 10000; i++)
+		HMAPSH_SET(shmap, (uint64_t)i * (uint64_t)0x9E3779B97F4A7C15, (int)i);
+	for (i = 1; i <= 10000; i++)
+		CDS_ASSERT(HMAPSH_GET(shmap, (uint64_t)i * (uint64_t)0x9E3779B97F4A7C15, &vals[0]) && vals[0] == (int)i && !HMAPSH_HAS(shmap, (uint64_t)(i + 10000) * (uint64_t)0x9E3779B97F4A7C15));
+	HMAPSH_FREE(shmap);
+	CDS_ASSERT(shmap == NULL && test_allocs == 0);
+}
+
+static void test_hmaps()
+{
+	mytype_t* map = NULL;
+	mytype_t some_element = { 1, 2, 3 };
+	mytype_t other_element = { 500, 10, 99 };
+	mytype_t map_null = { -1, -1, -1 };
+	static char names[1000][8];
+	int it_found_count;
+	size_t i, cap, arena_allocs = 0;
+	ptrdiff_t idx_foo;
+
+	/* Set 2 elements with string keys and mytype_t values: */
+	HMAPS_SET_STR(map, "foo", some_element);
+	HMAPS_SET(map, "barbaz", 3, other_element);
+	CDS_ASSERT(HMAPS_LEN(map) == 2);
+	CDS_ASSERT(!memcmp(HMAPS_PTR_STR(map, "foo"), &some_element, sizeof(some_element)));
+	CDS_ASSERT(!memcmp(HMAPS_PTR_STR(map, "bar"), &other_element, sizeof(other_element)));
+	CDS_ASSERT(HMAPS_LEN(map) == 2);
+
+	/* Check if keys exist, keys are compared in full: */
+	CDS_ASSERT(HMAPS_HAS_STR(map, "foo") && HMAPS_HAS(map, "fooo", 3));
+	CDS_ASSERT(!HMAPS_HAS_STR(map, "baz") && !HMAPS_HAS(map, "foo", 2) && !HMAPS_HAS_STR(map, "barbaz"));
+
+	/* Keys with the same hash don't alias: */
+	CDS_ASSERT(hmaps__hash("key13460", 8) == hmaps__hash("key92875", 8));
+	HMAPS_SET_STR(map, "key13460", some_element);
+	CDS_ASSERT(!HMAPS_HAS_STR(map, "key92875"));
+	HMAPS_SET_STR(map, "key92875", other_element);
+	CDS_ASSERT(HMAPS_LEN(map) == 4);
+	CDS_ASSERT(HMAPS_GET_STR(map, "key13460").a == 1 && HMAPS_GET_STR(map, "key92875").a == 500);
+	CDS_ASSERT(HMAPS_DEL_STR(map, "key13460") && !HMAPS_DEL_STR(map, "key13460"));
+	CDS_ASSERT(!HMAPS_HAS_STR(map, "key13460") && HMAPS_GET_STR(map, "key92875").a == 500);
+
+	/* Looking up the index for a given key: */
+	idx_foo = HMAPS_IDX_STR(map, "foo");
+	CDS_ASSERT(idx_foo >= 0 && HMAPS_IDX_STR(map, "invalid") == -1);
+	CDS_ASSERT(HMAPS_KEYLEN(map, idx_foo) == 3 && !memcmp(HMAPS_KEY(map, idx_foo), "foo", 3));
+
+	/* Set a custom null value: */
+	HMAPS_SETNULLVAL(map, map_null);
+	CDS_ASSERT(HMAPS_GET_STR(map, "invalid").a == -1);
+
+	/* Grow, remove and iterate many keys (key memory needs to stay valid): */
+	HMAPS_CLEAR(map);
+	CDS_ASSERT(HMAPS_LEN(map) == 0 && !HMAPS_HAS_STR(map, "foo"));
+	for (i = 0; i != 1000; i++) { sprintf(names[i], "n%d", (int)i); HMAPS_PTR_STR(map, names[i])->a = (int)i; }
+	CDS_ASSERT(HMAPS_LEN(map) == 1000);
+	for (i = 0; i != 1000; i += 2) CDS_ASSERT(HMAPS_DEL_STR(map, names[i]));
+	CDS_ASSERT(HMAPS_LEN(map) == 500);
+	for (i = 0, it_found_count = 0, cap = HMAPS_CAP(map); i != cap; i++)
+		if (HMAPS_KEY(map, i)) { it_found_count++; CDS_ASSERT(map[i].a & 1 && HMAPS_KEY(map, i) == names[map[i].a] && HMAPS_KEYLEN(map, i) == strlen(names[map[i].a])); }
+	CDS_ASSERT(it_found_count == 500);
+	for (i = 0; i != 1000; i++) CDS_ASSERT(HMAPS_GET_STR(map, names[i]).a == (i & 1 ? (int)i : -1));
+
+	/* Use a custom allocator: */
+	HMAPS_SETALLOC(map, &arena_allocs);
+	CDS_ASSERT(arena_allocs == 1 && HMAPS_LEN(map) == 500 && HMAPS_GET_STR(map, "n777").a == 777);
+
+	HMAPS_FREE(map);
+	CDS_ASSERT(arena_allocs == 0);
+}
+
+/* Shared variables between the threads of the concurrent tests */
+#if defined(__GNUC__)
+#define TEST_LOAD(p) __atomic_load_n((p), __ATOMIC_SEQ_CST)
+#define TEST_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_SEQ_CST)
+#else
+#define TEST_LOAD(p) (*(volatile size_t*)(p))
+#define TEST_STORE(p, v) (*(volatile size_t*)(p) = (v))
+#endif
+
+/* One writer sets, deletes and grows while the readers check that every found value belongs to its key */
+#define TEST_HMAPC_READERS 8
+#define TEST_HMAPC_KEYS 50000
+#define TEST_HMAPC_KEY(i) ((uint32_t)((i) * 2654435761u))
+struct test_hmapc_job { mytype_t** map; struct test_hmapc_job* jobs; size_t gen, done, reads, found, reclaimed; };
+static HMAP__THREADPROC test_hmapc_job(void* arg)
+{
+	struct test_hmapc_job* job = (struct test_hmapc_job*)arg;
+	mytype_t elem;
+	size_t i, j, n, min_gen;
+	uint32_t rnd = (uint32_t)(job - job->jobs) * 2654435761u;
+	if (job == job->jobs)
+	{
+		/* the writer, every key i has the value { i, i * 3, -i } while it is set */
+		for (n = 1; n <= TEST_HMAPC_KEYS; n++)
+		{
+			elem.a = (int)n; elem.b = (int)(n * 3); elem.c = -(int)n;
+			HMAPC_SET((*job->map), TEST_HMAPC_KEY(n), elem);
+			if (n % 7 == 0) CDS_ASSERT(HMAPC_DEL((*job->map), TEST_HMAPC_KEY(n)));
+			if (n % 4 == 0 && HMAPC_DEL((*job->map), TEST_HMAPC_KEY(n / 2)))
+			{
+				elem.a = (int)(n / 2); elem.b = (int)(n / 2 * 3); elem.c = -(int)(n / 2);
+				HMAPC_SET((*job->map), TEST_HMAPC_KEY(n / 2), elem);
+			}
+			if (n % 1024 == 0)
+			{
+				for (min_gen = HMAPC_GEN((*job->map)), j = 1; j <= TEST_HMAPC_READERS; j++)
+					if ((i = TEST_LOAD(&job->jobs[j].gen)) < min_gen) min_gen = i;
+				job->reclaimed += HMAPC_RECLAIM((*job->map), min_gen);
+			}
+		}
+		for (j = 1; j <= TEST_HMAPC_READERS; j++)
+			TEST_STORE(&job->jobs[j].done, 1);
+		return 0;
+	}
+	do
+	{
+		/* a reader holds no pointers into the map between two rounds */
+		TEST_STORE(&job->gen, HMAPC_GEN((*job->map)));
+		for (j = 0; j != 64; j++)
+		{
+			rnd = rnd * 1664525u + 1013904223u;
+			i = rnd % TEST_HMAPC_KEYS + 1;
+			if (HMAPC_GET((*job->map), TEST_HMAPC_KEY(i), &elem))
+			{
+				CDS_ASSERT(elem.a == (int)i && elem.b == (int)(i * 3) && elem.c == -(int)i);
+				job->found++;
+			}
+			else CDS_ASSERT(elem.a == -1 && elem.b == -1 && elem.c == -1);
+			job->reads++;
+		}
+	} while (!TEST_LOAD(&job->done) && job->reads < ((size_t)1 << 24)); /* bounded for a reader run before the writer when no thread could be made */
+	return 0;
+}
+
+static void test_hmapc()
+{
+	mytype_t* map = NULL;
+	mytype_t some_element = { 1, 2, 3 };
+	mytype_t other_element = { 500, 10, 99 };
+	mytype_t map_null = { -1, -1, -1 };
+	mytype_t elem;
+	struct test_hmapc_job jobs[TEST_HMAPC_READERS + 1];
+	int it_found_count;
+	size_t i, cap, gen;
+
+	/* Reading an empty map: */
+	CDS_ASSERT(!HMAPC_GET(map, 123, &elem) && elem.a == 0 && !HMAPC_HAS(map, 123) && HMAPC_GEN(map) == 0);
+
+	/* Set and read 2 elements: */
+	HMAPC_SET(map, 123, some_element);
+	HMAPC_SET(map, 456, other_element);
+	CDS_ASSERT(HMAPC_LEN(map) == 2 && HMAPC_GEN(map) == 1);
+	CDS_ASSERT(HMAPC_GET(map, 123, &elem) && !memcmp(&elem, &some_element, sizeof(elem)));
+	CDS_ASSERT(HMAPC_GET(map, 456, &elem) && elem.a == 500);
+	CDS_ASSERT(HMAPC_HAS(map, 456) && !HMAPC_HAS(map, 789) && !HMAPC_HAS(map, 0));
+
+	/* Removing a key: */
+	CDS_ASSERT(HMAPC_DEL(map, 456) && !HMAPC_DEL(map, 456) && HMAPC_LEN(map) == 1);
+	CDS_ASSERT(!HMAPC_GET(map, 456, &elem) && elem.a == 0);
+
+	/* Set a custom null value: */
+	HMAPC_SETNULLVAL(map, map_null);
+	CDS_ASSERT(!HMAPC_GET(map, 456, &elem) && elem.a == -1);
+
+	/* Growing keeps old tables readable until they are reclaimed: */
+	for (i = 1; i <= 1000; i++) { other_element.a = (int)i; HMAPC_SET(map, (uint32_t)(i * 2654435761u), other_element); }
+	gen = HMAPC_GEN(map);
+	CDS_ASSERT(HMAPC_LEN(map) == 1001 && gen == 8 && HMAPC_RETIRED(map) == 7);
+	CDS_ASSERT(HMAPC_RECLAIM(map, 5) == 4 && HMAPC_RETIRED(map) == 3);
+	CDS_ASSERT(HMAPC_RECLAIM(map, 5) == 0 && HMAPC_RECLAIM(map, gen) == 3 && HMAPC_RETIRED(map) == 0);
+	for (i = 1; i <= 1000; i += 2) CDS_ASSERT(HMAPC_DEL(map, (uint32_t)(i * 2654435761u)));
+	for (i = 1; i <= 1000; i++) CDS_ASSERT(HMAPC_GET(map, (uint32_t)(i * 2654435761u), &elem) == !(i & 1) && elem.a == (i & 1 ? -1 : (int)i));
+	CDS_ASSERT(HMAPC_GET(map, 123, &elem) && elem.a == 1);
+
+	/* Iterate elements: */
+	for (i = 0, it_found_count = 0, cap = HMAPC_CAP(map); i != cap; i++)
+		if (HMAPC_KEY(map, i)) { it_found_count++; CDS_ASSERT(HMAPC_KEY(map, i) == 123 || HMAPC_KEY(map, i) == (uint32_t)(map[i].a * 2654435761u)); }
+	CDS_ASSERT(it_found_count == 501);
+
+	/* Clear and reserve: */
+	HMAPC_CLEAR(map);
+	CDS_ASSERT(HMAPC_LEN(map) == 0 && !HMAPC_HAS(map, 123));
+	HMAPC_FIT(map, 5000);
+	CDS_ASSERT(HMAPC_CAP(map) == 16384 && HMAPC_RETIRED(map) == 1);
+
+	HMAPC_FREE(map);
+	CDS_ASSERT(map == NULL);
+
+	/* Keys which only differ in their high bits are spread out by the seeded home slots: */
+	for (i = 1; i <= 1000; i++) { other_element.a = (int)i; HMAPC_SET(map, (uint32_t)(i << 20), other_element); }
+	for (i = 0, it_found_count = 0, cap = HMAPC_CAP(map); i != cap; i++)
+		if (HMAPC_KEY(map, i) && HMAPC__HOME(HMAPC__HDR(map), HMAPC_KEY(map, i)) == i) it_found_count++;
+	CDS_ASSERT(HMAPC_LEN(map) == 1000 && cap == 2048 && it_found_count > 500);
+	for (i = 1; i <= 1000; i++) CDS_ASSERT(HMAPC_GET(map, (uint32_t)(i << 20), &elem) && elem.a == (int)i);
+	HMAPC_FREE(map);
+
+	/* One writer with readers on other threads at the same time: */
+	HMAPC_SETNULLVAL(map, map_null);
+	memset(jobs, 0, sizeof(jobs));
+	for (i = 0; i <= TEST_HMAPC_READERS; i++) { jobs[i].map = &map; jobs[i].jobs = jobs; }
+	hmap__runjobs(test_hmapc_job, (char*)jobs, sizeof(jobs[0]), TEST_HMAPC_READERS + 1);
+	for (i = 1; i <= TEST_HMAPC_READERS; i++) CDS_ASSERT(jobs[i].reads && jobs[i].gen <= HMAPC_GEN(map));
+	CDS_ASSERT(HMAPC_GEN(map) > 10 && jobs[0].reclaimed + HMAPC_RETIRED(map) == HMAPC_GEN(map) - 1);
+	for (i = 1, it_found_count = 0; i <= TEST_HMAPC_KEYS; i++)
+		if (HMAPC_GET(map, TEST_HMAPC_KEY(i), &elem)) { it_found_count++; CDS_ASSERT(elem.a == (int)i && elem.b == (int)(i * 3) && elem.c == -(int)i); }
+	CDS_ASSERT((size_t)it_found_count == HMAPC_LEN(map) && it_found_count > TEST_HMAPC_KEYS / 2);
+	cap = HMAPC_RETIRED(map); /* the writer can have freed all of them already */
+	CDS_ASSERT(HMAPC_RECLAIM(map, HMAPC_GEN(map)) == cap && HMAPC_RETIRED(map) == 0);
+	HMAPC_FREE(map);
+	CDS_ASSERT(map == NULL);
+}
+
+/* Writers on all threads increment shared counters, each holding the lock of the key's shard */
+#define TEST_HMAPSH_THREADS 8
+#define TEST_HMAPSH_KEYS 256
+#define TEST_HMAPSH_ROUNDS 20000
+#define TEST_HMAPSH_KEY(k) ((uint64_t)(k) * (uint64_t)0x9E3779B97F4A7C15)
+#define TEST_HMAPSH_PICK(t, r) (((r) * 7 + (t) * 13) % TEST_HMAPSH_KEYS + 1)
+struct test_hmapsh_job { mytype_t** map; size_t thread; };
+static HMAP__THREADPROC test_hmapsh_job(void* arg)
+{
+	struct test_hmapsh_job* job = (struct test_hmapsh_job*)arg;
+	mytype_t** map = job->map;
+	mytype_t elem, *p;
+	size_t r, k;
+	for (r = 0; r != TEST_HMAPSH_ROUNDS; r++)
+	{
+		k = TEST_HMAPSH_PICK(job->thread, r);
+		HMAPSH_LOCK(map, TEST_HMAPSH_KEY(k));
+		p = HMAP64_PTR(HMAPSH_SHARD(map, TEST_HMAPSH_KEY(k)), TEST_HMAPSH_KEY(k));
+		p->a++;
+		p->b += (int)job->thread;
+		HMAPSH_UNLOCK(map, TEST_HMAPSH_KEY(k));
+		if (r % 16 == 0) CDS_ASSERT(HMAPSH_GET(map, TEST_HMAPSH_KEY(k), &elem) && elem.a > 0 && elem.c == (int)k);
+	}
+	return 0;
+}
+
+static void test_hmapsh()
+{
+	mytype_t** map = NULL;
+	mytype_t some_element = { 1, 2, 3 };
+	mytype_t elem;
+	struct test_hmapsh_job jobs[TEST_HMAPSH_THREADS];
+	size_t counts[TEST_HMAPSH_KEYS + 1], sums[TEST_HMAPSH_KEYS + 1];
+	size_t i, j, s, it_found_count, allocs;
+
+	/* Create with a number of shards rounded up to a power of 2: */
+	HMAPSH_INIT(map, 6);
+	CDS_ASSERT(HMAPSH_SHARDS(map) == 8 && HMAPSH_LEN(map) == 0);
+	CDS_ASSERT(((size_t)&HMAPSH_AT(map, 1) - (size_t)&HMAPSH_AT(map, 0)) == 64 && ((size_t)&HMAPSH_AT(map, 0) & 63) == 0);
+	CDS_ASSERT(!HMAPSH_GET(map, 123, &elem) && elem.a == 0 && !HMAPSH_HAS(map, 123) && !HMAPSH_DEL(map, 123));
+
+	/* Set, get and delete, keys are spread over shards by their high bits: */
+	for (i = 1; i <= 1000; i++) { some_element.a = (int)i; HMAPSH_SET(map, (uint64_t)i * (uint64_t)0x9E3779B97F4A7C15, some_element); }
+	CDS_ASSERT(HMAPSH_LEN(map) == 1000);
+	CDS_ASSERT(HMAPSH_IDX(map, (uint64_t)1 << 63) == 4 && HMAPSH_IDX(map, (uint64_t)-1) == 7 && HMAPSH_IDX(map, 12345) == 0);
+	for (s = 0; s != HMAPSH_SHARDS(map); s++) CDS_ASSERT(HMAP64_LEN(HMAPSH_AT(map, s)) > 80);
+	CDS_ASSERT(HMAPSH_GET(map, (uint64_t)500 * (uint64_t)0x9E3779B97F4A7C15, &elem) && elem.a == 500 && elem.b == 2);
+	for (i = 1; i <= 1000; i += 2) CDS_ASSERT(HMAPSH_DEL(map, (uint64_t)i * (uint64_t)0x9E3779B97F4A7C15));
+	CDS_ASSERT(HMAPSH_LEN(map) == 500 && !HMAPSH_HAS(map, (uint64_t)501 * (uint64_t)0x9E3779B97F4A7C15));
+
+	/* Modify in place while holding the shard lock: */
+	HMAPSH_LOCK(map, (uint64_t)500 * (uint64_t)0x9E3779B97F4A7C15);
+	HMAP64_PTR(HMAPSH_SHARD(map, (uint64_t)500 * (uint64_t)0x9E3779B97F4A7C15), (uint64_t)500 * (uint64_t)0x9E3779B97F4A7C15)->c += 10;
+	HMAPSH_UNLOCK(map, (uint64_t)500 * (uint64_t)0x9E3779B97F4A7C15);
+	CDS_ASSERT(HMAPSH_GET(map, (uint64_t)500 * (uint64_t)0x9E3779B97F4A7C15, &elem) && elem.c == 13);
+
+	/* Iterate elements of all shards: */
+	for (s = 0, it_found_count = 0; s != HMAPSH_SHARDS(map); s++)
+	{
+		HMAPSH_LOCKAT(map, s);
+		for (j = 0; j != HMAP64_CAP(HMAPSH_AT(map, s)); j++)
+			if (HMAP64_KEY(HMAPSH_AT(map, s), j)) { it_found_count++; CDS_ASSERT(HMAPSH_AT(map, s)[j].a % 2 == 0); }
+		HMAPSH_UNLOCKAT(map, s);
+	}
+	CDS_ASSERT(it_found_count == 500);
+
+	HMAPSH_FREE(map);
+	CDS_ASSERT(map == NULL);
+
+	/* Writers on other threads at the same time (all keys get added first so the threads don't allocate): */
+	HMAPSH_INIT(map, 8);
+	for (i = 1; i <= TEST_HMAPSH_KEYS; i++) { elem.a = elem.b = 0; elem.c = (int)i; HMAPSH_SET(map, TEST_HMAPSH_KEY(i), elem); }
+	for (i = 0; i != TEST_HMAPSH_THREADS; i++) { jobs[i].map = map; jobs[i].thread = i; }
+	allocs = test_allocs;
+	hmap__runjobs(test_hmapsh_job, (char*)jobs, sizeof(jobs[0]), TEST_HMAPSH_THREADS);
+	CDS_ASSERT(test_allocs == allocs && HMAPSH_LEN(map) == TEST_HMAPSH_KEYS);
+	memset(counts, 0, sizeof(counts));
+	memset(sums, 0, sizeof(sums));
+	for (i = 0; i != TEST_HMAPSH_THREADS; i++)
+		for (j = 0; j != TEST_HMAPSH_ROUNDS; j++) { counts[TEST_HMAPSH_PICK(i, j)]++; sums[TEST_HMAPSH_PICK(i, j)] += i; }
+	for (i = 1; i <= TEST_HMAPSH_KEYS; i++)
+		CDS_ASSERT(HMAPSH_GET(map, TEST_HMAPSH_KEY(i), &elem) && elem.a == (int)counts[i] && elem.b == (int)sums[i] && elem.c == (int)i);
+
+	/* Every key stayed in its own shard: */
+	for (s = 0, it_found_count = 0; s != HMAPSH_SHARDS(map); s++)
+		for (j = 0; j != HMAP64_CAP(HMAPSH_AT(map, s)); j++)
+			if (HMAP64_KEY(HMAPSH_AT(map, s), j)) { it_found_count++; CDS_ASSERT(HMAPSH_IDX(map, HMAP64_KEY(HMAPSH_AT(map, s), j)) == s); }
+	CDS_ASSERT(it_found_count == TEST_HMAPSH_KEYS);
+
+	HMAPSH_FREE(map);
+	CDS_ASSERT(map == NULL);
+}
+
+static void test_hmapd()
+{
+	mytype_t* map = NULL;
+	mytype_t some_element = { 1, 2, 3 };
+	mytype_t other_element = { 500, 10, 99 };
+	mytype_t map_null = { -1, -1, -1 };
+	size_t i, it_found_count;
+
+	/* Set elements with string keys, they are stored in insertion order: */
+	HMAPD_SET_STR(map, "foo", some_element);
+	HMAPD_SET_STR(map, "bar", other_element);
+	CDS_ASSERT(HMAPD_LEN(map) == 2 && HMAPD_END(map) == 2 && HMAPD_CAP(map) == 16);
+	CDS_ASSERT(map[0].a == 1 && map[1].a == 500 && HMAPD_KEY(map, 0) == hash_string("foo"));
+	CDS_ASSERT(HMAPD_GET_STR(map, "bar").c == 99 && HMAPD_IDX_STR(map, "bar") == 1 && !HMAPD_HAS_STR(map, "baz"));
+	HMAPD_SET_STR(map, "foo", other_element);
+	CDS_ASSERT(HMAPD_LEN(map) == 2 && map[0].a == 500);
+	HMAPD_PTR_BYTES(map, "qux", 3)->a = 123;
+	CDS_ASSERT(HMAPD_LEN(map) == 3 && map[2].a == 123 && HMAPD_GET_BYTES(map, "qux", 3).a == 123);
+
+	/* Deleting leaves a hole until compacting: */
+	CDS_ASSERT(HMAPD_DEL_STR(map, "bar") && !HMAPD_DEL_STR(map, "bar"));
+	CDS_ASSERT(HMAPD_LEN(map) == 2 && HMAPD_END(map) == 3 && HMAPD_KEY(map, 1) == 0 && HMAPD_IDX_BYTES(map, "qux", 3) == 2);
+	HMAPD_COMPACT(map);
+	CDS_ASSERT(HMAPD_LEN(map) == 2 && HMAPD_END(map) == 2 && map[1].a == 123 && HMAPD_IDX_BYTES(map, "qux", 3) == 1);
+
+	/* Custom null value: */
+	HMAPD_SETNULLVAL(map, map_null);
+	CDS_ASSERT(HMAPD_GET_STR(map, "invalid").a == -1 && HMAPD_IDX_STR(map, "invalid") == -1);
+
+	/* The key 0 is not added, setting it goes to the null value: */
+	HMAPD_SET(map, 0, some_element);
+	CDS_ASSERT(HMAPD_LEN(map) == 2 && HMAPD_END(map) == 2 && !HMAPD_HAS(map, 0) && HMAPD_IDX(map, 0) == -1);
+	CDS_ASSERT(!HMAPD_DEL(map, 0) && HMAPD_PTR(map, 0) == &map[-1]);
+	HMAPD_SETNULLVAL(map, map_null);
+
+	/* Iterate in insertion order while deleting, holes get squeezed out when growing: */
+	HMAPD_CLEAR(map);
+	CDS_ASSERT(HMAPD_LEN(map) == 0 && HMAPD_END(map) == 0 && HMAPD_CAP(map) == 16);
+	for (i = 1; i <= 1000; i++) { some_element.a = (int)i; HMAPD_SET(map, (uint32_t)(i * 2654435761u), some_element); }
+	CDS_ASSERT(HMAPD_LEN(map) == 1000 && HMAPD_CAP(map) == 1024);
+	for (i = 0, it_found_count = 0; i != HMAPD_END(map); i++)
+		if (HMAPD_KEY(map, i))
+		{
+			CDS_ASSERT(map[i].a == (int)(i + 1));
+			if (map[i].a % 4) CDS_ASSERT(HMAPD_DEL(map, HMAPD_KEY(map, i)));
+			else it_found_count++;
+		}
+	CDS_ASSERT(it_found_count == 250 && HMAPD_LEN(map) == 250 && HMAPD_END(map) == 1000);
+	for (i = 1001; i <= 1100; i++) { some_element.a = (int)i; HMAPD_SET(map, (uint32_t)(i * 2654435761u), some_element); }
+	CDS_ASSERT(HMAPD_LEN(map) == 350 && HMAPD_END(map) == 350 && HMAPD_CAP(map) == 1024);
+	for (i = 0; i != 350; i++) CDS_ASSERT(map[i].a == (int)(i < 250 ? (i + 1) * 4 : i + 751));
+	for (i = 1; i <= 1100; i++) CDS_ASSERT(HMAPD_HAS(map, (uint32_t)(i * 2654435761u)) == (i > 1000 || i % 4 == 0));
+
+	/* Reserve memory: */
+	CDS_ASSERT(HMAPD_TRYFIT(map, 5000) && HMAPD_CAP(map) == 8192 && HMAPD_LEN(map) == 350);
+	CDS_ASSERT(HMAPD_GET(map, (uint32_t)(1100 * 2654435761u)).a == 1100 && HMAPD_GET(map, 5).a == -1);
+
+	HMAPD_FREE(map);
+	CDS_ASSERT(map == NULL && HMAPD_LEN(map) == 0);
+}
+
+static void test_cache()
+{
+	mytype_t* cache = NULL;
+	mytype_t some_element = { 1, 2, 3 };
+	mytype_t other_element = { 500, 10, 99 };
+	mytype_t cache_null = { -1, -1, -1 };
+	mytype_t* p;
+	uint32_t key;
+	size_t i, j, evictions = 0, seed = 12345;
+
+	/* A cache without CACHE_INIT holds 16 elements: */
+	CACHE_PUT_STR(cache, "foo", some_element);
+	CACHE_PTR_BYTES(cache, "bar", 3)->a = 123;
+	CDS_ASSERT(CACHE_LEN(cache) == 2 && CACHE_CAP(cache) == 16 && test_allocs == 2 && CACHE_EVICTED(cache) == 0);
+	CDS_ASSERT(CACHE_GET_STR(cache, "foo").c == 3 && CACHE_GET_BYTES(cache, "bar", 3).a == 123 && CACHE_IDX_BYTES(cache, "bar", 3) == 1);
+	CDS_ASSERT(CACHE_HAS_STR(cache, "foo") && !CACHE_HAS_STR(cache, "baz") && CACHE_KEY(cache, 0) == hash_string("foo"));
+	CDS_ASSERT(CACHE_DEL_STR(cache, "foo") && !CACHE_DEL_STR(cache, "foo") && CACHE_LEN(cache) == 1 && CACHE_IDX_BYTES(cache, "bar", 3) == 0);
+
+	/* Making it again drops all elements: */
+	CDS_ASSERT(CACHE_INIT(cache, 4) && CACHE_LEN(cache) == 0 && CACHE_CAP(cache) == 4 && test_allocs == 2);
+	CACHE_SETNULLVAL(cache, cache_null);
+	CDS_ASSERT(CACHE_GET_BYTES(cache, "bar", 3).a == -1 && CACHE_IDX(cache, 1) == -1);
+	for (key = 1; key <= 4; key++) { some_element.a = (int)key; CACHE_PUT(cache, key, some_element); }
+	CACHE_PUT(cache, 0, other_element);
+	CDS_ASSERT(CACHE_LEN(cache) == 4 && CACHE_GET(cache, 0).a == 500 && cache[-1].a == 500 && CACHE_EVICTED(cache) == 0);
+	cache[-1] = cache_null;
+
+	/* A full cache evicts the first element without its reference bit after the hand: */
+	CDS_ASSERT(CACHE_GET(cache, 1).a == 1 && CACHE_IDX(cache, 3) == 2 && CACHE_HAS(cache, 4));
+	CACHE_PUT(cache, 5, other_element);
+	CDS_ASSERT(CACHE_LEN(cache) == 4 && CACHE_EVICTED(cache) == 2 && !CACHE_HAS(cache, 2) && CACHE_GET(cache, 2).a == -1);
+	CDS_ASSERT(CACHE_KEY(cache, 1) == 5 && cache[1].a == 500 && CACHE_GET(cache, 5).a == 500);
+	p = CACHE_PTR(cache, 6);
+	CDS_ASSERT(CACHE_EVICTED(cache) == 4 && p == &cache[3] && p->a == 4 && CACHE_KEY(cache, 3) == 6);
+	p->a = 6;
+	p = CACHE_PTR(cache, 1);
+	CDS_ASSERT(CACHE_EVICTED(cache) == 0 && p == &cache[0] && p->a == 1);
+	CACHE_PUT(cache, 7, some_element);
+	CDS_ASSERT(CACHE_EVICTED(cache) == 3 && CACHE_HAS(cache, 1) && CACHE_HAS(cache, 5) && CACHE_HAS(cache, 6) && CACHE_KEY(cache, 2) == 7);
+
+	/* Deleting moves the last element into the slot: */
+	CDS_ASSERT(CACHE_DEL(cache, 5) && CACHE_LEN(cache) == 3 && CACHE_KEY(cache, 1) == 6 && cache[1].a == 6 && CACHE_IDX(cache, 6) == 1);
+	CACHE_PUT(cache, 8, other_element);
+	CDS_ASSERT(CACHE_LEN(cache) == 4 && CACHE_EVICTED(cache) == 0 && CACHE_KEY(cache, 3) == 8);
+	CACHE_CLEAR(cache);
+	CDS_ASSERT(CACHE_LEN(cache) == 0 && CACHE_CAP(cache) == 4 && !CACHE_HAS(cache, 1) && CACHE_GET(cache, 1).a == -1);
+
+	/* Elements used between adding new keys don't get evicted, adding and evicting doesn't allocate: */
+	CDS_ASSERT(CACHE_INIT(cache, 1000) && test_allocs == 2);
+	for (i = 1; i <= 100000; i++)
+	{
+		key = (uint32_t)((seed = seed * 6364136223846793005u + 1442695040888963407u) >> 40) | 0x1000000;
+		some_element.a = (int)(key * 3);
+		CACHE_PUT(cache, key, some_element);
+		CDS_ASSERT(CACHE_HAS(cache, key));
+		evictions += (CACHE_EVICTED(cache) != 0);
+		if (i <= 500) { other_element.a = (int)i; CACHE_PUT(cache, (uint32_t)i, other_element); CDS_ASSERT(CACHE_GET(cache, (uint32_t)i).a == (int)i); }
+		else for (j = 1; j <= 500; j += 50) CDS_ASSERT(CACHE_GET(cache, (uint32_t)(j + i % 50)).a == (int)(j + i % 50));
+	}
+	CDS_ASSERT(CACHE_LEN(cache) == 1000 && evictions > 99000 && test_allocs == 2);
+	for (i = 1; i <= 500; i++) CDS_ASSERT(CACHE_GET(cache, (uint32_t)i).a == (int)i);
+	for (i = 0; i != CACHE_LEN(cache); i++) CDS_ASSERT(CACHE_IDX(cache, CACHE_KEY(cache, i)) == (ptrdiff_t)i && (CACHE_KEY(cache, i) <= 500 || cache[i].a == (int)(CACHE_KEY(cache, i) * 3)));
+
+	/* Out of memory: */
+	CDS_ASSERT(!CACHE_INIT(cache, (sizeof(void*) > 4 ? 0xFFFFFFFF : 0xFFFFFFF)) && cache == NULL && test_allocs == 0);
+	CDS_ASSERT(CACHE_INIT(cache, 0) && CACHE_CAP(cache) == 1);
+	CACHE_PUT(cache, 1, some_element);
+	CACHE_PUT(cache, 2, other_element);
+	CDS_ASSERT(CACHE_LEN(cache) == 1 && CACHE_EVICTED(cache) == 1 && CACHE_GET(cache, 2).a == other_element.a);
+	CACHE_FREE(cache);
+	CDS_ASSERT(cache == NULL && CACHE_LEN(cache) == 0 && test_allocs == 0);
+}
+
+static void test_omap()
+{
+	mytype_t* map = NULL;
+	mytype_t some_element = { 1, 2, 3 };
+	mytype_t map_null = { -1, -1, -1 };
+	uint64_t* ref = NULL;
+	uint64_t* vals = NULL;
+	uint64_t key, last;
+	size_t i, j, n, arena_allocs = 0, seed = 12345;
+
+	/* Keys are kept in order: */
+	OMAP_SET(map, 30, some_element);
+	some_element.a = 10;
+	OMAP_SET(map, 10, some_element);
+	CDS_ASSERT(OMAP_LEN(map) == 2 && OMAP_GET(map, 10).a == 10 && OMAP_GET(map, 30).a == 1 && OMAP_GET(map, 20).a == 0 && test_allocs == 3);
+	CDS_ASSERT(OMAP_HAS(map, 30) && !OMAP_HAS(map, 20) && OMAP_IDX(map, 20) == -1 && OMAP_KEY(map, OMAP_IDX(map, 30)) == 30);
+	i = OMAP_FIRST(map);
+	CDS_ASSERT(OMAP_KEY(map, i) == 10 && OMAP_KEY(map, OMAP_NEXT(map, i)) == 30 && OMAP_NEXT(map, OMAP_NEXT(map, i)) == OMAP_END);
+	CDS_ASSERT(OMAP_KEY(map, OMAP_LAST(map)) == 30 && OMAP_PREV(map, OMAP_LAST(map)) == i && OMAP_PREV(map, i) == OMAP_END);
+	CDS_ASSERT(OMAP_LOWER_BOUND(map, 0) == i && OMAP_LOWER_BOUND(map, 10) == i && OMAP_KEY(map, OMAP_LOWER_BOUND(map, 11)) == 30 && OMAP_LOWER_BOUND(map, 31) == OMAP_END);
+	OMAP_PTR(map, 20)->a = 20;
+	CDS_ASSERT(OMAP_LEN(map) == 3 && map[OMAP_LOWER_BOUND(map, 11)].a == 20);
+	CDS_ASSERT(OMAP_DEL(map, 10) && !OMAP_DEL(map, 10) && OMAP_LEN(map) == 2 && OMAP_KEY(map, OMAP_FIRST(map)) == 20);
+	OMAP_SETNULLVAL(map, map_null);
+	CDS_ASSERT(OMAP_GET(map, 10).a == -1 && OMAP_DEL(map, 20) && OMAP_DEL(map, 30) && OMAP_LEN(map) == 0 && OMAP_FIRST(map) == OMAP_END && OMAP_LOWER_BOUND(map, 0) == OMAP_END);
+
+	/* Appending larger keys fills the leaves, scanning a range reads them in order: */
+	for (key = 1; key <= 100000; key++)
+	{
+		some_element.a = (int)key;
+		OMAP_SET(map, key * 10, some_element);
+	}
+	CDS_ASSERT(OMAP_LEN(map) == 100000 && OMAP__HDR(map)->leaves == (100000 + OMAP__LEAFN - 1) / OMAP__LEAFN && OMAP__HDR(map)->height == 4);
+	for (n = 0, i = OMAP_LOWER_BOUND(map, 5005); i != OMAP_END && OMAP_KEY(map, i) < 6000; i = OMAP_NEXT(map, i), n++)
+		CDS_ASSERT(OMAP_KEY(map, i) == 5010 + n * 10 && map[i].a == (int)(501 + n));
+	CDS_ASSERT(n == 99);
+	n = 0;
+	OMAP_ITER(map, i)
+		CDS_ASSERT(map[i].a == (int)++n);
+	CDS_ASSERT(n == 100000);
+	for (i = OMAP_LAST(map); i != OMAP_END; i = OMAP_PREV(map, i))
+		CDS_ASSERT(map[i].a == (int)n--);
+	CDS_ASSERT(n == 0);
+
+	/* Inserting between keys splits leaves in half, deleting merges them again: */
+	for (key = 1; key <= 100000; key++)
+	{
+		some_element.a = -(int)key;
+		OMAP_SET(map, key * 10 - 5, some_element);
+	}
+	CDS_ASSERT(OMAP_LEN(map) == 200000 && OMAP_GET(map, 5).a == -1 && OMAP_GET(map, 999995).a == -100000);
+	for (n = 0, last = 0, i = OMAP_FIRST(map); i != OMAP_END; i = OMAP_NEXT(map, i), n++, last = key)
+		CDS_ASSERT((key = OMAP_KEY(map, i)) > last && map[i].a == (key % 10 ? -(int)(key / 10 + 1) : (int)(key / 10)));
+	CDS_ASSERT(n == 200000);
+	for (key = 1; key <= 100000; key++)
+		CDS_ASSERT(OMAP_DEL(map, key * 10));
+	CDS_ASSERT(OMAP_LEN(map) == 100000 && OMAP__HDR(map)->leaves < 100000 / (OMAP__LEAFN / 4));
+	for (n = 0, i = OMAP_FIRST(map); i != OMAP_END; i = OMAP_NEXT(map, i))
+		CDS_ASSERT(OMAP_KEY(map, i) == ++n * 10 - 5);
+	while ((i = OMAP_LOWER_BOUND(map, 0)) != OMAP_END)
+		CDS_ASSERT(OMAP_DEL(map, OMAP_KEY(map, i)));
+	CDS_ASSERT(OMAP_LEN(map) == 0 && OMAP__HDR(map)->leaves == 1 && OMAP__HDR(map)->inners == 0 && OMAP__HDR(map)->height == 0 && test_allocs == 3);
+
+	/* Random sets and deletes match a hash map: */
+	for (j = 0; j != 300000; j++)
+	{
+		key = ((seed = seed * 6364136223846793005u + 1442695040888963407u) >> 48) % 20000;
+		if ((seed >> 40) % 3)
+		{
+			some_element.a = (int)j;
+			OMAP_SET(map, key, some_element);
+			HMAP64_SET(vals, key + 1, (uint64_t)j);
+		}
+		else
+			CDS_ASSERT(OMAP_DEL(map, key) == HMAP64_DEL(vals, key + 1));
+		if (j % 1000 == 0)
+		{
+			CDS_ASSERT(OMAP_LEN(map) == HMAP64_LEN(vals));
+			for (n = 0, last = 0, i = OMAP_FIRST(map); i != OMAP_END; i = OMAP_NEXT(map, i), n++, last = key + 1)
+				CDS_ASSERT((key = OMAP_KEY(map, i)) + 1 > last && (uint64_t)map[i].a == HMAP64_GET(vals, key + 1));
+			CDS_ASSERT(n == OMAP_LEN(map));
+		}
+	}
+	for (key = 0; key != 20000; key++)
+	{
+		CDS_ASSERT(OMAP_HAS(map, key) == HMAP64_HAS(vals, key + 1));
+		i = OMAP_LOWER_BOUND(map, key);
+		CDS_ASSERT(i == OMAP_END || (OMAP_KEY(map, i) >= key && (OMAP_PREV(map, i) == OMAP_END || OMAP_KEY(map, OMAP_PREV(map, i)) < key)));
+	}
+	HMAP64_FREE(vals);
+
+	/* All memory moves to another allocator, clearing keeps it: */
+	n = OMAP_LEN(map);
+	OMAP_SETALLOC(map, &arena_allocs);
+	CDS_ASSERT(test_allocs == 0 && arena_allocs == 3 && OMAP_LEN(map) == n && OMAP_GET(map, 12345678).a == -1);
+	OMAP_ITER(map, i)
+		HMAP64_SET(ref, OMAP_KEY(map, i) + 1, (uint64_t)map[i].a);
+	CDS_ASSERT(HMAP64_LEN(ref) == n);
+	HMAP64_FREE(ref);
+	OMAP_CLEAR(map);
+	CDS_ASSERT(OMAP_LEN(map) == 0 && !OMAP_HAS(map, 1) && OMAP_FIRST(map) == OMAP_END && arena_allocs == 3);
+	OMAP_SET(map, 7, some_element);
+	CDS_ASSERT(OMAP_LEN(map) == 1 && OMAP_KEY(map, OMAP_FIRST(map)) == 7 && OMAP_GET(map, 0).a == -1);
+	OMAP_FREE(map);
+	CDS_ASSERT(map == NULL && OMAP_LEN(map) == 0 && arena_allocs == 0 && test_allocs == 0);
+
+	/* Out of memory: */
+	CDS_ASSERT(OMAP_TRYFIT(map, 1000) && OMAP__HDR(map)->leafcap >= 1000 / (OMAP__LEAFN / 2) + 1 && test_allocs == 3);
+	CDS_ASSERT(!OMAP_TRYFIT(map, (sizeof(void*) > 4 ? 0xFFFF000000000000 : 0xFFFF0000) / sizeof(mytype_t)) && OMAP_LEN(map) == 0 && test_allocs == 3);
+	OMAP_FREE(map);
+	CDS_ASSERT(map == NULL && test_allocs == 0);
+}
+
+#ifdef __cplusplus
+struct test_tracked
+{
+	static int live, throw_at; /* the copy which makes throw_at 0 throws */
+	int v; std::string s;
+	test_tracked(int i = 0) : v(i), s(std::to_string(i) + " is a string too long for small string storage") { live++; }
+	test_tracked(const test_tracked& o) : v(o.v), s(o.s) { if (throw_at && !--throw_at) throw std::runtime_error("copy"); live++; }
+	test_tracked(test_tracked&& o) noexcept : v(o.v), s(std::move(o.s)) { live++; }
+	test_tracked& operator=(const test_tracked& o) { v = o.v; s = o.s; return *this; }
+	test_tracked& operator=(test_tracked&& o) noexcept { v = o.v; s = std::move(o.s); return *this; }
+	~test_tracked() { live--; }
+	bool ok() const { return s == std::to_string(v) + " is a string too long for small string storage"; }
+};
+int test_tracked::live, test_tracked::throw_at;
+struct test_collide { uint64_t operator()(const char*, size_t n) const { return n % 3; } };
+enum test_enum { TEST_ENUM_A, TEST_ENUM_B };
+
+static void test_cpp()
+{
+	int i, n;
+	CDS_ASSERT(!tiny::is_relocatable<test_tracked>::value && tiny::is_relocatable<mytype_t>::value);
+
+	{
+		/* relocatable elements grow like TinyBuf */
+		tiny::buf<mytype_t> buf;
+		for (i = 0; i != 1000; i++)
+			buf.push_back(mytype_t{ i, i * 2, i * 3 });
+		CDS_ASSERT(buf.size() == 1000 && BUF_LEN(buf.raw()) == 1000 && BUF_CAP(buf.raw()) == buf.capacity());
+		buf.erase(0);
+		CDS_ASSERT(buf.size() == 999 && buf[0].a == 1 && buf.back().c == 2997);
+		buf.resize(10);
+		CDS_ASSERT(buf.size() == 10 && buf[9].b == 20);
+	}
+
+	{
+		/* other elements are move constructed when growing */
+		tiny::buf<test_tracked> buf;
+		for (i = 0; i != 1000; i++)
+			buf.emplace_back(i);
+		CDS_ASSERT(buf.size() == 1000 && test_tracked::live == 1000);
+		for (n = 0, i = 0; i != 1000; i++) n += (buf[i].v == i && buf[i].ok());
+		CDS_ASSERT(n == 1000);
+		buf.push_back(buf[0]); /* refers to an element while growing */
+		CDS_ASSERT(buf.size() == 1001 && buf.back().v == 0 && buf.back().ok());
+		buf.erase(500);
+		CDS_ASSERT(buf.size() == 1000 && buf[500].v == 501 && buf[500].ok() && test_tracked::live == 1000);
+		tiny::buf<test_tracked> copy(buf), moved(std::move(buf));
+		CDS_ASSERT(copy.size() == 1000 && moved.size() == 1000 && buf.size() == 0 && test_tracked::live == 2000);
+		copy.resize(3);
+		CDS_ASSERT(copy.size() == 3 && copy[2].ok() && test_tracked::live == 1003);
+		moved = copy;
+		CDS_ASSERT(moved.size() == 3 && moved[2].v == 2 && test_tracked::live == 6);
+	}
+	CDS_ASSERT(test_tracked::live == 0 && test_allocs == 0);
+
+	{
+		tiny::hmap<int, test_tracked> map;
+		for (i = -500; i != 500; i++)
+			CDS_ASSERT(map.try_emplace(i * 1024, i).second);
+		CDS_ASSERT(map.size() == 1000 && !map.try_emplace(0, 7).second && map.find(0)->v == 0);
+		for (n = 0, i = -500; i != 500; i++) n += (map.find(i * 1024) && map.find(i * 1024)->v == i && map.find(i * 1024)->ok());
+		CDS_ASSERT(n == 1000 && !map.find(1) && !map.contains(-1));
+		for (i = -500; i != 500; i += 2)
+			CDS_ASSERT(map.erase(i * 1024));
+		CDS_ASSERT(map.size() == 500 && !map.erase(0) && !map.contains(0) && test_tracked::live == 500);
+		for (n = 0, i = -499; i < 500; i += 2) n += (map.find(i * 1024) && map.find(i * 1024)->v == i && map.find(i * 1024)->ok());
+		CDS_ASSERT(n == 500);
+		n = 0;
+		for (const auto& e : map) n += (e.second.v * 1024 == e.first);
+		CDS_ASSERT(n == 500);
+		map[0].v = 5;
+		map.insert_or_assign(1024, test_tracked(11));
+		CDS_ASSERT(map.size() == 501 && map.find(0)->v == 5 && map.find(1024)->v == 11 && map.find(1024)->ok());
+		tiny::hmap<int, test_tracked> copy(map);
+		map.clear();
+		CDS_ASSERT(map.size() == 0 && !map.contains(3 * 1024) && copy.size() == 501 && copy.find(3 * 1024)->v == 3);
+	}
+	CDS_ASSERT(test_tracked::live == 0 && test_allocs == 0);
+
+	{
+		/* a copy which throws halfway destroys and frees what it already made */
+		tiny::buf<test_tracked> buf;
+		tiny::hmap<int, test_tracked> map;
+		tiny::hmap<std::string, test_tracked> smap;
+		size_t allocs;
+		for (i = 0; i != 100; i++)
+		{
+			buf.emplace_back(i);
+			map.try_emplace(i, i);
+			smap.try_emplace(std::to_string(i), i);
+		}
+		allocs = test_allocs;
+		for (n = 0, i = 0; i != 3; i++)
+		{
+			test_tracked::throw_at = 50;
+			try
+			{
+				if (i == 0) { tiny::buf<test_tracked> copy(buf); }
+				else if (i == 1) { tiny::hmap<int, test_tracked> copy(map); }
+				else { tiny::hmap<std::string, test_tracked> copy(smap); }
+			}
+			catch (const std::runtime_error&) { n++; }
+		}
+		CDS_ASSERT(n == 3 && test_tracked::throw_at == 0 && test_tracked::live == 300 && test_allocs == allocs);
+	}
+	CDS_ASSERT(test_tracked::live == 0 && test_allocs == 0);
+
+	{
+		/* 64-bit keys use the 64-bit map */
+		tiny::hmap<uint64_t, std::shared_ptr<int> > map;
+		tiny::hmap<test_enum, int> emap;
+		for (i = 0; i != 100; i++)
+			map[(uint64_t)i << 40] = std::make_shared<int>(i);
+		CDS_ASSERT(map.size() == 100 && **map.find((uint64_t)99 << 40) == 99 && !map.find(99));
+		emap[TEST_ENUM_B] = 2;
+		CDS_ASSERT(emap.size() == 1 && *emap.find(TEST_ENUM_B) == 2 && !emap.contains(TEST_ENUM_A));
+	}
+
+	{
+		tiny::hmap<std::string, int> map;
+		char key[32];
+		for (i = 0; i != 1000; i++)
+		{
+			sprintf(key, "key number %d", i);
+			map[key] = i;
+		}
+		CDS_ASSERT(map.size() == 1000 && *map.find("key number 5") == 5 && *map.find(std::string("key number 999")) == 999);
+		#ifdef TINYCPP__STRINGVIEW
+		CDS_ASSERT(*map.find(std::string_view("key number 12345", 14)) == 123);
+		#endif
+		CDS_ASSERT(!map.find("key number") && !map.contains("") && map.erase("key number 0") && !map.erase("key number 0"));
+		CDS_ASSERT(map.size() == 999 && *map.find("key number 999") == 999);
+		n = 0;
+		for (const auto& e : map) n += (e.first == "key number " + std::to_string(e.second));
+		CDS_ASSERT(n == 999);
+	}
+
+	{
+		/* keys with the same hash are chained */
+		tiny::hmap<std::string, test_tracked, test_collide> map;
+		for (i = 0; i != 100; i++)
+			map.try_emplace(std::to_string(i * 7), i);
+		CDS_ASSERT(map.size() == 100);
+		for (n = 0, i = 0; i != 100; i++) n += (map.find(std::to_string(i * 7)) && map.find(std::to_string(i * 7))->v == i);
+		CDS_ASSERT(n == 100 && !map.find("1") && !map.find("1000"));
+		for (i = 0; i < 100; i += 3)
+			CDS_ASSERT(map.erase(std::to_string(i * 7)));
+		for (n = 0, i = 0; i != 100; i++) n += (map.contains(std::to_string(i * 7)) == !!(i % 3));
+		CDS_ASSERT(n == 100 && map.size() == 66 && test_tracked::live == 66);
+		for (i = 1; i < 100; i += 3)
+			CDS_ASSERT(map.erase(std::to_string(i * 7)));
+		for (n = 0, i = 2; i < 100; i += 3) n += (map.find(std::to_string(i * 7)) && map.find(std::to_string(i * 7))->ok());
+		CDS_ASSERT(n == 33 && map.size() == 33);
+	}
+	CDS_ASSERT(test_tracked::live == 0 && test_allocs == 0);
 }
+#endif
 
 int main(int argc, char *argv[])
 {
 	(void)argc; (void)argv;
 	printf("Testing buf...\n");
 	test_buf();
+	printf("Testing sbuf...\n");
+	test_sbuf();
+	printf("Testing rbuf...\n");
+	test_rbuf();
+	printf("Testing heap...\n");
+	test_heap();
+	printf("Testing sort...\n");
+	test_sort();
+	printf("Testing bloom...\n");
+	test_bloom();
 	printf("Testing hmap...\n");
 	test_hmap();
 	printf("Testing hmap64...\n");
 	test_hmap64();
+	printf("Testing hmapbloom...\n");
+	test_hmapbloom();
+	printf("Testing hmaps...\n");
+	test_hmaps();
+	printf("Testing hmapc...\n");
+	test_hmapc();
+	printf("Testing hmapsh...\n");
+	test_hmapsh();
+	printf("Testing hmapd...\n");
+	test_hmapd();
+	printf("Testing cache...\n");
+	test_cache();
+	printf("Testing omap...\n");
+	test_omap();
+	#ifdef __cplusplus
+	printf("Testing cpp...\n");
+	test_cpp();
+	#endif
+	CDS_ASSERT(test_allocs == 0);
 	printf("Done!\n");
 	return 0;
 }
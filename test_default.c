@@ -0,0 +1,170 @@
+/* C Data Structures Default Configuration Test - public domain - Bernhard Schelling 2020
+   https://github.com/schellingb/c-data-structures
+         no warranty implied; use at your own risk
+
+   This is some test code for this project.
+   Unlike test.c it sets none of the options and includes tinyhashmaps.h
+   before the other hash maps, it checks that the headers work in the
+   default configuration and in any order. It should build without any
+   warnings as C and as C++:
+     cc -Wall -Wextra test_default.c -o test_default && ./test_default
+     c++ -Wall -Wextra -x c++ test_default.c -o test_default && ./test_default
+
+   PUBLIC DOMAIN (UNLICENSE)
+
+   This is free and unencumbered software released into the public domain.
+
+   Anyone is free to copy, modify, publish, use, compile, sell, or
+   distribute this software, either in source code form or as a compiled
+   binary, for any purpose, commercial or non-commercial, and by any
+   means.
+
+   In jurisdictions that recognize copyright laws, the author or authors
+   of this software dedicate any and all copyright interest in the
+   software to the public domain. We make this dedication for the benefit
+   of the public at large and to the detriment of our heirs and
+   successors. We intend this dedication to be an overt act of
+   relinquishment in perpetuity of all present and future rights to this
+   software under copyright law.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+   OTHER DEALINGS IN THE SOFTWARE.
+
+   For more information, please refer to <http://unlicense.org/>
+*/
+
+#include "tinyhashmaps.h"
+#include "tinyhashmap.h"
+#include "tinyhashmap64.h"
+#include "tinybuf.h"
+#include "tinysbuf.h"
+#include "tinyrbuf.h"
+#include "tinyheap.h"
+#include "tinysort.h"
+#include "tinybloom.h"
+#include "tinyhashmapc.h"
+#include "tinyhashmapsh.h"
+#include "tinyhashmapd.h"
+#include "tinycache.h"
+#include "tinyomap.h"
+#ifdef __cplusplus
+#include "tinycpp.h"
+#endif
+
+#include <stdio.h>
+#define CDS_ASSERT(cond) (void)((cond) ? ((int)0) : (*(volatile int*)0 = 0xbad|fprintf(stderr, "FAILED ASSERT (%s)\n", #cond )))
+
+static void test_hmaps_first()
+{
+	int* smap = NULL;
+	uint32_t* map = NULL;
+	uint64_t* map64 = NULL;
+	uint32_t i;
+
+	/* The string map defines the wyhash functions before the other maps: */
+	HMAPS_SET_STR(smap, "foo", 1);
+	HMAPS_SET_STR(smap, "bar", 2);
+	CDS_ASSERT(HMAPS_LEN(smap) == 2 && HMAPS_GET_STR(smap, "foo") == 1 && HMAPS_GET_STR(smap, "bar") == 2);
+
+	/* Tables of the other maps still get a seed: */
+	for (i = 1; i != 1000; i++)
+	{
+		HMAP_SET(map, i, i * 3);
+		HMAP64_SET(map64, (uint64_t)i << 32, (uint64_t)i * 5);
+	}
+	CDS_ASSERT(HMAP_LEN(map) == 999 && HMAP64_LEN(map64) == 999);
+	for (i = 1; i != 1000; i++)
+		CDS_ASSERT(HMAP_GET(map, i) == i * 3 && HMAP64_GET(map64, (uint64_t)i << 32) == (uint64_t)i * 5);
+	CDS_ASSERT(HMAP_GET(map, hash_bytes("foo", 3)) == 0 && HMAP64_GET(map64, hash64_bytes("foo", 3)) == 0);
+
+	HMAPS_FREE(smap);
+	HMAP_FREE(map);
+	HMAP64_FREE(map64);
+	CDS_ASSERT(!smap && !map && !map64);
+}
+
+/* Statements of only a CLEAR or FREE macro must not warn (-Wunused-value) */
+static void test_statements()
+{
+	int *buf = NULL, *rbuf = NULL, *map = NULL, *map64 = NULL, *smap = NULL, *cmap = NULL, *dmap = NULL, *cache = NULL, *omap = NULL;
+	int **sbuf = NULL, **shmap = NULL;
+	uint64_t* filter = NULL;
+
+	BUF_PUSH(buf, 1);
+	SBUF_PUSH(sbuf, 2);
+	RBUF_PUSH_BACK(rbuf, 3);
+	HMAP_SET(map, 4, 4);
+	HMAP64_SET(map64, 5, 5);
+	HMAPS_SET_STR(smap, "six", 6);
+	HMAPC_SET(cmap, 7, 7);
+	HMAPSH_INIT(shmap, 4);
+	HMAPSH_SET(shmap, 8, 8);
+	HMAPD_SET(dmap, 9, 9);
+	CDS_ASSERT(CACHE_INIT(cache, 10));
+	CACHE_PUT(cache, 10, 10);
+	OMAP_SET(omap, 11, 11);
+	BLOOM_ADD(filter, 12);
+	CDS_ASSERT(BUF_LEN(buf) == 1 && SBUF_LEN(sbuf) == 1 && RBUF_LEN(rbuf) == 1 && HMAP_LEN(map) == 1 && HMAP64_LEN(map64) == 1 && HMAPS_LEN(smap) == 1);
+	CDS_ASSERT(HMAPC_LEN(cmap) == 1 && HMAPD_LEN(dmap) == 1 && CACHE_LEN(cache) == 1 && OMAP_LEN(omap) == 1 && BLOOM_LEN(filter) == 1);
+
+	BUF_CLEAR(buf);
+	SBUF_CLEAR(sbuf);
+	RBUF_CLEAR(rbuf);
+	HMAP_CLEAR(map);
+	HMAP64_CLEAR(map64);
+	HMAPS_CLEAR(smap);
+	HMAPC_CLEAR(cmap);
+	HMAPD_CLEAR(dmap);
+	CACHE_CLEAR(cache);
+	OMAP_CLEAR(omap);
+	BLOOM_CLEAR(filter);
+	CDS_ASSERT(!BUF_LEN(buf) && !SBUF_LEN(sbuf) && !RBUF_LEN(rbuf) && !HMAP_LEN(map) && !HMAP64_LEN(map64) && !HMAPS_LEN(smap));
+	CDS_ASSERT(!HMAPC_LEN(cmap) && !HMAPD_LEN(dmap) && !CACHE_LEN(cache) && !OMAP_LEN(omap) && !BLOOM_LEN(filter));
+
+	BUF_FREE(buf);
+	SBUF_FREE(sbuf);
+	RBUF_FREE(rbuf);
+	HMAP_FREE(map);
+	HMAP64_FREE(map64);
+	HMAPS_FREE(smap);
+	HMAPC_FREE(cmap);
+	HMAPSH_FREE(shmap);
+	HMAPD_FREE(dmap);
+	CACHE_FREE(cache);
+	OMAP_FREE(omap);
+	BLOOM_FREE(filter);
+	CDS_ASSERT(!buf && !sbuf && !rbuf && !map && !map64 && !smap && !cmap && !shmap && !dmap && !cache && !omap && !filter);
+}
+
+#ifdef __cplusplus
+static void test_cpp()
+{
+	tiny::hmap<int, int> map;
+	tiny::hmap<long long, int> map64;
+	map[1] = 2;
+	map64[3] = 4;
+	CDS_ASSERT(map.size() == 1 && *map.find(1) == 2 && map64.size() == 1 && *map64.find(3) == 4);
+	map.clear();
+	CDS_ASSERT(!map.size() && !map.find(1));
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+	(void)argc; (void)argv;
+	printf("Testing hmaps first...\n");
+	test_hmaps_first();
+	printf("Testing statements...\n");
+	test_statements();
+	#ifdef __cplusplus
+	printf("Testing cpp...\n");
+	test_cpp();
+	#endif
+	printf("Done!\n");
+	return 0;
+}
@@ -0,0 +1,212 @@
+/* TinyBloom - blocked bloom filter - public domain - Bernhard Schelling 2020
+   https://github.com/schellingb/c-data-structures
+         no warranty implied; use at your own risk
+
+   This file implements a bloom filter with 64-bit keys, a compact set
+   which can answer that a key was surely never added or that it was
+   probably added. It is much smaller than the keys themselves so it
+   can stay in the CPU caches, which makes it a quick check in front of
+   a large hash map or a file when most lookups are for missing keys.
+
+   The filter is split into blocks of one 64 byte cache line and all 8
+   bits of a key are in the same block (one bit in each 64-bit word of
+   it), so adding and checking a key touch a single cache line.
+   With the default of 12 bits per expected key, around 0.5% of checks
+   for missing keys answer that the key was probably added. When more
+   keys than expected get added this gets worse, the filter can't grow
+   because it doesn't keep the keys (and keys can't be removed).
+   TinyHashMap can keep such a filter next to a map, see
+   TINYHASHMAP_BLOOM in tinyhashmap.h.
+
+   Be careful not to supply modifying statements to the macro arguments.
+   Something like BLOOM_ADD(filter, keys[i++]); would have unintended results.
+
+   Sample usage:
+
+   -- Make a filter for 1 million keys with 12 bits per key:
+   uint64_t* filter = NULL;
+   BLOOM_INIT(filter, 1000000, 12);
+   -- now BLOOM_CAP(filter) == 1000000, BLOOM_SIZEOF(filter) == 2 MB
+   -- (the number of blocks is a power of two which fits the bits)
+   -- A filter without BLOOM_INIT is made for 1024 keys with 12 bits each
+
+   -- Add keys (any 64-bit values, they get mixed before use):
+   BLOOM_ADD(filter, 123);
+   BLOOM_ADD(filter, hash_of_some_string);
+   -- now BLOOM_LEN(filter) == 2 (the number of times a key was added)
+
+   -- Check keys:
+   if (!BLOOM_HAS(filter, 456))
+   ------ here key 456 was surely never added
+   -- BLOOM_HAS(filter, 123) is always true
+
+   -- Remove all keys, free allocated memory:
+   BLOOM_CLEAR(filter);
+   BLOOM_FREE(filter);
+   -- now filter == NULL, BLOOM_LEN(filter) == 0, BLOOM_CAP(filter) == 0
+
+   -- To handle running out of memory:
+   bool ran_out_of_memory = !BLOOM_INIT(filter, 1000000, 12);
+   -- BLOOM_INIT on an existing filter drops all of its keys
+
+   -- Use a custom allocator:
+   #define TINYBLOOM_MALLOC(ctx, size) my_malloc(size)
+   #define TINYBLOOM_FREE(ctx, ptr) my_free(ptr)
+   -- before including this file (ctx is always NULL)
+
+   PUBLIC DOMAIN (UNLICENSE)
+
+   This is free and unencumbered software released into the public domain.
+
+   Anyone is free to copy, modify, publish, use, compile, sell, or
+   distribute this software, either in source code form or as a compiled
+   binary, for any purpose, commercial or non-commercial, and by any
+   means.
+
+   In jurisdictions that recognize copyright laws, the author or authors
+   of this software dedicate any and all copyright interest in the
+   software to the public domain. We make this dedication for the benefit
+   of the public at large and to the detriment of our heirs and
+   successors. We intend this dedication to be an overt act of
+   relinquishment in perpetuity of all present and future rights to this
+   software under copyright law.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+   OTHER DEALINGS IN THE SOFTWARE.
+
+   For more information, please refer to <http://unlicense.org/>
+*/
+
+#ifndef TINYBLOOM_H
+#define TINYBLOOM_H
+
+#include <stdlib.h> /* for malloc, free */
+#include <string.h> /* for memset */
+#include <stddef.h> /* for size_t */
+#if defined(_MSC_VER) && (_MSC_VER < 1600)
+#define BLOOM__U64 unsigned __int64
+#else
+#include <stdint.h> /* for uint64_t */
+#define BLOOM__U64 uint64_t
+#endif
+
+#ifndef TINYBLOOM_MALLOC
+#define TINYBLOOM_MALLOC(ctx, size) malloc(size)
+#define TINYBLOOM_FREE(ctx, ptr) free(ptr)
+#endif
+
+#define BLOOM_LEN(f) ((f) ? BLOOM__HDR(f)->len : 0)
+#define BLOOM_CAP(f) ((f) ? BLOOM__HDR(f)->cap : 0)
+#define BLOOM_SIZEOF(f) ((f) ? (BLOOM__HDR(f)->mask + 1) * BLOOM__BLOCK : 0)
+#define BLOOM_INIT(f, n, bits_per_key) ((*(void**)(&(f)) = bloom__make(((f) ? BLOOM__HDR(f)->mem : NULL), (size_t)(n), (size_t)(bits_per_key))) != NULL)
+#define BLOOM_ADD(f, key) (BLOOM__FIT0(f), bloom__add((f), (BLOOM__U64)(key)), BLOOM__HDR(f)->len++)
+#define BLOOM_HAS(f, key) ((f) ? bloom__has((f), (BLOOM__U64)(key)) : 0)
+#define BLOOM_CLEAR(f) ((f) ? (memset((f), 0, BLOOM_SIZEOF(f)), BLOOM__HDR(f)->len = 0) : 0)
+#define BLOOM_FREE(f) ((f) ? (TINYBLOOM_FREE(NULL, BLOOM__HDR(f)->mem), (f) = NULL) : 0)
+
+/* The header is right before the cache line aligned blocks, mem is the start of the allocation and allocctx the allocator of its owner */
+struct bloom__hdr { size_t len, cap, bits, mask; void *mem, *allocctx; };
+#define BLOOM__HDR(f) (((struct bloom__hdr *)(void*)(f))-1)
+#define BLOOM__BLOCK 64 /* bytes per block, 8 words of 64 bits */
+#define BLOOM__MEMSIZE(blocks) (BLOOM__BLOCK - 1 + sizeof(struct bloom__hdr) + (blocks) * BLOOM__BLOCK)
+#define BLOOM__FIT0(f) ((f) ? 0 : BLOOM_INIT(f, 1024, 12))
+
+#if defined(_MSC_VER)
+#pragma warning(push)
+#pragma warning(disable:4505) //unreferenced local function has been removed
+#endif
+
+/* Returns the number of blocks (a power of two) for n keys with bits per key, 0 on overflow */
+#ifdef __GNUC__
+__attribute__((__unused__))
+#endif
+static size_t bloom__blocks(size_t n, size_t bits)
+{
+	size_t need, blocks = 1;
+	if (!bits)
+		bits = 12;
+	if (n > ((size_t)-1 - BLOOM__BLOCK * 8) / bits)
+		return 0; /* overflow */
+	for (need = (n * bits + BLOOM__BLOCK * 8 - 1) / (BLOOM__BLOCK * 8); blocks < need;)
+		if (!(blocks *= 2) || blocks > ((size_t)-1 - BLOOM__BLOCK - sizeof(struct bloom__hdr)) / BLOOM__BLOCK)
+			return 0; /* overflow */
+	return blocks;
+}
+
+/* Sets up an empty filter in mem of at least BLOOM__MEMSIZE(blocks) bytes, returns the aligned blocks */
+#ifdef __GNUC__
+__attribute__((__unused__))
+#endif
+static BLOOM__U64 *bloom__place(void *mem, void *ctx, size_t blocks, size_t n, size_t bits)
+{
+	char *p = (char*)mem + sizeof(struct bloom__hdr);
+	struct bloom__hdr *hdr = (struct bloom__hdr *)(p + ((BLOOM__BLOCK - (size_t)p) & (BLOOM__BLOCK - 1))) - 1;
+	hdr->len = 0;
+	hdr->cap = n;
+	hdr->bits = (bits ? bits : 12);
+	hdr->mask = blocks - 1;
+	hdr->mem = mem;
+	hdr->allocctx = ctx;
+	memset(hdr + 1, 0, blocks * BLOOM__BLOCK);
+	return (BLOOM__U64 *)(hdr + 1);
+}
+
+/* Makes an empty filter for n keys and frees the memory of the previous one, returns NULL on overflow or when out of memory */
+#ifdef __GNUC__
+__attribute__((__unused__))
+#endif
+static void *bloom__make(void *old_mem, size_t n, size_t bits)
+{
+	size_t blocks = bloom__blocks(n, bits);
+	void *mem;
+	if (old_mem)
+		TINYBLOOM_FREE(NULL, old_mem);
+	if (!blocks || !(mem = TINYBLOOM_MALLOC(NULL, BLOOM__MEMSIZE(blocks))))
+		return NULL; /* overflow or out of memory */
+	return bloom__place(mem, NULL, blocks, n, bits);
+}
+
+/* Mixes the key (murmur3 finalizer), the high half picks the block and the low half one bit in each of its words */
+#define BLOOM__MIX(h) ((h) ^= (h) >> 33, (h) *= (BLOOM__U64)0xff51afd7ed558ccd, (h) ^= (h) >> 33, (h) *= (BLOOM__U64)0xc4ceb9fe1a85ec53, (h) ^= (h) >> 33)
+#define BLOOM__BIT(h, salt) ((BLOOM__U64)1 << ((unsigned int)((h) * (salt)) >> 26))
+static const unsigned int bloom__salts[8] = { 0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU, 0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U };
+
+#ifdef __GNUC__
+__attribute__((__unused__))
+#endif
+static void bloom__add(BLOOM__U64 *f, BLOOM__U64 key)
+{
+	BLOOM__U64 h = key, *block;
+	unsigned int lo, i;
+	BLOOM__MIX(h);
+	block = f + ((size_t)(h >> 32) & BLOOM__HDR(f)->mask) * 8;
+	for (lo = (unsigned int)h, i = 0; i != 8; i++)
+		block[i] |= BLOOM__BIT(lo, bloom__salts[i]);
+}
+
+/* Returns 0 if key was surely never added */
+#ifdef __GNUC__
+__attribute__((__unused__))
+#endif
+static int bloom__has(const BLOOM__U64 *f, BLOOM__U64 key)
+{
+	BLOOM__U64 h = key, missing = 0;
+	const BLOOM__U64 *block;
+	unsigned int lo, i;
+	BLOOM__MIX(h);
+	block = f + ((size_t)(h >> 32) & BLOOM__HDR(f)->mask) * 8;
+	for (lo = (unsigned int)h, i = 0; i != 8; i++)
+		missing |= ~block[i] & BLOOM__BIT(lo, bloom__salts[i]);
+	return !missing;
+}
+
+#if defined(_MSC_VER)
+#pragma warning(pop)
+#endif
+
+#endif
@@ -9,7 +9,8 @@
    It's a super simple type safe dynamic array for C with no need
    to predeclare any type or anything.
    The first time an element is added, memory for 16 elements are allocated.
-   Then every time length is about to exceed capacity, capacity is doubled.
+   Then every time length is about to exceed capacity, capacity is doubled
+   (this can be changed per buffer with TINYBUF_GROWTH, see below).
    Can be used in C++ with POD types (without any constructor/destructor).
 
    Be careful not to supply modifying statements to the macro arguments.
@@ -30,6 +31,10 @@
    BUF_FIT(buf, 100);
    -- now BUF_LEN(buf) == 0, BUF_CAP(buf) == 100
 
+   -- Set capacity to exactly N when it is smaller (no doubling):
+   BUF_FITEXACT(buf, 150);
+   -- now BUF_LEN(buf) == 0, BUF_CAP(buf) == 150
+
    -- Resize buffer (does not initialize or zero memory!):
    BUF_RESIZE(buf, 200);
    -- now BUF_LEN(buf) == 200, BUF_CAP(buf) == 200
@@ -62,6 +67,50 @@
    bool ran_out_of_memory = !BUF_TRYFIT(buf, 1000);
    -- before RESIZE or PUSH. When out of memory, buf will stay unmodified.
 
+   -- Start with storage on the stack or inside a struct (no allocation):
+   BUF_INLINE(mytype_t, 8) storage;
+   mytype_t* buf = BUF_INITINLINE(storage);
+   -- now BUF_LEN(buf) == 0, BUF_CAP(buf) == 8, buf points into storage
+   -- All macros work as usual, once more than 8 elements are needed the
+   -- elements get copied to the heap and storage isn't used anymore
+   -- BUF_FREE(buf) only frees heap memory, storage must outlive buf
+
+   -- Release unused memory:
+   BUF_SHRINK(buf);
+   -- now BUF_CAP(buf) == BUF_LEN(buf), memory gets reallocated to fit
+   -- Capacity is never released otherwise, to only do it after the length
+   -- dropped a lot (so pushing again doesn't immediately grow) use:
+   if (BUF_LEN(buf) < BUF_CAP(buf) / 4) BUF_SHRINK(buf);
+
+   -- Use a custom allocator (for example an arena):
+   #define TINYBUF_MALLOC(ctx, size) my_malloc(ctx, size)
+   #define TINYBUF_REALLOC(ctx, ptr, old_size, new_size) my_realloc(ctx, ptr, old_size, new_size)
+   #define TINYBUF_FREE(ctx, ptr) my_free(ctx, ptr)
+   -- before including this file, then per buffer:
+   BUF_SETALLOC(buf, my_arena);
+   -- now all memory of buf comes from my_arena (ctx is NULL by default)
+   -- If buf already has memory, it gets moved over to the new context
+
+   -- Change how a buffer grows:
+   #define TINYBUF_GROWTH
+   -- before including this file, then per buffer:
+   BUF_SETGROWTH(buf, 150, 1 << 20);
+   -- now capacity grows by 50% but by no more than 1M elements at a time
+   -- (percent 0 is the default of 200, maxstep 0 means no limit)
+   -- The buffer header stores these two settings only with TINYBUF_GROWTH
+
+   -- Keep huge buffers in their own memory mapping:
+   #define TINYBUF_MMAP
+   -- before including this file (implies TINYBUF_GROWTH), then every buffer
+   -- that needs TINYBUF_MMAP_THRESHOLD bytes (default 32 MB) or more is moved
+   -- into anonymous pages (from mmap or VirtualAlloc, not from the allocator)
+   -- On Linux, growing it again uses mremap which moves the page mappings
+   -- instead of copying, and transparent huge pages are requested for it
+   -- (define TINYBUF_MMAP_HUGEPAGES 0 to not request them)
+   -- Such a buffer stays mapped, its capacity gets rounded up to fill 64 KB
+   -- and BUF_SHRINK releases the pages past the last 64 KB that is used
+   -- This needs MAP_ANONYMOUS (for example _GNU_SOURCE) on POSIX systems
+
    PUBLIC DOMAIN (UNLICENSE)
 
    This is free and unencumbered software released into the public domain.
@@ -93,24 +142,71 @@
 #ifndef TINYBUF_H
 #define TINYBUF_H
 
-#include <stdlib.h> /* for malloc, realloc */
-#include <string.h> /* for memmove, memset */
+#include <stdlib.h> /* for malloc, realloc, free */
+#include <string.h> /* for memcpy, memmove, memset */
 #include <stddef.h> /* for size_t */
 
+#ifdef TINYBUF_MALLOC
+#define BUF__ALLOCCTX 1
+#else
+#define BUF__ALLOCCTX 0
+#define TINYBUF_MALLOC(ctx, size) malloc(size)
+#define TINYBUF_REALLOC(ctx, ptr, old_size, new_size) realloc(ptr, new_size)
+#define TINYBUF_FREE(ctx, ptr) free(ptr)
+#endif
+
+#if defined(TINYBUF_GROWTH) || defined(TINYBUF_MMAP)
+#define BUF__POLICY 1
+#else
+#define BUF__POLICY 0
+#endif
+
+#ifdef TINYBUF_MMAP
+#ifndef TINYBUF_MMAP_THRESHOLD
+#define TINYBUF_MMAP_THRESHOLD (32 << 20)
+#endif
+#ifndef TINYBUF_MMAP_HUGEPAGES
+#define TINYBUF_MMAP_HUGEPAGES 1
+#endif
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h> /* for VirtualAlloc, VirtualFree */
+#else
+#include <sys/mman.h> /* for mmap, mremap, munmap, madvise */
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#elif !defined(MAP_ANONYMOUS)
+#error TINYBUF_MMAP needs MAP_ANONYMOUS, define _GNU_SOURCE or _DEFAULT_SOURCE before including system headers
+#endif
+#endif
+#endif
+
 /* Query functions */
 #define BUF_LEN(b) ((b) ? BUF__HDR(b)->len : 0)
-#define BUF_CAP(b) ((b) ? BUF__HDR(b)->cap : 0)
+#define BUF_CAP(b) ((b) ? BUF__HDR(b)->cap & ~BUF__INLINE : 0)
 #define BUF_END(b) ((b) + BUF_LEN(b))
 #define BUF_SIZEOF(b) ((b) ? BUF_LEN(b) * sizeof(*b) : 0)
 
 /* Modifying functions */
-#define BUF_FREE(b)       ((b) ? (free(BUF__HDR(b)), (*(void**)(&(b)) = (void*)0)) : 0)
-#define BUF_FIT(b, n)     ((size_t)(n) <= BUF_CAP(b) ? 0 : (*(void**)(&(b)) = buf__grow((b), (size_t)(n), sizeof(*(b)))))
+#define BUF_FREE(b)       ((b) ? (buf__release((b), sizeof(*(b))), (*(void**)(&(b)) = (void*)0)) : 0)
+#define BUF_FIT(b, n)     ((size_t)(n) <= BUF_CAP(b) ? 0 : (*(void**)(&(b)) = buf__grow((b), (size_t)(n), sizeof(*(b)), 0)))
+#define BUF_FITEXACT(b, n) ((size_t)(n) <= BUF_CAP(b) ? 0 : (*(void**)(&(b)) = buf__grow((b), (size_t)(n), sizeof(*(b)), 1)))
 #define BUF_PUSH(b, val)  (BUF_FIT((b), BUF_LEN(b) + 1), (b)[BUF__HDR(b)->len++] = (val))
 #define BUF_POP(b)        (b)[--BUF__HDR(b)->len]
 #define BUF_RESIZE(b, sz) (BUF_FIT((b), (sz)), ((b) ? BUF__HDR(b)->len = (sz) : 0))
 #define BUF_CLEAR(b)      ((b) ? BUF__HDR(b)->len = 0 : 0)
 #define BUF_TRYFIT(b, n)  (BUF_FIT((b), (n)), (((b) && BUF_CAP(b) >= (size_t)(n)) || !(n)))
+#define BUF_SHRINK(b)     ((b) && BUF_LEN(b) < BUF_CAP(b) ? (*(void**)(&(b)) = buf__shrink((b), sizeof(*(b)))) : 0)
+#if BUF__ALLOCCTX
+#define BUF_SETALLOC(b, ctx) ((b) && BUF__CTX(b) == (ctx) ? 0 : (*(void**)(&(b)) = buf__setalloc((b), sizeof(*(b)), (ctx))))
+#endif
+#define BUF_INLINE(type, n) struct { struct buf__hdr hdr; type elems[n]; }
+#define BUF_INITINLINE(storage) ((void)buf__initinline(&(storage).hdr, sizeof((storage).elems) / sizeof((storage).elems[0])), (storage).elems)
+#if BUF__POLICY
+#define BUF_SETGROWTH(b, pct, step) (BUF_FIT((b), 1), ((b) ? (BUF__HDR(b)->growth = (BUF__HDR(b)->growth & BUF__MAPPED) | (size_t)(pct), BUF__HDR(b)->maxstep = (size_t)(step)) : 0))
+#endif
 
 /* Utility functions */
 #define BUF_SHIFT(b, to, fr, n) ((b) ? memmove((b) + (to), (b) + (fr), (n) * sizeof(*(b))) : 0)
@@ -123,37 +219,271 @@
 #define BUF_ADDZEROED(b, n)     (BUF_FIT(b, BUF_LEN(b) + (n)), BUF_ZERO(b, BUF_LEN(b), n), (b) + (BUF__HDR(b)->len += (n)) - (n))
 
 #define BUF__HDR(b) (((struct buf__hdr *)(b))-1)
-struct buf__hdr { size_t len, cap; };
+#if BUF__ALLOCCTX
+#define BUF__CTX(b) (BUF__HDR(b)->allocctx)
+#else
+#define BUF__CTX(b) ((void*)0)
+#endif
+struct buf__hdr
+{
+	size_t len, cap;
+	#if BUF__ALLOCCTX
+	void *allocctx, *pad; /* pad keeps elements aligned to two size_t */
+	#endif
+	#if BUF__POLICY
+	size_t growth, maxstep; /* growth in percent (0 means 200) combined with the BUF__MAPPED flag, maxstep in elements (0 means no limit) */
+	#endif
+};
+#define BUF__INLINE ((size_t)1 << (sizeof(size_t) * 8 - 1)) /* flag in cap, set while the elements are in caller provided storage */
+#define BUF__ISINLINE(b) (BUF__HDR(b)->cap & BUF__INLINE)
+#define BUF__MAPPED ((size_t)1 << (sizeof(size_t) * 8 - 1))
+#define BUF__MAPALIGN ((size_t)65536) /* mapped sizes are rounded to 64 KB (page sizes up to that and the Windows allocation granularity) */
+#define BUF__MAPSIZE(cap, elem_size) ((sizeof(struct buf__hdr) + (cap) * (elem_size) + BUF__MAPALIGN - 1) & ~(BUF__MAPALIGN - 1))
+#define BUF__ISMAPPED(b) (BUF__HDR(b)->growth & BUF__MAPPED)
 
-#ifdef __GNUC__
-__attribute__((__unused__))
-#elif defined(_MSC_VER)
+#if defined(_MSC_VER)
 #pragma warning(push)
 #pragma warning(disable:4505) //unreferenced local function has been removed
 #endif
-static void *buf__grow(void *buf, size_t new_len, size_t elem_size)
+
+#ifdef TINYBUF_MMAP
+#ifdef __GNUC__
+__attribute__((__unused__))
+#endif
+static void *buf__map(size_t size)
+{
+	#ifdef _WIN32
+	return VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	#else
+	void* p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED)
+		return NULL;
+	#if defined(MADV_HUGEPAGE) && TINYBUF_MMAP_HUGEPAGES
+	madvise(p, size, MADV_HUGEPAGE);
+	#endif
+	return p;
+	#endif
+}
+
+#ifdef __GNUC__
+__attribute__((__unused__))
+#endif
+static void buf__unmap(void *p, size_t size)
+{
+	#ifdef _WIN32
+	(void)size;
+	VirtualFree(p, 0, MEM_RELEASE);
+	#else
+	munmap(p, size);
+	#endif
+}
+
+/* Resizes a mapping keeping its first used bytes, returns NULL if out of memory (p stays valid) */
+#ifdef __GNUC__
+__attribute__((__unused__))
+#endif
+static void *buf__remap(void *p, size_t old_size, size_t new_size, size_t used)
+{
+	void* new_p;
+	if (new_size < old_size)
+	{
+		/* release the tail, the pages stay where they are */
+		#ifdef _WIN32
+		VirtualFree((char*)p + new_size, old_size - new_size, MEM_DECOMMIT);
+		#else
+		munmap((char*)p + new_size, old_size - new_size);
+		#endif
+		return p;
+	}
+	#ifdef MREMAP_MAYMOVE
+	/* the kernel moves the page mappings so nothing gets copied */
+	(void)used;
+	new_p = mremap(p, old_size, new_size, MREMAP_MAYMOVE);
+	if (new_p == MAP_FAILED)
+		return NULL;
+	#if defined(MADV_HUGEPAGE) && TINYBUF_MMAP_HUGEPAGES
+	madvise(new_p, new_size, MADV_HUGEPAGE);
+	#endif
+	#else
+	if ((new_p = buf__map(new_size)) == NULL)
+		return NULL;
+	memcpy(new_p, p, used);
+	buf__unmap(p, old_size);
+	#endif
+	return new_p;
+}
+
+/* Moves or grows a buffer into its own mapping of new_cap elements (or more to fill the last 64 KB) */
+#ifdef __GNUC__
+__attribute__((__unused__))
+#endif
+static void *buf__growmapped(void *buf, size_t new_cap, size_t elem_size)
+{
+	struct buf__hdr *new_hdr;
+	size_t new_size = BUF__MAPSIZE(new_cap, elem_size);
+	if (new_cap > ((size_t)-1 - sizeof(struct buf__hdr) - BUF__MAPALIGN) / elem_size)
+		return buf; /* out of memory, return unchanged */
+	if (buf && BUF__ISMAPPED(buf))
+	{
+		new_hdr = (struct buf__hdr *)buf__remap(BUF__HDR(buf), BUF__MAPSIZE(BUF_CAP(buf), elem_size), new_size, sizeof(struct buf__hdr) + BUF_LEN(buf)*elem_size);
+		if (!new_hdr)
+			return buf; /* out of memory, return unchanged */
+	}
+	else
+	{
+		new_hdr = (struct buf__hdr *)buf__map(new_size);
+		if (!new_hdr)
+			return buf; /* out of memory, return unchanged */
+		if (buf)
+		{
+			memcpy(new_hdr, BUF__HDR(buf), sizeof(struct buf__hdr) + BUF_LEN(buf)*elem_size);
+			if (!BUF__ISINLINE(buf))
+				TINYBUF_FREE(BUF__CTX(buf), BUF__HDR(buf));
+		}
+		/* a new mapping is zeroed so a new header starts with len 0 and default growth settings */
+		new_hdr->growth |= BUF__MAPPED;
+	}
+	/* with elements larger than the rounding the capacity stays exact so BUF__MAPSIZE gives back the same size */
+	new_hdr->cap = (elem_size <= BUF__MAPALIGN ? (new_size - sizeof(struct buf__hdr)) / elem_size : new_cap);
+	return new_hdr + 1;
+}
+#endif
+
+#ifdef __GNUC__
+__attribute__((__unused__))
+#endif
+static void buf__release(void *buf, size_t elem_size)
+{
+	(void)elem_size;
+	if (BUF__ISINLINE(buf))
+		return; /* caller provided storage */
+	#ifdef TINYBUF_MMAP
+	if (BUF__ISMAPPED(buf))
+	{
+		buf__unmap(BUF__HDR(buf), BUF__MAPSIZE(BUF_CAP(buf), elem_size));
+		return;
+	}
+	#endif
+	TINYBUF_FREE(BUF__CTX(buf), BUF__HDR(buf));
+}
+
+#ifdef __GNUC__
+__attribute__((__unused__))
+#endif
+static void *buf__initinline(struct buf__hdr *hdr, size_t cap)
+{
+	memset(hdr, 0, sizeof(struct buf__hdr));
+	hdr->cap = cap | BUF__INLINE;
+	return hdr + 1;
+}
+
+#ifdef __GNUC__
+__attribute__((__unused__))
+#endif
+static void *buf__grow(void *buf, size_t new_len, size_t elem_size, int exact)
 {
 	struct buf__hdr *new_hdr;
 	size_t new_cap = 2 * BUF_CAP(buf), new_size;
-	if (new_cap < new_len) new_cap = new_len;
-	if (new_cap <      16) new_cap = 16;
+	#if BUF__POLICY
+	size_t cap = BUF_CAP(buf), growth = (buf ? BUF__HDR(buf)->growth & ~BUF__MAPPED : 0), maxstep = (buf ? BUF__HDR(buf)->maxstep : 0);
+	if (growth)
+		new_cap = (growth > 100 ? cap + (cap / 100) * (growth - 100) + ((cap % 100) * (growth - 100)) / 100 : cap);
+	if (maxstep && new_cap - cap > maxstep)
+		new_cap = cap + maxstep;
+	#endif
+	if (exact || new_cap < new_len) new_cap = new_len;
+	if (new_cap < 16 && !exact) new_cap = 16;
 	new_size = sizeof(struct buf__hdr) + new_cap*elem_size;
-	if (buf)
+	#ifdef TINYBUF_MMAP
+	if (new_size >= TINYBUF_MMAP_THRESHOLD || (buf && BUF__ISMAPPED(buf)))
+		return buf__growmapped(buf, new_cap, elem_size);
+	#endif
+	if (buf && !BUF__ISINLINE(buf))
 	{
-		new_hdr = (struct buf__hdr *)realloc(BUF__HDR(buf), new_size);
+		new_hdr = (struct buf__hdr *)TINYBUF_REALLOC(BUF__CTX(buf), BUF__HDR(buf), sizeof(struct buf__hdr) + BUF_CAP(buf)*elem_size, new_size);
 		if (!new_hdr)
 			return buf; /* out of memory, return unchanged */
 	}
+	else if (buf)
+	{
+		/* move out of the caller provided storage, which stays untouched */
+		new_hdr = (struct buf__hdr *)TINYBUF_MALLOC(BUF__CTX(buf), new_size);
+		if (!new_hdr)
+			return buf; /* out of memory, return unchanged */
+		memcpy(new_hdr, BUF__HDR(buf), sizeof(struct buf__hdr) + BUF_LEN(buf)*elem_size);
+	}
 	else
 	{
-		new_hdr = (struct buf__hdr *)malloc(new_size);
+		new_hdr = (struct buf__hdr *)TINYBUF_MALLOC((void*)0, new_size);
 		if (!new_hdr)
 			return (void*)0; /* out of memory */
 		new_hdr->len = 0;
+		#if BUF__ALLOCCTX
+		new_hdr->allocctx = (void*)0;
+		#endif
+		#if BUF__POLICY
+		new_hdr->growth = new_hdr->maxstep = 0;
+		#endif
 	}
 	new_hdr->cap = new_cap;
 	return new_hdr + 1;
 }
+
+#ifdef __GNUC__
+__attribute__((__unused__))
+#endif
+static void *buf__shrink(void *buf, size_t elem_size)
+{
+	/* the header stays allocated (even with no elements) so the allocator context is kept */
+	struct buf__hdr *new_hdr;
+	if (BUF__ISINLINE(buf))
+		return buf; /* caller provided storage can't be released */
+	#ifdef TINYBUF_MMAP
+	if (BUF__ISMAPPED(buf))
+	{
+		size_t new_size = BUF__MAPSIZE(BUF_LEN(buf), elem_size);
+		new_hdr = (struct buf__hdr *)buf__remap(BUF__HDR(buf), BUF__MAPSIZE(BUF_CAP(buf), elem_size), new_size, 0);
+		new_hdr->cap = (elem_size <= BUF__MAPALIGN ? (new_size - sizeof(struct buf__hdr)) / elem_size : new_hdr->len);
+		return new_hdr + 1;
+	}
+	#endif
+	new_hdr = (struct buf__hdr *)TINYBUF_REALLOC(BUF__CTX(buf), BUF__HDR(buf), sizeof(struct buf__hdr) + BUF_CAP(buf)*elem_size, sizeof(struct buf__hdr) + BUF_LEN(buf)*elem_size);
+	if (!new_hdr)
+		return buf; /* out of memory, return unchanged */
+	new_hdr->cap = new_hdr->len;
+	return new_hdr + 1;
+}
+
+#if BUF__ALLOCCTX
+#ifdef __GNUC__
+__attribute__((__unused__))
+#endif
+static void *buf__setalloc(void *buf, size_t elem_size, void *ctx)
+{
+	size_t cap = (buf ? BUF_CAP(buf) : 16), new_size = sizeof(struct buf__hdr) + cap*elem_size;
+	struct buf__hdr *new_hdr = (struct buf__hdr *)TINYBUF_MALLOC(ctx, new_size);
+	if (!new_hdr)
+		return buf; /* out of memory, return unchanged */
+	if (buf)
+	{
+		memcpy(new_hdr, BUF__HDR(buf), sizeof(struct buf__hdr) + BUF_LEN(buf)*elem_size);
+		buf__release(buf, elem_size);
+		#ifdef TINYBUF_MMAP
+		new_hdr->growth &= ~BUF__MAPPED;
+		#endif
+	}
+	else
+	{
+		new_hdr->len = 0;
+		#if BUF__POLICY
+		new_hdr->growth = new_hdr->maxstep = 0;
+		#endif
+	}
+	new_hdr->cap = cap;
+	new_hdr->allocctx = ctx;
+	return new_hdr + 1;
+}
+#endif
 #if defined(_MSC_VER)
 #pragma warning(pop)
 #endif
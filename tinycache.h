@@ -0,0 +1,231 @@
+/* TinyCache - bounded cache with CLOCK eviction - public domain - Bernhard Schelling 2020
+   https://github.com/schellingb/c-data-structures
+         no warranty implied; use at your own risk
+
+   This file implements a cache with 32-bit keys which holds at most a
+   fixed number of elements. When a new key is added to a full cache,
+   an element which was not used recently gets evicted in its place.
+   Eviction uses the CLOCK algorithm: every element has a reference bit
+   which gets set whenever the element is used, a hand sweeps over the
+   elements clearing the bits and evicts the first one without it.
+
+   Like TinyHashMapD, keys, values and reference bits are in dense
+   arrays indexed by the slot of the element and the hash table is a
+   TinyHashMap which only stores the slot of each key. Slots don't move
+   when other keys are added or evicted so no list needs fixing up, a
+   hit costs one lookup in the hash table and never allocates. All
+   memory is allocated when the cache is made, the hash table already
+   fits the capacity so adding and evicting doesn't allocate either.
+   Can be used in C++ with POD types.
+
+   Be careful not to supply modifying statements to the macro arguments.
+   Something like CACHE_PUT(cache, i++, val); would have unintended results.
+
+   Sample usage:
+
+   -- Make a cache for mytype_t values with room for 1000 elements:
+   mytype_t* cache = NULL;
+   CACHE_INIT(cache, 1000);
+   -- now CACHE_CAP(cache) == 1000, a cache without CACHE_INIT holds 16
+
+   -- Add or use elements:
+   CACHE_PUT(cache, 123, some_element);
+   CACHE_PUT_STR(cache, "foo", other_element);
+   mytype_t elem = CACHE_GET(cache, 123);
+   -- CACHE_GET returns the null value (zeroed unless set with
+   -- CACHE_SETNULLVAL) if the key is not in the cache (anymore)
+   -- _GET/_PUT/_PTR/_HAS/_DEL/_IDX exist for _STR, _BYTES and custom hash
+   -- keys like in TinyHashMap, the key 0 is not allowed
+
+   -- Get a pointer to the element of a key, adding it if it is missing:
+   mytype_t* p = CACHE_PTR(cache, 456);
+   if (CACHE_EVICTED(cache))
+   ------ here key 456 was added in place of key CACHE_EVICTED(cache) and *p
+   ------ still holds the evicted value (so it can be released)
+   -- CACHE_EVICTED(cache) is the key evicted by the last PUT or PTR or 0
+
+   -- GET, PUT, PTR and IDX mark an element as used, HAS and DEL don't
+
+   -- Iterate elements (in no particular order):
+   for (size_t i = 0; i != CACHE_LEN(cache); i++)
+   ------ here cache[i] is the value of key CACHE_KEY(cache, i)
+   -- Deleting moves the last element into the slot of the deleted one
+
+   -- Also like TinyHashMap:
+   CACHE_CLEAR(cache), CACHE_FREE(cache),
+   bool ran_out_of_memory = !CACHE_INIT(cache, 1000);
+   -- CACHE_INIT on an existing cache drops all of its elements
+
+   PUBLIC DOMAIN (UNLICENSE)
+
+   This is free and unencumbered software released into the public domain.
+
+   Anyone is free to copy, modify, publish, use, compile, sell, or
+   distribute this software, either in source code form or as a compiled
+   binary, for any purpose, commercial or non-commercial, and by any
+   means.
+
+   In jurisdictions that recognize copyright laws, the author or authors
+   of this software dedicate any and all copyright interest in the
+   software to the public domain. We make this dedication for the benefit
+   of the public at large and to the detriment of our heirs and
+   successors. We intend this dedication to be an overt act of
+   relinquishment in perpetuity of all present and future rights to this
+   software under copyright law.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+   OTHER DEALINGS IN THE SOFTWARE.
+
+   For more information, please refer to <http://unlicense.org/>
+*/
+
+#ifndef TINYCACHE_H
+#define TINYCACHE_H
+
+#include "tinyhashmap.h"
+
+#define CACHE_LEN(b) ((b) ? CACHE__HDR(b)->len : 0)
+#define CACHE_CAP(b) ((b) ? CACHE__HDR(b)->cap : 0)
+#define CACHE_KEY(b, idx) (CACHE__HDR(b)->keys[idx])
+#define CACHE_EVICTED(b) ((b) ? CACHE__HDR(b)->evicted : 0)
+#define CACHE_SETNULLVAL(b, val) (CACHE__FIT0(b), (b)[-1] = (val))
+#define CACHE_CLEAR(b) ((b) ? (HMAP_CLEAR(CACHE__HDR(b)->index), CACHE__HDR(b)->len = CACHE__HDR(b)->hand = 0, CACHE__HDR(b)->evicted = 0) : 0)
+#define CACHE_FREE(b) ((b) ? (HMAP_FREE(CACHE__HDR(b)->index), TINYHASHMAP_FREE(NULL, CACHE__HDR(b)), (b) = NULL) : 0)
+#define CACHE_INIT(b, n) ((*(void**)(&(b)) = cache__init(((b) ? CACHE__HDR(b) : NULL), sizeof(*(b)), (size_t)(n))) != NULL)
+
+#define CACHE_PUT(b, key, val) (CACHE__FIT0(b), (b)[cache__idx(CACHE__HDR(b), (key), CACHE__ADD, sizeof(*(b)))] = (val))
+#define CACHE_GET(b, key) (CACHE__FIT0(b), (b)[cache__idx(CACHE__HDR(b), (key), CACHE__USE, sizeof(*(b)))])
+#define CACHE_HAS(b, key) ((b) ? cache__idx(CACHE__HDR(b), (key), CACHE__PEEK, sizeof(*(b))) != -1 : 0)
+#define CACHE_DEL(b, key) ((b) ? cache__idx(CACHE__HDR(b), (key), CACHE__DEL, sizeof(*(b))) != -1 : 0)
+#define CACHE_PTR(b, key) (CACHE__FIT0(b), &(b)[cache__idx(CACHE__HDR(b), (key), CACHE__ADD, sizeof(*(b)))])
+#define CACHE_IDX(b, key) ((b) ? cache__idx(CACHE__HDR(b), (key), CACHE__USE, sizeof(*(b))) : -1)
+
+#define CACHE_PUT_STR(b, string_key, val) CACHE_PUT(b, hash_string(string_key), val)
+#define CACHE_GET_STR(b, string_key)      CACHE_GET(b, hash_string(string_key))
+#define CACHE_HAS_STR(b, string_key)      CACHE_HAS(b, hash_string(string_key))
+#define CACHE_DEL_STR(b, string_key)      CACHE_DEL(b, hash_string(string_key))
+#define CACHE_PTR_STR(b, string_key)      CACHE_PTR(b, hash_string(string_key))
+#define CACHE_IDX_STR(b, string_key)      CACHE_IDX(b, hash_string(string_key))
+#define CACHE_PUT_BYTES(b, ptr, len, val) CACHE_PUT(b, hash_bytes(ptr, len), val)
+#define CACHE_GET_BYTES(b, ptr, len)      CACHE_GET(b, hash_bytes(ptr, len))
+#define CACHE_HAS_BYTES(b, ptr, len)      CACHE_HAS(b, hash_bytes(ptr, len))
+#define CACHE_DEL_BYTES(b, ptr, len)      CACHE_DEL(b, hash_bytes(ptr, len))
+#define CACHE_PTR_BYTES(b, ptr, len)      CACHE_PTR(b, hash_bytes(ptr, len))
+#define CACHE_IDX_BYTES(b, ptr, len)      CACHE_IDX(b, hash_bytes(ptr, len))
+
+/* One allocation with the header, the null value, the values, the keys and the reference bits, index maps each key to its slot */
+struct cache__hdr { size_t len, cap, hand, evicted; uint32_t *keys, *index; unsigned char *refs; void *pad; }; /* pad keeps values aligned to two size_t */
+#define CACHE__HDR(b) (((struct cache__hdr *)&(b)[-1])-1)
+#define CACHE__KEYSOFS(cap, elem_size) ((sizeof(struct cache__hdr) + ((cap) + 1) * (elem_size) + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1))
+#define CACHE__FIT0(b) ((b) ? 0 : CACHE_INIT(b, 16))
+#define CACHE__PEEK 0
+#define CACHE__USE 1
+#define CACHE__ADD 2
+#define CACHE__DEL 3
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable:4505) //unreferenced local function has been removed
+#endif
+
+/* Makes an empty cache with room for cap elements (at least 1) and frees hdr, returns NULL on overflow or when out of memory */
+HMAP__UNUSED static void* cache__init(struct cache__hdr* hdr, size_t elem_size, size_t cap)
+{
+	struct cache__hdr* new_hdr;
+	char* vals;
+	if (hdr)
+	{
+		HMAP_FREE(hdr->index);
+		TINYHASHMAP_FREE(NULL, hdr);
+	}
+	if (!cap)
+		cap = 1;
+	if ((HMAP__U64)cap > 0xFFFFFFFF || cap > ((size_t)-1 - sizeof(struct cache__hdr) - 2 * sizeof(uint32_t)) / (elem_size + sizeof(uint32_t) + 1) - 1)
+		return NULL; /* slots are stored as 32-bit or overflow */
+
+	new_hdr = (struct cache__hdr *)TINYHASHMAP_MALLOC(NULL, CACHE__KEYSOFS(cap, elem_size) + cap * (sizeof(uint32_t) + 1));
+	if (!new_hdr)
+		return NULL; /* out of memory */
+	vals = ((char*)(new_hdr + 1)) + elem_size;
+	new_hdr->len = new_hdr->hand = new_hdr->evicted = 0;
+	new_hdr->cap = cap;
+	new_hdr->keys = (uint32_t *)((char*)new_hdr + CACHE__KEYSOFS(cap, elem_size));
+	new_hdr->refs = (unsigned char *)(new_hdr->keys + cap);
+	new_hdr->index = NULL;
+	memset(vals - elem_size, 0, elem_size);
+	if (!HMAP_TRYFIT(new_hdr->index, cap))
+	{
+		TINYHASHMAP_FREE(NULL, new_hdr);
+		return NULL; /* out of memory */
+	}
+	return vals;
+}
+
+/* Returns the slot of key (or -1 if missing), marks it as used, adds it in place of an evicted key or deletes it depending on mode */
+HMAP__UNUSED static ptrdiff_t cache__idx(struct cache__hdr* hdr, uint32_t key, int mode, size_t elem_size)
+{
+	ptrdiff_t i = HMAP_IDX(hdr->index, key);
+	size_t pos, last;
+	char* vals;
+	if (i != -1)
+	{
+		pos = hdr->index[i];
+		if (mode == CACHE__DEL)
+		{
+			/* move the last element into the slot so the slots stay dense */
+			vals = ((char*)(hdr + 1)) + elem_size;
+			(void)HMAP_DEL(hdr->index, key);
+			if (pos != (last = --hdr->len))
+			{
+				hdr->keys[pos] = hdr->keys[last];
+				hdr->refs[pos] = hdr->refs[last];
+				memcpy(vals + pos * elem_size, vals + last * elem_size, elem_size);
+				hdr->index[HMAP_IDX(hdr->index, hdr->keys[pos])] = (uint32_t)pos;
+			}
+			if (hdr->hand >= hdr->len)
+				hdr->hand = 0;
+		}
+		else if (mode != CACHE__PEEK)
+			hdr->refs[pos] = 1;
+		if (mode == CACHE__ADD)
+			hdr->evicted = 0;
+		return (ptrdiff_t)pos;
+	}
+	if (mode != CACHE__ADD || !key)
+		return -1; /* not found (getting or setting goes to the null value) */
+	if (hdr->len != hdr->cap)
+	{
+		pos = hdr->len++;
+		hdr->evicted = 0;
+	}
+	else
+	{
+		/* sweep the hand over the used elements clearing their reference bits, evict the first unused one */
+		while (hdr->refs[hdr->hand])
+		{
+			hdr->refs[hdr->hand] = 0;
+			if (++hdr->hand == hdr->cap)
+				hdr->hand = 0;
+		}
+		pos = hdr->hand;
+		if (++hdr->hand == hdr->cap)
+			hdr->hand = 0;
+		hdr->evicted = hdr->keys[pos];
+		(void)HMAP_DEL(hdr->index, hdr->evicted);
+	}
+	hdr->keys[pos] = key;
+	hdr->refs[pos] = 0;
+	HMAP_SET(hdr->index, key, (uint32_t)pos);
+	return (ptrdiff_t)pos;
+}
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#endif
@@ -0,0 +1,494 @@
+/* TinyCpp - C++ wrappers for TinyBuf and TinyHashMap - public domain - Bernhard Schelling 2020
+   https://github.com/schellingb/c-data-structures
+         no warranty implied; use at your own risk
+
+   This file implements C++11 class templates on top of TinyBuf and
+   TinyHashMap which also work with values that have constructors and
+   destructors (std::string, std::shared_ptr, ...).
+
+   tiny::buf<T> is a dynamic array with the memory layout of TinyBuf, so
+   raw() can be passed to BUF_LEN/BUF_CAP. Types for which
+   tiny::is_relocatable is true (by default all trivially copyable types)
+   grow with realloc like TinyBuf, others get move constructed into the
+   new memory. Specialize tiny::is_relocatable for types which can be
+   moved with memcpy (most std::unique_ptr and std::shared_ptr are).
+
+   tiny::hmap<K, V> is a hash map which keeps its entries dense in a
+   tiny::buf (so iterating goes over the entries only) and a TinyHashMap
+   from key to entry position. Integer and enum keys (0 is allowed) pick
+   the 32-bit or 64-bit map at compile time from sizeof(K) and are mixed
+   with a bijective finalizer so the key itself is stored in the map.
+   std::string keys are hashed with wyhash and compared in full. Lookups
+   take const char*, std::string or std::string_view without making a
+   temporary std::string. Erasing moves the last entry into the hole.
+
+   Running out of memory throws std::bad_alloc.
+
+   Sample usage:
+
+   tiny::buf<std::string> names;
+   names.push_back("foo");
+   names.emplace_back(3, 'x');
+   -- now names.size() == 2, names[1] == "xxx"
+
+   tiny::hmap<int, std::string> map;
+   map[5] = "five";
+   map.try_emplace(0, "zero");
+   std::string* s = map.find(5);
+   bool erased = map.erase(0);
+   for (auto& e : map) use(e.first, e.second);
+   -- now *s == "five", erased == true, map.size() == 1
+
+   tiny::hmap<std::string, int> counts;
+   counts["foo"]++;
+   int* foo = counts.find(std::string_view("foo"));
+   -- now *foo == 1
+
+   PUBLIC DOMAIN (UNLICENSE)
+
+   This is free and unencumbered software released into the public domain.
+
+   Anyone is free to copy, modify, publish, use, compile, sell, or
+   distribute this software, either in source code form or as a compiled
+   binary, for any purpose, commercial or non-commercial, and by any
+   means.
+
+   In jurisdictions that recognize copyright laws, the author or authors
+   of this software dedicate any and all copyright interest in the
+   software to the public domain. We make this dedication for the benefit
+   of the public at large and to the detriment of our heirs and
+   successors. We intend this dedication to be an overt act of
+   relinquishment in perpetuity of all present and future rights to this
+   software under copyright law.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+   OTHER DEALINGS IN THE SOFTWARE.
+
+   For more information, please refer to <http://unlicense.org/>
+*/
+
+#ifndef TINYCPP_H
+#define TINYCPP_H
+
+#include "tinybuf.h"
+#include "tinyhashmap.h"
+#include "tinyhashmap64.h"
+#include <new> /* for placement new, std::bad_alloc */
+#include <string> /* for std::string */
+#include <utility> /* for std::move, std::forward, std::pair */
+#include <type_traits> /* for std::is_trivially_copyable, std::conditional */
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#include <string_view> /* for std::string_view */
+#define TINYCPP__STRINGVIEW
+#endif
+
+namespace tiny {
+
+/* Types that can be moved to other memory with memcpy without calling their move constructor and destructor */
+template <class T> struct is_relocatable : std::integral_constant<bool, std::is_trivially_copyable<T>::value> {};
+
+template <class T> class buf
+{
+public:
+	typedef T* iterator;
+	typedef const T* const_iterator;
+
+	buf() {}
+	buf(const buf& o) : buf() { reserve(o.size()); for (size_t i = 0; i != o.size(); i++) emplace_back(o[i]); }
+	buf(buf&& o) noexcept : b(o.b) { o.b = NULL; }
+	buf& operator=(buf o) noexcept { T* t = b; b = o.b; o.b = t; return *this; }
+	~buf() { clear(); BUF_FREE(b); }
+
+	size_t size() const { return BUF_LEN(b); }
+	size_t capacity() const { return BUF_CAP(b); }
+	bool empty() const { return !BUF_LEN(b); }
+	T* data() { return b; }
+	const T* data() const { return b; }
+	T* raw() { return b; } /* the TinyBuf for BUF_LEN/BUF_CAP, only modify it with BUF_ macros if T is relocatable */
+	T& operator[](size_t i) { return b[i]; }
+	const T& operator[](size_t i) const { return b[i]; }
+	T& back() { return b[BUF_LEN(b) - 1]; }
+	const T& back() const { return b[BUF_LEN(b) - 1]; }
+	iterator begin() { return b; }
+	iterator end() { return b + BUF_LEN(b); }
+	const_iterator begin() const { return b; }
+	const_iterator end() const { return b + BUF_LEN(b); }
+
+	void reserve(size_t n) { if (n > BUF_CAP(b)) grow(n, 1); }
+	void push_back(const T& v) { emplace_back(v); }
+	void push_back(T&& v) { emplace_back(std::move(v)); }
+	void pop_back() { b[--BUF__HDR(b)->len].~T(); }
+	void clear() { while (BUF_LEN(b)) pop_back(); }
+	void resize(size_t n) { if (n > BUF_CAP(b)) grow(n, 0); while (BUF_LEN(b) < n) emplace_back(); while (BUF_LEN(b) > n) pop_back(); }
+
+	template <class... A> T& emplace_back(A&&... a)
+	{
+		if (BUF_LEN(b) == BUF_CAP(b))
+		{
+			/* construct first, the arguments can refer to elements which move when growing */
+			T tmp(std::forward<A>(a)...);
+			grow(BUF_LEN(b) + 1, 0);
+			return *new (b + BUF__HDR(b)->len++) T(std::move(tmp));
+		}
+		new (b + BUF_LEN(b)) T(std::forward<A>(a)...);
+		return b[BUF__HDR(b)->len++];
+	}
+
+	/* Removes element i keeping the order */
+	void erase(size_t i)
+	{
+		size_t len = BUF_LEN(b);
+		if (is_relocatable<T>::value)
+		{
+			b[i].~T();
+			memmove((void*)(b + i), (void*)(b + i + 1), (len - i - 1) * sizeof(T));
+			BUF__HDR(b)->len--;
+			return;
+		}
+		for (; i + 1 < len; i++)
+			b[i] = std::move(b[i + 1]);
+		pop_back();
+	}
+
+private:
+	T* b = NULL;
+
+	void grow(size_t n, int exact)
+	{
+		if (is_relocatable<T>::value)
+		{
+			*(void**)(&b) = buf__grow(b, n, sizeof(T), exact);
+			if (BUF_CAP(b) < n)
+				throw std::bad_alloc();
+			return;
+		}
+		size_t len = BUF_LEN(b), cap = (exact ? n : 2 * BUF_CAP(b)), i;
+		if (cap < n) cap = n;
+		if (cap < 16 && !exact) cap = 16;
+		T* nb = (T*)buf__grow(NULL, cap, sizeof(T), 1);
+		if (BUF_CAP(nb) < cap)
+		{
+			BUF_FREE(nb);
+			throw std::bad_alloc();
+		}
+		for (i = 0; i != len; i++)
+		{
+			try { new (nb + i) T(std::move_if_noexcept(b[i])); }
+			catch (...)
+			{
+				while (i) nb[--i].~T();
+				BUF_FREE(nb);
+				throw;
+			}
+		}
+		BUF__HDR(nb)->len = len;
+		clear();
+		BUF_FREE(b);
+		b = nb;
+	}
+};
+
+namespace detail {
+	/* The TinyHashMap from key to entry position, the 32-bit or 64-bit one */
+	template <bool Wide> struct core;
+	template <> struct core<false>
+	{
+		typedef uint32_t key;
+		static size_t len(size_t* m) { return HMAP_LEN(m); }
+		static bool fit(size_t*& m, size_t n) { return HMAP_TRYFIT(m, n) != 0; }
+		static ptrdiff_t find(size_t* m, key k) { return HMAP_IDX(m, k); }
+		static size_t* ptr(size_t*& m, key k) { return HMAP_PTR(m, k); }
+		static void erase(size_t* m, key k) { (void)HMAP_DEL(m, k); }
+		static void clear(size_t* m) { HMAP_CLEAR(m); }
+		static void release(size_t*& m) { HMAP_FREE(m); }
+	};
+	template <> struct core<true>
+	{
+		typedef uint64_t key;
+		static size_t len(size_t* m) { return HMAP64_LEN(m); }
+		static bool fit(size_t*& m, size_t n) { return HMAP64_TRYFIT(m, n) != 0; }
+		static ptrdiff_t find(size_t* m, key k) { return HMAP64_IDX(m, k); }
+		static size_t* ptr(size_t*& m, key k) { return HMAP64_PTR(m, k); }
+		static void erase(size_t* m, key k) { (void)HMAP64_DEL(m, k); }
+		static void clear(size_t* m) { HMAP64_CLEAR(m); }
+		static void release(size_t*& m) { HMAP64_FREE(m); }
+	};
+
+	template <class K, bool E = std::is_enum<K>::value> struct underlying { typedef typename std::underlying_type<K>::type type; };
+	template <class K> struct underlying<K, false> { typedef K type; };
+
+	/* A key of bytes that refers to the memory of a const char*, std::string or std::string_view */
+	struct bytes
+	{
+		const char* p; size_t n;
+		bytes(const char* s) : p(s), n(strlen(s)) {}
+		bytes(const char* s, size_t len) : p(s), n(len) {}
+		bytes(const std::string& s) : p(s.data()), n(s.size()) {}
+		#ifdef TINYCPP__STRINGVIEW
+		bytes(std::string_view s) : p(s.data()), n(s.size()) {}
+		#endif
+		bool operator==(const std::string& s) const { return s.size() == n && !memcmp(s.data(), p, n); }
+	};
+}
+
+/* The default hashes, for integer keys it needs to be bijective (a key and its hash are interchangeable) */
+template <class K, class Enable = void> struct hash
+{
+	static const bool wide = (sizeof(K) > 4);
+	typedef typename std::conditional<wide, uint64_t, uint32_t>::type result;
+	result operator()(K k) const { return mix((result)(typename std::make_unsigned<typename detail::underlying<K>::type>::type)k); }
+	static uint32_t mix(uint32_t h) { h ^= h >> 16; h *= 0x85ebca6bu; h ^= h >> 13; h *= 0xc2b2ae35u; return h ^ (h >> 16); }
+	static uint64_t mix(uint64_t h) { h ^= h >> 33; h *= 0xff51afd7ed558ccdull; h ^= h >> 33; h *= 0xc4ceb9fe1a85ec53ull; return h ^ (h >> 33); }
+};
+template <> struct hash<std::string>
+{
+	uint64_t operator()(const char* p, size_t n) const { return (uint64_t)hmap__wyhash(p, n); }
+};
+
+template <class K, class V, class Hash = hash<K> > class hmap
+{
+	static_assert(std::is_integral<K>::value || std::is_enum<K>::value, "tiny::hmap keys need to be integers, enums or std::string");
+	typedef typename Hash::result key;
+	typedef detail::core<(sizeof(key) > 4)> core;
+	static const size_t npos = (size_t)-1;
+
+public:
+	/* Don't change first, it is the key of the entry */
+	struct entry
+	{
+		K first; V second;
+		template <class... A> entry(K k, A&&... a) : first(k), second(std::forward<A>(a)...) {}
+	};
+	typedef entry* iterator;
+	typedef const entry* const_iterator;
+
+	hmap() {}
+	hmap(const hmap& o) : hmap() { reserve(o.size()); for (const entry& e : o) try_emplace(e.first, e.second); }
+	hmap(hmap&& o) noexcept : idx(o.idx), ents(std::move(o.ents)), zero(o.zero) { o.idx = NULL; o.zero = npos; }
+	hmap& operator=(hmap o) noexcept { std::swap(idx, o.idx); std::swap(ents, o.ents); std::swap(zero, o.zero); return *this; }
+	~hmap() { core::release(idx); }
+
+	size_t size() const { return ents.size(); }
+	bool empty() const { return ents.empty(); }
+	iterator begin() { return ents.begin(); }
+	iterator end() { return ents.end(); }
+	const_iterator begin() const { return ents.begin(); }
+	const_iterator end() const { return ents.end(); }
+
+	void reserve(size_t n) { ents.reserve(n); if (!core::fit(idx, n)) throw std::bad_alloc(); }
+	void clear() { ents.clear(); core::clear(idx); zero = npos; }
+	V* find(K k) { size_t p = pos(k); return (p == npos ? NULL : &ents[p].second); }
+	const V* find(K k) const { size_t p = pos(k); return (p == npos ? NULL : &ents[p].second); }
+	bool contains(K k) const { return pos(k) != npos; }
+	V& operator[](K k) { return try_emplace(k).first->second; }
+
+	/* Adds an entry constructed from a unless the key exists, returns the entry and if it was added */
+	template <class... A> std::pair<entry*, bool> try_emplace(K k, A&&... a)
+	{
+		key h = Hash()(k);
+		size_t *slot, len;
+		if (!h)
+		{
+			/* the map can't store key 0, its entry position is kept separately */
+			if (zero != npos)
+				return std::pair<entry*, bool>(&ents[zero], false);
+			ents.emplace_back(k, std::forward<A>(a)...);
+			zero = ents.size() - 1;
+			return std::pair<entry*, bool>(&ents.back(), true);
+		}
+		if (!core::fit(idx, (len = core::len(idx)) + 1))
+			throw std::bad_alloc();
+		slot = core::ptr(idx, h);
+		if (core::len(idx) == len)
+			return std::pair<entry*, bool>(&ents[*slot], false);
+		try { ents.emplace_back(k, std::forward<A>(a)...); }
+		catch (...) { core::erase(idx, h); throw; }
+		*slot = ents.size() - 1;
+		return std::pair<entry*, bool>(&ents.back(), true);
+	}
+
+	template <class M> std::pair<entry*, bool> insert_or_assign(K k, M&& v)
+	{
+		std::pair<entry*, bool> r = try_emplace(k, std::forward<M>(v));
+		if (!r.second) r.first->second = std::forward<M>(v);
+		return r;
+	}
+
+	bool erase(K k)
+	{
+		key h = Hash()(k);
+		size_t p, last;
+		if (!h)
+		{
+			if ((p = zero) == npos)
+				return false;
+			zero = npos;
+		}
+		else
+		{
+			ptrdiff_t i = core::find(idx, h);
+			if (i == -1)
+				return false;
+			p = idx[i];
+			core::erase(idx, h);
+		}
+		/* move the last entry into the hole and point its key there */
+		if (p != (last = ents.size() - 1))
+		{
+			ents[p] = std::move(ents[last]);
+			if (!(h = Hash()(ents[p].first)))
+				zero = p;
+			else
+				idx[core::find(idx, h)] = p;
+		}
+		ents.pop_back();
+		return true;
+	}
+
+private:
+	size_t* idx = NULL;
+	buf<entry> ents;
+	size_t zero = npos;
+
+	size_t pos(K k) const
+	{
+		key h = Hash()(k);
+		ptrdiff_t i;
+		if (!h)
+			return zero;
+		return ((i = core::find(idx, h)) == -1 ? npos : idx[i]);
+	}
+};
+
+template <class V, class Hash> class hmap<std::string, V, Hash>
+{
+	typedef detail::core<true> core;
+	typedef detail::bytes bytes;
+	static const size_t npos = (size_t)-1;
+	struct link { uint64_t hash; size_t next; }; /* entries with the same 64-bit hash are chained */
+
+public:
+	/* Don't change first, it is the key of the entry */
+	struct entry
+	{
+		std::string first; V second;
+		template <class... A> entry(const bytes& k, A&&... a) : first(k.p, k.n), second(std::forward<A>(a)...) {}
+	};
+	typedef entry* iterator;
+	typedef const entry* const_iterator;
+
+	hmap() {}
+	hmap(const hmap& o) : hmap() { reserve(o.size()); for (const entry& e : o) try_emplace(e.first, e.second); }
+	hmap(hmap&& o) noexcept : idx(o.idx), ents(std::move(o.ents)), links(std::move(o.links)) { o.idx = NULL; }
+	hmap& operator=(hmap o) noexcept { std::swap(idx, o.idx); std::swap(ents, o.ents); std::swap(links, o.links); return *this; }
+	~hmap() { core::release(idx); }
+
+	size_t size() const { return ents.size(); }
+	bool empty() const { return ents.empty(); }
+	iterator begin() { return ents.begin(); }
+	iterator end() { return ents.end(); }
+	const_iterator begin() const { return ents.begin(); }
+	const_iterator end() const { return ents.end(); }
+
+	void reserve(size_t n) { ents.reserve(n); links.reserve(n); if (!core::fit(idx, n)) throw std::bad_alloc(); }
+	void clear() { ents.clear(); links.clear(); core::clear(idx); }
+	V* find(const bytes& k) { size_t p = pos(k, hashof(k), NULL); return (p == npos ? NULL : &ents[p].second); }
+	const V* find(const bytes& k) const { size_t p = pos(k, hashof(k), NULL); return (p == npos ? NULL : &ents[p].second); }
+	bool contains(const bytes& k) const { return pos(k, hashof(k), NULL) != npos; }
+	V& operator[](const bytes& k) { return try_emplace(k).first->second; }
+
+	/* Adds an entry constructed from a unless the key exists, returns the entry and if it was added */
+	template <class... A> std::pair<entry*, bool> try_emplace(const bytes& k, A&&... a)
+	{
+		uint64_t h = hashof(k);
+		size_t *slot, len, p;
+		int added;
+		if (!core::fit(idx, (len = core::len(idx)) + 1))
+			throw std::bad_alloc();
+		slot = core::ptr(idx, h);
+		if (!(added = (core::len(idx) != len)))
+			for (p = *slot; p != npos; p = links[p].next)
+				if (k == ents[p].first)
+					return std::pair<entry*, bool>(&ents[p], false);
+		/* a new key goes in front of the chain of its hash */
+		link l = { h, (added ? npos : *slot) };
+		try { links.push_back(l); ents.emplace_back(k, std::forward<A>(a)...); }
+		catch (...)
+		{
+			if (links.size() != ents.size()) links.pop_back();
+			if (added) core::erase(idx, h);
+			throw;
+		}
+		*slot = ents.size() - 1;
+		return std::pair<entry*, bool>(&ents.back(), true);
+	}
+
+	template <class M> std::pair<entry*, bool> insert_or_assign(const bytes& k, M&& v)
+	{
+		std::pair<entry*, bool> r = try_emplace(k, std::forward<M>(v));
+		if (!r.second) r.first->second = std::forward<M>(v);
+		return r;
+	}
+
+	bool erase(const bytes& k)
+	{
+		uint64_t h = hashof(k);
+		size_t prev, p = pos(k, h, &prev), last, q;
+		if (p == npos)
+			return false;
+		if (prev != npos)
+			links[prev].next = links[p].next;
+		else if (links[p].next != npos)
+			idx[core::find(idx, h)] = links[p].next;
+		else
+			core::erase(idx, h);
+		/* move the last entry into the hole and point the map or its chain there */
+		if (p != (last = ents.size() - 1))
+		{
+			ents[p] = std::move(ents[last]);
+			links[p] = links[last];
+			q = (size_t)core::find(idx, links[p].hash);
+			if (idx[q] == last)
+				idx[q] = p;
+			else
+			{
+				for (q = idx[q]; links[q].next != last; q = links[q].next) {}
+				links[q].next = p;
+			}
+		}
+		ents.pop_back();
+		links.pop_back();
+		return true;
+	}
+
+private:
+	size_t* idx = NULL;
+	buf<entry> ents;
+	buf<link> links;
+
+	static uint64_t hashof(const bytes& k) { uint64_t h = Hash()(k.p, k.n); return (h ? h : 1); }
+
+	size_t pos(const bytes& k, uint64_t h, size_t* out_prev) const
+	{
+		ptrdiff_t i = core::find(idx, h);
+		size_t p, prev = npos;
+		if (i == -1)
+			return npos;
+		for (p = idx[i]; p != npos; prev = p, p = links[p].next)
+			if (k == ents[p].first)
+			{
+				if (out_prev) *out_prev = prev;
+				return p;
+			}
+		return npos;
+	}
+};
+
+}
+
+#endif
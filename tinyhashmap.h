@@ -8,8 +8,10 @@
 
    It's a super simple type safe hash map for C with no need
    to predeclare any type or anything.
-   Will always allocate memory for twice the amount of max elements
+   By default allocates memory for twice the amount of max elements
    so larger structs should be stored as pointers or indices to an array.
+   Keys and values share one allocation with the keys cache line aligned.
+   Collisions are resolved with linear probing in Robin Hood order.
    Can be used in C++ with POD types (without any constructor/destructor).
 
    Be careful not to supply modifying statements to the macro arguments.
@@ -53,15 +55,70 @@
    HMAP_FIT(map, 30);
    -- now HMAP_LEN(map) == 0, HMAP_CAP(map) == 64
 
+   -- Release memory after removing many keys:
+   HMAP_SHRINK(map);
+   -- now HMAP_CAP(map) is the smallest that fits HMAP_LEN(map) (at least 16)
+
    -- Add elements with custom hash keys:
    HMAP_SET(map, my_uint32_hash(key1), some_element);
    HMAP_SET(map, my_uint32_hash(key2), other_element);
    -- now HMAP_LEN(map) == 2, _GET/_HAS/_DEL/_PTR/_IDX also exist
 
+   -- Add elements with keys of any bytes and length (no NUL scan):
+   HMAP_SET_BYTES(map, url, url_len, some_element);
+   -- now HMAP_GET_BYTES(map, url, url_len) == some_element, _HAS/_DEL/_PTR/_IDX also exist
+   -- hash_bytes uses wyhash which reads 8 bytes at a time, hash_string
+   -- (used by the _STR functions) stays FNV-1a for compatibility
+
+   -- Look up or set many keys at once (faster for large maps):
+   ptrdiff_t idx[256];
+   size_t found = HMAP_GET_BATCH(map, key_array, 256, idx);
+   -- now map[idx[i]] is the value of key_array[i] (or the null value if idx[i] == -1)
+   HMAP_SET_BATCH(map, key_array, 256, value_array);
+   -- The slots of the next keys are prefetched while a key is resolved
+   -- so the cache misses of the keys in a batch overlap
+   -- GET_BATCH finishes a pending incremental grow so the indices stay valid
+
+   -- Set the keys and values of large arrays, growing only once:
+   HMAP_BUILD(map, key_array, value_array, n, 8);
+   -- now HMAP_GET(map, key_array[i]) == value_array[i] (the last one for a
+   -- key that is in the array more than once)
+   -- With TINYHASHMAP_THREADS defined before including this file, up to 8
+   -- threads each fill the slots of separate regions of the table (keys get
+   -- partitioned by their home slot first), otherwise nthreads is ignored
+   -- On POSIX, threads need linking with -lpthread
+
+   -- Add all entries of another map of the same type:
+   HMAP_MERGE(map, other_map);
+   -- now map has all keys of other_map with their values, other_map stays
+   -- If map needs to grow, both maps are read in order of the home slots
+   -- and the new table is filled front to back without probing for slots
+   -- (other_map only if it has the same seed, otherwise its keys get set)
+
    -- Iterate elements (random order, order can change on insert):
    for (size_t i = 0, cap = HMAP_CAP(map); i != cap, i++)
      if (HMAP_KEY(map, i))
    ------ here map[i] is the value of key HMAP_KEY(map, i)
+   ------ and HMAP_HOME(map, HMAP_KEY(map, i)) is the slot its lookup starts at
+
+   -- Keys are mixed with a seed of the map before picking their home slot,
+   -- so sequential or chosen keys don't form long clusters of taken slots
+   -- Every new map gets its own seed (growing keeps it), for the same seed
+   -- in every map and on every run (for example to make HMAP_MERGE of
+   -- unrelated maps fill the new table in order) define a fixed one with
+   #define TINYHASHMAP_SEED(mem) 12345
+   -- before including this file (mem is the memory of the new table)
+
+   -- Set a maximum load factor (default 0.5, allowed 0.0625 to 0.9375):
+   HMAP_SETLOADFACTOR(map, 0.875);
+   -- now HMAP_FIT(map, 100) makes HMAP_CAP(map) == 128 instead of 256
+
+   -- Spread the rehashing when growing over the following operations:
+   HMAP_SETINCREMENTAL(map, 1);
+   -- now growing keeps the old table and every SET/GET/HAS/DEL/PTR/IDX
+   -- moves a few keys over, so no single insert rehashes all keys
+   -- While keys are being moved, any operation can change indices
+   -- Call HMAP_FINISHGROW(map); to move all remaining keys before iterating
 
    -- Set a custom null value (is zeroed by default):
    HMAP_SETNULLVAL(map, map_null);
@@ -76,6 +133,74 @@
    -- before setting an element (with SET, PTR or NULLVAL).
    -- When out of memory, map will stay unmodified.
 
+   -- Use a custom allocator (for example an arena):
+   #define TINYHASHMAP_MALLOC(ctx, size) my_malloc(ctx, size)
+   #define TINYHASHMAP_FREE(ctx, ptr) my_free(ctx, ptr)
+   -- before including this file, then per map:
+   HMAP_SETALLOC(map, my_arena);
+   -- now all memory of map comes from my_arena (ctx is NULL by default)
+   -- If map already has memory, it gets moved over to the new context
+
+   -- Save to a file and map it back without copying or rehashing:
+   #define TINYHASHMAP_MMAP
+   -- before including this file, then:
+   bool saved = HMAP_SAVE(map, fd);
+   HMAP_MMAP(loaded_map, "map.bin");
+   -- now loaded_map != NULL (if the file was valid for the type of
+   -- loaded_map), HMAP_GET/HAS/IDX/LEN/CAP/KEY work on it, any change
+   -- crashes as the memory is read-only. Free it with HMAP_UNMAP(loaded_map);
+   -- With TINYHASHMAP_STATS its lookups count outside of the mapping
+   -- The file stores the keys, header, null value and values with the
+   -- same alignment as in memory, it is only valid on the same platform
+
+   -- Freeze a finished map into a minimal perfect hash table:
+   mytype_t* frozen = NULL;
+   HMAP_FREEZE(frozen, map);
+   -- now HMAPF_GET(frozen, key) == HMAP_GET(map, key) for every key,
+   -- HMAPF_HAS/IDX/LEN/KEY also exist and frozen[i] is the value of
+   -- HMAPF_KEY(frozen, i) for i < HMAPF_LEN(frozen), map stays unchanged
+   -- A lookup reads one displacement and then exactly one slot, the
+   -- table has no empty slots so it takes about half the memory
+   -- It can't be modified, free it with HMAPF_FREE(frozen);
+   -- With TINYHASHMAP_MMAP, HMAPF_SAVE(frozen, fd), HMAPF_MMAP(frozen, path)
+   -- and HMAPF_UNMAP(frozen) work the same as for a map
+
+   -- A set of keys with no value storage:
+   uint32_t* set = NULL;
+   bool added = HSET_ADD(set, key1);
+   bool has_key = HSET_HAS(set, key1), removed = HSET_DEL(set, key2);
+   -- now added == true, has_key == true, removed == false
+   -- HSET_LEN/CAP/KEY/CLEAR/FREE/FIT/TRYFIT/SETLOADFACTOR/SHRINK work like
+   -- for a map, iterate with HSET_KEY(set, i) for i < HSET_CAP(set)
+   HSET_UNION(set, other_set);
+   -- now set also has all keys of other_set
+   HSET_INTERSECT(set, other_set);
+   -- now set only has keys that are also in other_set
+
+   -- Count what lookups, inserts, deletes and growing cost:
+   #define TINYHASHMAP_STATS
+   -- before including this file, then:
+   struct hmap_stats stats;
+   HMAP_STATS(map, &stats);
+   -- now stats has the counters since the map was created (lookups, hits,
+   -- misses, probes, inserts, insert_shifts, deletes, delete_shifts, grows
+   -- and grow_bytes) and, computed by scanning the table, len, cap,
+   -- max_probe, max_cluster and probe_hist (keys per distance from home)
+   -- Reset the counters with HMAP_RESETSTATS(map); HSET_STATS also exists
+   -- Counting only happens with TINYHASHMAP_STATS, otherwise it costs nothing
+
+   -- Answer most lookups of missing keys without touching the table:
+   #define TINYHASHMAP_BLOOM
+   -- before including this file (needs tinybloom.h), then per map:
+   bool made = HMAP_SETBLOOM(map, 12);
+   -- now map keeps a bloom filter with 12 bits per key (for the maxload of
+   -- the table, one 64 byte line per lookup), GET/HAS/DEL/IDX and
+   -- GET_BATCH of keys not in map mostly return before probing the table
+   -- It is made again when the table grows and after maxload / 4 deletes,
+   -- each time reading all keys once. HMAP_SETBLOOM(map, 0); drops it
+   -- Worth it for large maps (much bigger than the CPU caches) where most
+   -- lookups miss, otherwise it only adds to SET and DEL
+
    PUBLIC DOMAIN (UNLICENSE)
 
    This is free and unencumbered software released into the public domain.
@@ -107,7 +232,7 @@
 #ifndef TINYHASHMAP_H
 #define TINYHASHMAP_H
 
-#include <stdlib.h> /* for malloc, realloc */
+#include <stdlib.h> /* for malloc, free */
 #include <string.h> /* for memcpy, memset */
 #include <stddef.h> /* for ptrdiff_t, size_t */
 #if defined(_MSC_VER) && (_MSC_VER < 1600)
@@ -116,22 +241,154 @@ typedef unsigned __int32 uint32_t;
 #include <stdint.h> /* for uint32_t */
 #endif
 
+#ifndef TINYHASHMAP_MALLOC
+#define TINYHASHMAP_MALLOC(ctx, size) malloc(size)
+#define TINYHASHMAP_FREE(ctx, ptr) free(ptr)
+#endif
+
+#ifndef TINYHASHMAP_SEED
+#define TINYHASHMAP_SEED(mem) hmap__seed(mem)
+#endif
+
+#ifndef HMAP__PREFETCH
+#if defined(__GNUC__)
+#define HMAP__PREFETCH(p) __builtin_prefetch(p)
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h> /* for _mm_prefetch */
+#define HMAP__PREFETCH(p) _mm_prefetch((const char*)(p), _MM_HINT_T0)
+#else
+#define HMAP__PREFETCH(p) ((void)0)
+#endif
+#define HMAP__BATCHAHEAD 16 /* number of keys a batch prefetches ahead */
+#endif
+
+#if defined(TINYHASHMAP_THREADS) && !defined(HMAP__THREADS)
+#define HMAP__THREADS
+#define HMAP__MAXTHREADS 64
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h> /* for CreateThread, WaitForSingleObject */
+#define HMAP__THREADPROC DWORD WINAPI
+typedef DWORD (WINAPI *hmap__threadfn)(LPVOID);
+#else
+#include <pthread.h> /* for pthread_create, pthread_join */
+#define HMAP__THREADPROC void*
+typedef void* (*hmap__threadfn)(void*);
+#endif
+#endif
+
+#ifdef TINYHASHMAP_BLOOM
+#include "tinybloom.h"
+#endif
+
+#if defined(TINYHASHMAP_MMAP) && !defined(HMAP__MMAP)
+#define HMAP__MMAP
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h> /* for CreateFileMapping, MapViewOfFile */
+#include <io.h> /* for _write */
+#else
+#include <sys/mman.h> /* for mmap, mprotect, munmap */
+#include <sys/stat.h> /* for fstat */
+#include <fcntl.h> /* for open */
+#include <unistd.h> /* for write, close */
+#endif
+#endif
+
 #define HMAP_LEN(b) ((b) ? HMAP__HDR(b)->len : 0)
 #define HMAP_MAX(b) ((b) ? HMAP__HDR(b)->maxlen : 0)
 #define HMAP_CAP(b) ((b) ? HMAP__HDR(b)->maxlen + 1 : 0)
 #define HMAP_KEY(b, idx) (HMAP__HDR(b)->keys[idx])
+#define HMAP_HOME(b, key) ((b) ? (size_t)HMAP__HOME(HMAP__HDR(b), (key)) : 0)
 #define HMAP_SETNULLVAL(b, val) (HMAP__FIT1(b), b[-1] = (val))
-#define HMAP_CLEAR(b) ((b) ? (memset(HMAP__HDR(b)->keys, 0, HMAP_CAP(b) * sizeof(uint32_t)), HMAP__HDR(b)->len = 0) : 0)
-#define HMAP_FREE(b) ((b) ? (free(HMAP__HDR(b)->keys), free(HMAP__HDR(b)), (b) = NULL) : 0)
-#define HMAP_FIT(b, n) ((!(n) || ((b) && (size_t)(n) * 2 <= HMAP_MAX(b))) ? 0 : HMAP__GROW(b, n))
-#define HMAP_TRYFIT(b, n) (HMAP_FIT((b), (n)), (!(n) || ((b) && (size_t)(n) * 2 <= HMAP_MAX(b))))
-
-#define HMAP_SET(b, key, val) (HMAP__FIT1(b), b[hmap__idx(HMAP__HDR(b), (key), 1, 0)] = (val))
-#define HMAP_GET(b, key) (HMAP__FIT1(b), b[hmap__idx(HMAP__HDR(b), (key), 0, 0)])
-#define HMAP_HAS(b, key) ((b) ? hmap__idx(HMAP__HDR(b), (key), 0, 0) != -1 : 0)
-#define HMAP_DEL(b, key) ((b) ? hmap__idx(HMAP__HDR(b), (key), 0, sizeof(*(b))) != -1 : 0)
-#define HMAP_PTR(b, key) (HMAP__FIT1(b), &b[hmap__idx(HMAP__HDR(b), (key), 1, 0)])
-#define HMAP_IDX(b, key) ((b) ? hmap__idx(HMAP__HDR(b), (key), 0, 0) : -1)
+#define HMAP_CLEAR(b) ((b) ? (HMAP__FREEOLD(b), HMAP__CLEARBLOOM(HMAP__HDR(b)), memset(HMAP__HDR(b)->keys, 0, HMAP_CAP(b) * sizeof(uint32_t)), HMAP__HDR(b)->len = 0) : 0)
+#define HMAP_FREE(b) ((b) ? (HMAP__FREEHDR(HMAP__HDR(b)), (b) = NULL) : 0)
+#define HMAP_FIT(b, n) ((!(n) || ((b) && (size_t)(n) <= HMAP__HDR(b)->maxload)) ? 0 : HMAP__GROW(b, n))
+#define HMAP_TRYFIT(b, n) (HMAP_FIT((b), (n)), (!(n) || ((b) && (size_t)(n) <= HMAP__HDR(b)->maxload)))
+#define HMAP_SETLOADFACTOR(b, lf) (HMAP__FIT1(b), hmap__setloadfactor(HMAP__HDR(b), (lf)))
+#define HMAP_SETINCREMENTAL(b, on) (HMAP__FIT1(b), HMAP__HDR(b)->incremental = ((on) ? 1 : 0))
+#define HMAP_SETALLOC(b, ctx) ((b) && HMAP__HDR(b)->allocctx == (ctx) ? 0 : (*(void**)(&(b)) = hmap__grow(HMAP__HDR(b), (void*)(b), sizeof(*(b)), 0, (ctx), 0)))
+#define HMAP_FINISHGROW(b) ((b) && HMAP__HDR(b)->old ? (hmap__finishgrow(HMAP__HDR(b), sizeof(*(b))), 0) : 0)
+#define HMAP_SHRINK(b) ((b) ? (*(void**)(&(b)) = hmap__grow(HMAP__HDR(b), (void*)(b), sizeof(*(b)), 0, HMAP__HDR(b)->allocctx, 1)) : 0)
+#ifdef TINYHASHMAP_MMAP
+#define HMAP_SAVE(b, fd) (HMAP__FIT1(b), HMAP_FINISHGROW(b), hmap__save(HMAP__HDR(b), sizeof(*(b)), (fd)))
+#define HMAP_MMAP(b, path) (*(void**)(&(b)) = hmap__mmap((path), sizeof(*(b)), hmap__mapped))
+#define HMAP_UNMAP(b) ((b) ? (HMAP__FREECOUNTER(HMAP__HDR(b)), hmap__unmapfile(HMAP__HDR(b)->mem, HMAP__FILESIZE(HMAP__HDR(b)->maxlen, sizeof(*(b)))), (b) = NULL) : 0)
+#endif
+
+#define HMAP_SET(b, key, val) (HMAP__FIT1(b), b[hmap__idx(HMAP__HDR(b), (key), 1, 0, sizeof(*(b)))] = (val))
+#define HMAP_GET(b, key) (HMAP__FIT1(b), b[hmap__idx(HMAP__HDR(b), (key), 0, 0, sizeof(*(b)))])
+#define HMAP_HAS(b, key) ((b) ? hmap__idx(HMAP__HDR(b), (key), 0, 0, sizeof(*(b))) != -1 : 0)
+#define HMAP_DEL(b, key) ((b) ? hmap__idx(HMAP__HDR(b), (key), 0, 1, sizeof(*(b))) != -1 : 0)
+#define HMAP_PTR(b, key) (HMAP__FIT1(b), &b[hmap__idx(HMAP__HDR(b), (key), 1, 0, sizeof(*(b)))])
+#define HMAP_IDX(b, key) ((b) ? hmap__idx(HMAP__HDR(b), (key), 0, 0, sizeof(*(b))) : -1)
+#define HMAP_GET_BATCH(b, keys, n, out_idx) ((b) ? hmap__getbatch(HMAP__HDR(b), (keys), (size_t)(n), (out_idx), sizeof(*(b))) : hmap__missbatch((out_idx), (size_t)(n)))
+#define HMAP_SET_BATCH(b, keys, n, vals) (*(void**)(&(b)) = hmap__setbatch(HMAP__HDR(b), (void*)(b), (keys), (size_t)(n), (0 ? (b) : (vals)), sizeof(*(b))))
+#define HMAP_BUILD(b, keys, vals, n, nthreads) (*(void**)(&(b)) = hmap__build(HMAP__HDR(b), (void*)(b), (keys), (0 ? (b) : (vals)), (size_t)(n), sizeof(*(b)), (size_t)(nthreads)))
+#define HMAP_MERGE(b, other) ((other) ? (HMAP_FINISHGROW(other), *(void**)(&(b)) = hmap__merge(HMAP__HDR(b), (void*)(b), HMAP__HDR(0 ? (b) : (other)), sizeof(*(b)))) : 0)
+
+#define HMAP_FREEZE(f, b) (HMAP_FINISHGROW(b), *(void**)(&(f)) = hmapf__freeze(HMAP__HDR(b), (void*)(b), sizeof(*(b))))
+#define HMAPF_LEN(f) ((f) ? HMAPF__HDR(f)->len : 0)
+#define HMAPF_KEY(f, idx) (HMAPF__HDR(f)->keys[idx])
+#define HMAPF_GET(f, key) (f)[hmapf__idx(HMAPF__HDR(f), (key))]
+#define HMAPF_HAS(f, key) ((f) ? hmapf__idx(HMAPF__HDR(f), (key)) != -1 : 0)
+#define HMAPF_IDX(f, key) ((f) ? hmapf__idx(HMAPF__HDR(f), (key)) : -1)
+#define HMAPF_FREE(f) ((f) ? (TINYHASHMAP_FREE(HMAPF__HDR(f)->allocctx, HMAPF__HDR(f)->mem), (f) = NULL) : 0)
+#ifdef TINYHASHMAP_MMAP
+#define HMAPF_SAVE(f, fd) ((f) ? hmapf__save(HMAPF__HDR(f), sizeof(*(f)), (fd)) : 0)
+#define HMAPF_MMAP(f, path) (*(void**)(&(f)) = hmap__mmap((path), sizeof(*(f)), hmapf__mapped))
+#define HMAPF_UNMAP(f) ((f) ? (hmap__unmapfile(HMAPF__HDR(f)->mem, HMAPF__FILESIZE(HMAPF__HDR(f)->slots, HMAPF__HDR(f)->buckets, sizeof(*(f)))), (f) = NULL) : 0)
+#endif
+
+#define HSET_LEN(s) ((s) ? HSET__HDR(s)->len : 0)
+#define HSET_CAP(s) ((s) ? HSET__HDR(s)->maxlen + 1 : 0)
+#define HSET_KEY(s, idx) (HSET__HDR(s)->keys[idx])
+#define HSET_ADD(s, key) (HSET__FIT1(s), hset__add(HSET__HDR(s), (key)))
+#define HSET_HAS(s, key) ((s) ? hmap__idx(HSET__HDR(s), (key), 0, 0, 0) != -1 : 0)
+#define HSET_DEL(s, key) ((s) ? hmap__idx(HSET__HDR(s), (key), 0, 1, 0) != -1 : 0)
+#define HSET_CLEAR(s) ((s) ? (memset(HSET__HDR(s)->keys, 0, HSET_CAP(s) * sizeof(uint32_t)), HSET__HDR(s)->len = 0) : 0)
+#define HSET_FREE(s) ((s) ? (TINYHASHMAP_FREE(HSET__HDR(s)->allocctx, HSET__HDR(s)->mem), (s) = NULL) : 0)
+#define HSET_FIT(s, n) ((!(n) || ((s) && (size_t)(n) <= HSET__HDR(s)->maxload)) ? 0 : HSET__GROW(s, n))
+#define HSET_TRYFIT(s, n) (HSET_FIT((s), (n)), (!(n) || ((s) && (size_t)(n) <= HSET__HDR(s)->maxload)))
+#define HSET_SETLOADFACTOR(s, lf) (HSET__FIT1(s), hmap__setloadfactor(HSET__HDR(s), (lf)))
+#define HSET_SHRINK(s) ((s) ? (*(void**)(&(s)) = hmap__grow(HSET__HDR(s), (void*)(s), 0, 0, HSET__HDR(s)->allocctx, 1)) : 0)
+#define HSET_UNION(s, other) ((other) ? (*(void**)(&(s)) = hset__union(HSET__HDR(s), (void*)(s), HSET__HDR(other))) : 0)
+#define HSET_INTERSECT(s, other) ((s) ? (hset__intersect(HSET__HDR(s), ((other) ? HSET__HDR(other) : NULL)), 0) : 0)
+
+#ifdef TINYHASHMAP_STATS
+#define HMAP_STATS(b, out) hmap__stats(((b) ? HMAP__HDR(b) : NULL), (out))
+#define HMAP_RESETSTATS(b) ((b) ? (memset(HMAP__HDR(b)->counter, 0, sizeof(*HMAP__HDR(b)->counter)), 0) : 0)
+#define HSET_STATS(s, out) hmap__stats(((s) ? HSET__HDR(s) : NULL), (out))
+#define HMAP__COUNT(hdr, field, n) ((hdr)->counter->field += (n))
+#define HMAP__FREECOUNTER(hdr) TINYHASHMAP_FREE(NULL, (hdr)->counter) /* of a mapped file */
+#ifndef HMAP__STATSDEF
+#define HMAP__STATSDEF
+struct hmap_stats
+{
+	size_t lookups, hits, misses, probes; /* probes is the number of slots looked at by all lookups */
+	size_t inserts, insert_shifts, deletes, delete_shifts; /* shifts count keys moved by one slot to insert or delete */
+	size_t grows, grow_bytes; /* new tables made (also by shrinking) and the bytes of keys and values moved into them */
+	size_t len, cap, max_probe, max_cluster; /* computed from the table, max_cluster is the longest run of taken slots */
+	size_t probe_hist[32]; /* number of keys at each distance from their home slot, the last entry also counts all keys further away */
+};
+#endif
+#else
+#define HMAP__COUNT(hdr, field, n) ((void)0)
+#define HMAP__FREECOUNTER(hdr) ((void)0)
+#endif
+
+#ifdef TINYHASHMAP_BLOOM
+#define HMAP_SETBLOOM(b, bits_per_key) (HMAP__FIT1(b), hmap__setbloom(HMAP__HDR(b), (size_t)(bits_per_key)))
+#define HMAP__FREEBLOOM(hdr) ((hdr)->bloom ? (TINYHASHMAP_FREE(BLOOM__HDR((hdr)->bloom)->allocctx, BLOOM__HDR((hdr)->bloom)->mem), (hdr)->bloom = NULL) : 0)
+#define HMAP__CLEARBLOOM(hdr) ((hdr)->bloom ? (BLOOM_CLEAR((hdr)->bloom), (hdr)->bloomstale = 0) : 0)
+#else
+#define HMAP__FREEBLOOM(hdr) ((void)0)
+#define HMAP__CLEARBLOOM(hdr) ((void)0)
+#endif
 
 #ifdef __GNUC__
 #define HMAP__UNUSED __attribute__((__unused__))
@@ -150,6 +407,12 @@ typedef unsigned __int32 uint32_t;
 #define HMAP_DEL_STR(b, string_key)      HMAP_DEL(b, hash_string(string_key))
 #define HMAP_PTR_STR(b, string_key)      HMAP_PTR(b, hash_string(string_key))
 #define HMAP_IDX_STR(b, string_key)      HMAP_IDX(b, hash_string(string_key))
+#define HMAP_SET_BYTES(b, ptr, len, val) HMAP_SET(b, hash_bytes(ptr, len), val)
+#define HMAP_GET_BYTES(b, ptr, len)      HMAP_GET(b, hash_bytes(ptr, len))
+#define HMAP_HAS_BYTES(b, ptr, len)      HMAP_HAS(b, hash_bytes(ptr, len))
+#define HMAP_DEL_BYTES(b, ptr, len)      HMAP_DEL(b, hash_bytes(ptr, len))
+#define HMAP_PTR_BYTES(b, ptr, len)      HMAP_PTR(b, hash_bytes(ptr, len))
+#define HMAP_IDX_BYTES(b, ptr, len)      HMAP_IDX(b, hash_bytes(ptr, len))
 
 HMAP__UNUSED static uint32_t hash_string(const char* str)
 {
@@ -160,96 +423,1354 @@ HMAP__UNUSED static uint32_t hash_string(const char* str)
 	return (hash ? hash : 1);
 }
 
-struct hmap__hdr { size_t len, maxlen; uint32_t *keys; };
+#ifndef HMAP__WYHASH
+#define HMAP__WYHASH
+#if defined(_MSC_VER) && (_MSC_VER < 1600)
+#define HMAP__U64 unsigned __int64
+#else
+#define HMAP__U64 uint64_t
+#endif
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h> /* for _umul128 */
+#endif
+
+/* 64x64 to 128-bit multiply, a gets the low and b the high half */
+HMAP__UNUSED static void hmap__mum(HMAP__U64* a, HMAP__U64* b)
+{
+	#if defined(__SIZEOF_INT128__)
+	__uint128_t r = (__uint128_t)*a * *b;
+	*a = (HMAP__U64)r;
+	*b = (HMAP__U64)(r >> 64);
+	#elif defined(_MSC_VER) && defined(_M_X64)
+	*a = _umul128(*a, *b, b);
+	#else
+	HMAP__U64 ha = *a >> 32, hb = *b >> 32, la = *a & 0xFFFFFFFF, lb = *b & 0xFFFFFFFF;
+	HMAP__U64 rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32), c = (t < rl);
+	HMAP__U64 lo = t + (rm1 << 32);
+	c += (lo < t);
+	*a = lo;
+	*b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+	#endif
+}
+
+HMAP__UNUSED static HMAP__U64 hmap__wymix(HMAP__U64 a, HMAP__U64 b) { hmap__mum(&a, &b); return a ^ b; }
+HMAP__UNUSED static HMAP__U64 hmap__wyr8(const unsigned char* p) { HMAP__U64 v; memcpy(&v, p, 8); return v; }
+HMAP__UNUSED static HMAP__U64 hmap__wyr4(const unsigned char* p) { unsigned int v; memcpy(&v, p, 4); return v; }
+
+/* wyhash (public domain, by Wang Yi) reads 16 or 48 bytes per round and mixes them with 128-bit multiplies */
+HMAP__UNUSED static HMAP__U64 hmap__wyhash(const void* key, size_t len)
+{
+	const HMAP__U64 s0 = (HMAP__U64)0xa0761d6478bd642f, s1 = (HMAP__U64)0xe7037ed1a0b428db, s2 = (HMAP__U64)0x8ebc6af09c88c6e3, s3 = (HMAP__U64)0x589965cc75374cc3;
+	const unsigned char* p = (const unsigned char*)key;
+	HMAP__U64 seed = hmap__wymix(s0, s1), a, b;
+	if (len <= 16)
+	{
+		if (len >= 4)
+		{
+			a = (hmap__wyr4(p) << 32) | hmap__wyr4(p + ((len >> 3) << 2));
+			b = (hmap__wyr4(p + len - 4) << 32) | hmap__wyr4(p + len - 4 - ((len >> 3) << 2));
+		}
+		else if (len)
+		{
+			a = ((HMAP__U64)p[0] << 16) | ((HMAP__U64)p[len >> 1] << 8) | p[len - 1];
+			b = 0;
+		}
+		else
+			a = b = 0;
+	}
+	else
+	{
+		size_t i = len;
+		if (i > 48)
+		{
+			HMAP__U64 see1 = seed, see2 = seed;
+			do
+			{
+				seed = hmap__wymix(hmap__wyr8(p) ^ s1, hmap__wyr8(p + 8) ^ seed);
+				see1 = hmap__wymix(hmap__wyr8(p + 16) ^ s2, hmap__wyr8(p + 24) ^ see1);
+				see2 = hmap__wymix(hmap__wyr8(p + 32) ^ s3, hmap__wyr8(p + 40) ^ see2);
+				p += 48;
+				i -= 48;
+			} while (i > 48);
+			seed ^= see1 ^ see2;
+		}
+		for (; i > 16; i -= 16, p += 16)
+			seed = hmap__wymix(hmap__wyr8(p) ^ s1, hmap__wyr8(p + 8) ^ seed);
+		a = hmap__wyr8(p + i - 16);
+		b = hmap__wyr8(p + i - 8);
+	}
+	a ^= s1;
+	b ^= seed;
+	hmap__mum(&a, &b);
+	return hmap__wymix(a ^ s0 ^ (HMAP__U64)len, b ^ s1);
+}
+#endif
+
+/* Separate from the wyhash functions which tinyhashmaps.h can define first */
+#ifndef HMAP__SEEDFN
+#define HMAP__SEEDFN
+#if defined(_MSC_VER)
+#include <intrin.h> /* for _InterlockedIncrement */
+#endif
+
+/* Makes the seed of a new table from the address of its memory, a stack address (both differ between runs with ASLR) and a counter */
+/* the counter keeps tables apart which get the memory of a freed one, it is atomic so tables can be made in threads */
+HMAP__UNUSED static HMAP__U64 hmap__seed(const void* mem)
+{
+	static volatile long counter;
+	#if defined(__GNUC__)
+	long n = __sync_add_and_fetch(&counter, 1);
+	#elif defined(_MSC_VER)
+	long n = _InterlockedIncrement(&counter);
+	#else
+	long n = ++counter;
+	#endif
+	return hmap__wymix((HMAP__U64)(size_t)mem ^ (HMAP__U64)0x589965cc75374cc3, ((HMAP__U64)(size_t)&mem ^ (HMAP__U64)0x1d8e4e27c47d124f) + (HMAP__U64)n * (HMAP__U64)0x9e3779b97f4a7c15);
+}
+#endif
+
+HMAP__UNUSED static uint32_t hash_bytes(const void* ptr, size_t len)
+{
+	HMAP__U64 h = hmap__wyhash(ptr, len);
+	uint32_t hash = (uint32_t)(h ^ (h >> 32));
+	return (hash ? hash : 1);
+}
+
+#ifdef TINYHASHMAP_STATS
+struct hmap__counts { size_t lookups, hits, misses, probes, inserts, insert_shifts, deletes, delete_shifts, grows, grow_bytes; };
+#endif
+struct hmap__hdr
+{
+	size_t len, maxlen, maxload, loadfactor; uint32_t *keys; struct hmap__hdr *old; size_t incremental, cursor; HMAP__U64 seed; void *allocctx, *mem;
+	#ifdef TINYHASHMAP_STATS
+	struct hmap__counts counts, *counter; /* lookups count into counts, or outside of a mapped file as that is read-only */
+	#endif
+	#ifdef TINYHASHMAP_BLOOM
+	HMAP__U64 *bloom; size_t bloomstale; /* bloom filter of the keys and the number of deletes since it was made */
+	#endif
+};
 #define HMAP__HDR(b) (((struct hmap__hdr *)&(b)[-1])-1)
-#define HMAP__GROW(b, n) (*(void**)(&(b)) = hmap__grow(HMAP__HDR(b), (void*)(b), sizeof(*(b)), (size_t)(n)))
-#define HMAP__FIT1(b) ((b) && HMAP_LEN(b) * 2 <= HMAP_MAX(b) ? 0 : HMAP__GROW(b, 0))
+#define HMAP__ALIGN 64 /* cache line alignment of the keys */
+#define HMAP__GROW(b, n) (*(void**)(&(b)) = hmap__grow(HMAP__HDR(b), (void*)(b), sizeof(*(b)), (size_t)(n), ((b) ? HMAP__HDR(b)->allocctx : NULL), 0))
+#define HMAP__FIT1(b) ((b) && HMAP_LEN(b) <= HMAP__HDR(b)->maxload ? 0 : HMAP__GROW(b, 0))
+#define HMAP__FREEOLD(b) (HMAP__HDR(b)->old ? (TINYHASHMAP_FREE(HMAP__HDR(b)->allocctx, HMAP__HDR(b)->old->mem), HMAP__HDR(b)->old = NULL) : 0)
+#define HMAP__FREEHDR(hdr) ((hdr)->old ? (TINYHASHMAP_FREE((hdr)->allocctx, (hdr)->old->mem), (hdr)->old = NULL) : 0, HMAP__FREEBLOOM(hdr), TINYHASHMAP_FREE((hdr)->allocctx, (hdr)->mem)) /* frees all memory of a table */
+#define HSET__HDR(s) (((struct hmap__hdr *)(void*)(s))-1) /* a set is a map with no values, s points right after the header */
+#define HSET__GROW(s, n) (*(void**)(&(s)) = hmap__grow(HSET__HDR(s), (void*)(s), 0, (size_t)(n), ((s) ? HSET__HDR(s)->allocctx : NULL), 0))
+#define HSET__FIT1(s) ((s) && HSET_LEN(s) <= HSET__HDR(s)->maxload ? 0 : HSET__GROW(s, 0))
+#define HMAP__MAXLOAD(maxlen, lf) ((((maxlen) >> 8) * (lf)) + ((((maxlen) & 0xFF) * (lf)) >> 8)) /* lf in 1/256 steps */
+#define HMAP__HOME(hdr, key) ((uint32_t)(hmap__hash((hdr)->seed, (key)) & (hdr)->maxlen))
+
+/* Mixes a key with the seed of a table so all bits of both affect the low bits which pick the home slot,
+   two rounds as the low half of one product only depends on the low bits of its factors */
+HMAP__UNUSED static uint32_t hmap__hash(HMAP__U64 seed, uint32_t key)
+{
+	HMAP__U64 x = (HMAP__U64)key ^ seed;
+	x = hmap__wymix(x ^ (HMAP__U64)0xa0761d6478bd642f, x ^ (HMAP__U64)0xe7037ed1a0b428db);
+	return (uint32_t)hmap__wymix(x ^ (HMAP__U64)0x8ebc6af09c88c6e3, x ^ (HMAP__U64)0x589965cc75374cc3);
+}
+
+HMAP__UNUSED static ptrdiff_t hmap__probe(struct hmap__hdr* hdr, uint32_t key, int add, int del, size_t elem_size);
+HMAP__UNUSED static void hmap__finishgrow(struct hmap__hdr* hdr, size_t elem_size);
+
+HMAP__UNUSED static void hmap__setloadfactor(struct hmap__hdr* hdr, double lf)
+{
+	hdr->loadfactor = (lf < 0.0625 ? 16 : (lf > 0.9375 ? 240 : (size_t)(lf * 256 + 0.5)));
+	hdr->maxload = HMAP__MAXLOAD(hdr->maxlen, hdr->loadfactor);
+}
+
+/* Makes an empty table with maxlen + 1 slots, returns NULL on overflow or when out of memory */
+HMAP__UNUSED static struct hmap__hdr* hmap__alloc(size_t maxlen, size_t lf, void* ctx, size_t elem_size)
+{
+	struct hmap__hdr *hdr;
+	char *mem;
+	if (maxlen > ((size_t)-1 - HMAP__ALIGN - sizeof(struct hmap__hdr)) / (sizeof(uint32_t) + elem_size) - 2)
+		return NULL; /* overflow */
+
+	/* one allocation with the aligned keys array followed by the header, the null value and the values */
+	mem = (char *)TINYHASHMAP_MALLOC(ctx, HMAP__ALIGN - 1 + (maxlen + 1) * sizeof(uint32_t) + sizeof(struct hmap__hdr) + (maxlen + 2) * elem_size);
+	if (!mem)
+		return NULL; /* out of memory */
+	hdr = (struct hmap__hdr *)(mem + ((HMAP__ALIGN - (size_t)mem) & (HMAP__ALIGN - 1)) + (maxlen + 1) * sizeof(uint32_t));
+
+	hdr->len = 0;
+	hdr->maxlen = maxlen;
+	hdr->maxload = HMAP__MAXLOAD(maxlen, lf);
+	hdr->loadfactor = lf;
+	hdr->keys = (uint32_t *)hdr - (maxlen + 1);
+	memset(hdr->keys, 0, (maxlen + 1) * sizeof(uint32_t));
+	hdr->mem = mem;
+	hdr->old = NULL;
+	hdr->allocctx = ctx;
+	hdr->incremental = 0;
+	hdr->seed = (HMAP__U64)(TINYHASHMAP_SEED(mem));
+	#ifdef TINYHASHMAP_STATS
+	memset(&hdr->counts, 0, sizeof(hdr->counts));
+	hdr->counter = &hdr->counts;
+	#endif
+	#ifdef TINYHASHMAP_BLOOM
+	hdr->bloom = NULL;
+	hdr->bloomstale = 0;
+	#endif
+	return hdr;
+}
+
+#ifdef TINYHASHMAP_BLOOM
+/* Makes a new bloom filter for the maxload of hdr with the keys of from (and its old table), keeps the current filter when out of memory */
+HMAP__UNUSED static int hmap__bloomrebuild(struct hmap__hdr* hdr, const struct hmap__hdr* from, size_t bits)
+{
+	const struct hmap__hdr* t;
+	HMAP__U64* f;
+	size_t blocks, i;
+	void* mem;
+	if (!bits)
+		bits = BLOOM__HDR(hdr->bloom)->bits;
+	if (!(blocks = bloom__blocks(hdr->maxload + 1, bits)) || !(mem = TINYHASHMAP_MALLOC(hdr->allocctx, BLOOM__MEMSIZE(blocks))))
+		return 0; /* overflow or out of memory, the current filter still has all keys */
+	f = bloom__place(mem, hdr->allocctx, blocks, hdr->maxload + 1, bits);
+	for (t = from; t; t = (t == from ? from->old : NULL))
+		for (i = 0; i <= t->maxlen; i++)
+			if (t->keys[i])
+				bloom__add(f, t->keys[i]);
+	BLOOM__HDR(f)->len = from->len;
+	HMAP__FREEBLOOM(hdr);
+	hdr->bloom = f;
+	hdr->bloomstale = 0;
+	return 1;
+}
 
-HMAP__UNUSED static void* hmap__grow(struct hmap__hdr *old_hdr, void* old_ptr, size_t elem_size, size_t reserve)
+HMAP__UNUSED static int hmap__setbloom(struct hmap__hdr* hdr, size_t bits)
+{
+	if (bits)
+		return hmap__bloomrebuild(hdr, hdr, bits);
+	HMAP__FREEBLOOM(hdr);
+	return 1;
+}
+#endif
+
+/* Makes a new table which fits reserve and all existing keys, with shrink set it is the smallest such table (if smaller than now) */
+HMAP__UNUSED static void* hmap__grow(struct hmap__hdr *old_hdr, void* old_ptr, size_t elem_size, size_t reserve, void* ctx, int shrink)
 {
 	struct hmap__hdr *new_hdr;
 	char *new_vals;
-	size_t new_max = (old_ptr ? old_hdr->maxlen * 2 + 1 : 15);
-	while (new_max && new_max / 2 <= reserve)
+	int move = (old_ptr && old_hdr->allocctx != ctx); /* moving to another allocator keeps the size */
+	size_t new_max = (old_ptr && !shrink ? (move ? old_hdr->maxlen : old_hdr->maxlen * 2 + 1) : 15), lf = (old_ptr ? old_hdr->loadfactor : 128);
+	if (old_ptr && reserve < old_hdr->len) reserve = old_hdr->len;
+	while (new_max && HMAP__MAXLOAD(new_max, lf) <= reserve)
 		if (!(new_max = new_max * 2 + 1))
 			return old_ptr; /* overflow */
-
-	new_hdr = (struct hmap__hdr *)malloc(sizeof(struct hmap__hdr) + (new_max + 2) * elem_size);
-	if (!new_hdr)
-		return old_ptr; /* out of memory */
-
-	new_hdr->maxlen = new_max;
-	new_hdr->keys = (uint32_t *)calloc(new_max + 1, sizeof(uint32_t));
-	if (!new_hdr->keys)
-		return (free(new_hdr), old_ptr); /* out of memory */
+	if (shrink && new_max >= old_hdr->maxlen)
+	{
+		if (old_hdr->old)
+			hmap__finishgrow(old_hdr, elem_size); /* still frees the old table */
+		return old_ptr; /* already the smallest size */
+	}
+	if (!(new_hdr = hmap__alloc(new_max, lf, ctx, elem_size)))
+		return old_ptr; /* overflow or out of memory */
+	new_hdr->incremental = (old_ptr ? old_hdr->incremental : 0);
+	if (old_ptr)
+		new_hdr->seed = old_hdr->seed; /* home slots stay the same so nothing depends on when a table grew */
 
 	new_vals = ((char*)(new_hdr + 1)) + elem_size;
 	if (old_ptr)
 	{
 		size_t i;
 		char* old_vals = ((char*)(old_hdr + 1)) + elem_size;
+		memcpy(new_vals - elem_size, old_vals - elem_size, elem_size);
+		if (old_hdr->old)
+			hmap__finishgrow(old_hdr, elem_size);
+		#ifdef TINYHASHMAP_BLOOM
+		if (old_hdr->bloom)
+		{
+			/* the filter moves to the new table and gets made again for its size */
+			new_hdr->bloom = old_hdr->bloom;
+			old_hdr->bloom = NULL;
+			hmap__bloomrebuild(new_hdr, old_hdr, 0);
+		}
+		#endif
+		if (old_hdr->incremental && old_hdr->len && !move && !shrink)
+		{
+			/* keep the old table, its keys get moved over by hmap__migrate starting below an empty slot */
+			for (i = old_hdr->maxlen; old_hdr->keys[i]; i--) {}
+			new_hdr->len = old_hdr->len;
+			new_hdr->old = old_hdr;
+			new_hdr->cursor = (i - 1) & old_hdr->maxlen;
+			#ifdef TINYHASHMAP_STATS
+			new_hdr->counts = old_hdr->counts;
+			new_hdr->counts.grows++; /* moved keys are counted by hmap__migrate */
+			#endif
+			return new_vals;
+		}
 		for (i = 0; i <= old_hdr->maxlen; i++)
 		{
-			uint32_t key, j;
+			ptrdiff_t j;
 			if (!old_hdr->keys[i])
 				continue;
-			for (key = old_hdr->keys[i], j = key;; j++)
+			j = hmap__probe(new_hdr, old_hdr->keys[i], 1, 0, elem_size);
+			memcpy(new_vals + j * elem_size, old_vals + i * elem_size, elem_size);
+		}
+		#ifdef TINYHASHMAP_STATS
+		/* this also drops what the rehashing above counted */
+		new_hdr->counts = old_hdr->counts;
+		new_hdr->counts.grows++;
+		new_hdr->counts.grow_bytes += old_hdr->len * (sizeof(uint32_t) + elem_size);
+		#endif
+		TINYHASHMAP_FREE(old_hdr->allocctx, old_hdr->mem);
+	}
+	else
+		memset(new_vals - elem_size, 0, elem_size);
+	return new_vals;
+}
+
+HMAP__UNUSED static ptrdiff_t hmap__probe(struct hmap__hdr* hdr, uint32_t key, int add, int del, size_t elem_size)
+{
+	uint32_t i, k, home, *keys = hdr->keys;
+
+	if (!key)
+		return (ptrdiff_t)-1;
+
+	i = home = HMAP__HOME(hdr, key);
+	for (;; i++)
+	{
+		if ((k = keys[i &= hdr->maxlen]) == key)
+		{
+			if (del)
 			{
-				if (!new_hdr->keys[j &= new_hdr->maxlen])
+				/* move the following keys which are not in their home slot one slot back */
+				char* vals = ((char*)(hdr + 1)) + elem_size;
+				uint32_t s = i, n;
+				HMAP__COUNT(hdr, deletes, 1);
+				while ((k = keys[n = (s + 1) & hdr->maxlen]) != 0 && n != HMAP__HOME(hdr, k))
 				{
-					new_hdr->keys[j] = key;
-					memcpy(new_vals + j * elem_size, old_vals + i * elem_size, elem_size);
-					break;
+					HMAP__COUNT(hdr, delete_shifts, 1);
+					keys[s] = k;
+					memcpy(vals + s * elem_size, vals + n * elem_size, elem_size);
+					s = n;
 				}
+				keys[s] = 0;
+				hdr->len--;
 			}
+			HMAP__COUNT(hdr, lookups, 1);
+			HMAP__COUNT(hdr, hits, 1);
+			HMAP__COUNT(hdr, probes, ((i - home) & hdr->maxlen) + 1); /* the distance from the home slot */
+			return (ptrdiff_t)i;
 		}
-		memcpy(new_vals - elem_size, old_vals - elem_size, elem_size);
-		new_hdr->len = old_hdr->len;
-		free(old_hdr->keys);
-		free(old_hdr);
+		/* keys are ordered by distance from their home slot, stop at an empty slot or a key closer to home */
+		if (!k || ((i - HMAP__HOME(hdr, k)) & hdr->maxlen) < ((i - home) & hdr->maxlen))
+		{
+			HMAP__COUNT(hdr, lookups, 1);
+			HMAP__COUNT(hdr, misses, 1);
+			HMAP__COUNT(hdr, probes, ((i - home) & hdr->maxlen) + 1);
+			if (!add)
+				return (ptrdiff_t)-1;
+			if (k)
+			{
+				/* move all keys up to the next empty slot one slot further to make room */
+				char* vals = ((char*)(hdr + 1)) + elem_size;
+				uint32_t e = i;
+				while (keys[e = (e + 1) & hdr->maxlen]) {}
+				HMAP__COUNT(hdr, insert_shifts, (e - i) & hdr->maxlen);
+				if (e < i)
+				{
+					memmove(keys + 1, keys, e * sizeof(uint32_t));
+					memmove(vals + elem_size, vals, e * elem_size);
+					keys[0] = keys[hdr->maxlen];
+					memcpy(vals, vals + hdr->maxlen * elem_size, elem_size);
+					e = (uint32_t)hdr->maxlen;
+				}
+				memmove(keys + i + 1, keys + i, (e - i) * sizeof(uint32_t));
+				memmove(vals + (i + 1) * elem_size, vals + i * elem_size, (e - i) * elem_size);
+			}
+			HMAP__COUNT(hdr, inserts, 1);
+			hdr->len++;
+			keys[i] = key;
+			return (ptrdiff_t)i;
+		}
+	}
+}
+
+/* Moves key and a few slots from the old table of an incremental grow into the new table */
+HMAP__UNUSED static void hmap__migrate(struct hmap__hdr* hdr, uint32_t key, size_t elem_size)
+{
+	struct hmap__hdr* old = hdr->old;
+	uint32_t *old_keys = old->keys;
+	char *vals = ((char*)(hdr + 1)) + elem_size, *old_vals = ((char*)(old + 1)) + elem_size;
+	ptrdiff_t i, j;
+	size_t n;
+	#ifdef TINYHASHMAP_STATS
+	struct hmap__counts counts = hdr->counts; /* moving keys only counts as grow_bytes */
+	size_t moved = old->len;
+	#endif
+
+	if (key && (i = hmap__probe(old, key, 0, 0, elem_size)) != -1)
+	{
+		j = hmap__probe(hdr, key, 1, 0, elem_size);
+		memcpy(vals + j * elem_size, old_vals + i * elem_size, elem_size);
+		hmap__probe(old, key, 0, 1, elem_size);
+		hdr->len--;
+	}
+
+	/* visit at least 1/loadfactor slots per call so the old table is empty before the new one needs to grow */
+	/* slots are visited downwards from an empty slot, so each moved key is the last of its cluster and nothing needs to shift */
+	for (n = 256 / hdr->loadfactor + 1; n-- && old->len; hdr->cursor = (hdr->cursor - 1) & old->maxlen)
+	{
+		uint32_t k = old_keys[hdr->cursor];
+		if (!k)
+			continue;
+		j = hmap__probe(hdr, k, 1, 0, elem_size);
+		memcpy(vals + j * elem_size, old_vals + hdr->cursor * elem_size, elem_size);
+		old_keys[hdr->cursor] = 0;
+		old->len--;
+		hdr->len--;
+	}
+
+	#ifdef TINYHASHMAP_STATS
+	counts.grow_bytes += (moved - old->len) * (sizeof(uint32_t) + elem_size);
+	hdr->counts = counts;
+	#endif
+	if (!old->len)
+	{
+		TINYHASHMAP_FREE(hdr->allocctx, old->mem);
+		hdr->old = NULL;
+	}
+}
+
+HMAP__UNUSED static void hmap__finishgrow(struct hmap__hdr* hdr, size_t elem_size)
+{
+	while (hdr->old)
+		hmap__migrate(hdr, 0, elem_size);
+}
+
+HMAP__UNUSED static ptrdiff_t hmap__idx(struct hmap__hdr* hdr, uint32_t key, int add, int del, size_t elem_size)
+{
+	#ifdef TINYHASHMAP_BLOOM
+	ptrdiff_t i;
+	size_t len;
+	if (hdr->bloom && !add && !bloom__has(hdr->bloom, key))
+	{
+		/* surely not in the map, answered without touching the table */
+		HMAP__COUNT(hdr, lookups, 1);
+		HMAP__COUNT(hdr, misses, 1);
+		return (ptrdiff_t)-1;
+	}
+	if (hdr->old)
+		hmap__migrate(hdr, key, elem_size);
+	len = hdr->len;
+	i = hmap__probe(hdr, key, add, del, elem_size);
+	if (hdr->bloom && hdr->len > len)
+		bloom__add(hdr->bloom, key);
+	else if (hdr->bloom && hdr->len < len && ++hdr->bloomstale > hdr->maxload / 4)
+		hmap__bloomrebuild(hdr, hdr, 0); /* drop the bits of deleted keys */
+	return i;
+	#else
+	if (hdr->old)
+		hmap__migrate(hdr, key, elem_size);
+	return hmap__probe(hdr, key, add, del, elem_size);
+	#endif
+}
+
+/* Looks up n keys while prefetching the home slots of the keys HMAP__BATCHAHEAD positions further */
+HMAP__UNUSED static size_t hmap__getbatch(struct hmap__hdr* hdr, const uint32_t* keys, size_t n, ptrdiff_t* out_idx, size_t elem_size)
+{
+	char* vals = ((char*)(hdr + 1)) + elem_size;
+	size_t i, found = 0;
+	if (hdr->old)
+		hmap__finishgrow(hdr, elem_size); /* migrating keys would move the slots of earlier keys in the batch */
+	for (i = 0; i != n && i != HMAP__BATCHAHEAD; i++)
+		HMAP__PREFETCH(hdr->keys + HMAP__HOME(hdr, keys[i]));
+	for (i = 0; i != n; i++)
+	{
+		if (i + HMAP__BATCHAHEAD < n)
+			HMAP__PREFETCH(hdr->keys + HMAP__HOME(hdr, keys[i + HMAP__BATCHAHEAD]));
+		#ifdef TINYHASHMAP_BLOOM
+		if (hdr->bloom && !bloom__has(hdr->bloom, keys[i]))
+		{
+			HMAP__COUNT(hdr, lookups, 1);
+			HMAP__COUNT(hdr, misses, 1);
+			out_idx[i] = -1;
+			continue;
+		}
+		#endif
+		if ((out_idx[i] = hmap__probe(hdr, keys[i], 0, 0, elem_size)) != -1)
+		{
+			HMAP__PREFETCH(vals + out_idx[i] * elem_size);
+			found++;
+		}
+	}
+	return found;
+}
+
+HMAP__UNUSED static size_t hmap__missbatch(ptrdiff_t* out_idx, size_t n)
+{
+	size_t i;
+	for (i = 0; i != n; i++)
+		out_idx[i] = -1;
+	return 0;
+}
+
+/* Sets n keys while prefetching the home slots of the keys and values HMAP__BATCHAHEAD positions further */
+HMAP__UNUSED static void* hmap__setbatch(struct hmap__hdr* hdr, void* ptr, const uint32_t* keys, size_t n, const void* in_vals, size_t elem_size)
+{
+	size_t i;
+	for (i = 0; i != n; i++)
+	{
+		ptrdiff_t j;
+		if (!ptr || hdr->len > hdr->maxload)
+		{
+			if (!(ptr = hmap__grow(hdr, ptr, elem_size, 0, (ptr ? hdr->allocctx : NULL), 0)))
+				return NULL; /* out of memory */
+			hdr = (struct hmap__hdr*)((char*)ptr - elem_size) - 1;
+		}
+		if (i + HMAP__BATCHAHEAD < n)
+		{
+			size_t home = HMAP__HOME(hdr, keys[i + HMAP__BATCHAHEAD]);
+			HMAP__PREFETCH(hdr->keys + home);
+			HMAP__PREFETCH((char*)ptr + home * elem_size);
+		}
+		j = hmap__idx(hdr, keys[i], 1, 0, elem_size);
+		memcpy((char*)ptr + j * elem_size, (const char*)in_vals + i * elem_size, elem_size);
+	}
+	return ptr;
+}
+
+#if defined(HMAP__THREADS) && !defined(HMAP__RUNJOBS)
+#define HMAP__RUNJOBS
+/* Runs fn on n jobs of job_size bytes each, job 0 on the calling thread (and any job for which no thread could be made) */
+HMAP__UNUSED static void hmap__runjobs(hmap__threadfn fn, char* jobs, size_t job_size, size_t n)
+{
+	size_t i;
+	#ifdef _WIN32
+	HANDLE threads[HMAP__MAXTHREADS];
+	for (i = 1; i < n; i++)
+		if (!(threads[i] = CreateThread(NULL, 0, fn, jobs + i * job_size, 0, NULL)))
+			fn(jobs + i * job_size);
+	fn(jobs);
+	for (i = 1; i < n; i++)
+		if (threads[i])
+			WaitForSingleObject(threads[i], INFINITE), CloseHandle(threads[i]);
+	#else
+	pthread_t threads[HMAP__MAXTHREADS];
+	char started[HMAP__MAXTHREADS];
+	for (i = 1; i < n; i++)
+		if (!(started[i] = (char)!pthread_create(&threads[i], NULL, fn, jobs + i * job_size)))
+			fn(jobs + i * job_size);
+	fn(jobs);
+	for (i = 1; i < n; i++)
+		if (started[i])
+			pthread_join(threads[i], NULL);
+	#endif
+}
+#endif
+
+#ifdef TINYHASHMAP_THREADS
+struct hmap__ent { const char* val; uint32_t key; };
+struct hmap__job
+{
+	struct hmap__hdr* hdr; const uint32_t* keys; const char* vals; struct hmap__ent* ents; size_t *counts, *starts; char* ov;
+	size_t elem_size, phase, t, threads, regions, shift, from, to, added, ovlen, ovcap, stop_region, stop_ent;
+};
+
+/* Sets key in the slots of a region which ends before slot end, keys that need to go further are kept in the overflow */
+HMAP__UNUSED static int hmap__place(struct hmap__job* job, size_t end, uint32_t key, const char* val)
+{
+	struct hmap__hdr* hdr = job->hdr;
+	uint32_t *keys = hdr->keys, k = 0;
+	size_t es = job->elem_size, rec = sizeof(uint32_t) + es, home = HMAP__HOME(hdr, key), i, e;
+	char *vals = ((char*)(hdr + 1)) + es, *o;
+
+	for (i = home; i != end; i++)
+	{
+		if ((k = keys[i]) == key)
+		{
+			memcpy(vals + i * es, val, es);
+			return 1;
+		}
+		if (!k || ((i - HMAP__HOME(hdr, k)) & hdr->maxlen) < ((i - home) & hdr->maxlen))
+			break;
+	}
+	if (i == end)
+	{
+		/* slots only fill up in a region, so a key in the overflow is always looked for until the end */
+		for (o = job->ov, e = job->ovlen; e--; o += rec)
+			if (!memcmp(o, &key, sizeof(key)))
+			{
+				memcpy(o + sizeof(key), val, es);
+				return 1;
+			}
+		if (job->ovlen == job->ovcap)
+			return 0;
+		o = job->ov + job->ovlen++ * rec;
+		memcpy(o, &key, sizeof(key));
+		memcpy(o + sizeof(key), val, es);
+		return 1;
+	}
+	if (k)
+	{
+		/* move the keys up to the next empty slot one slot further, the last one of the region moves to the overflow */
+		for (e = i + 1; e != end && keys[e]; e++) {}
+		if (e == end)
+		{
+			if (job->ovlen == job->ovcap)
+				return 0;
+			o = job->ov + job->ovlen++ * rec;
+			memcpy(o, &keys[--e], sizeof(key));
+			memcpy(o + sizeof(key), vals + e * es, es);
+			job->added--;
+		}
+		memmove(keys + i + 1, keys + i, (e - i) * sizeof(uint32_t));
+		memmove(vals + (i + 1) * es, vals + i * es, (e - i) * es);
+	}
+	keys[i] = key;
+	memcpy(vals + i * es, val, es);
+	job->added++;
+	return 1;
+}
+
+/* Phase 0 counts the keys per region, phase 1 sorts them into regions, phase 2 sets the keys of every threads-th region */
+HMAP__UNUSED static HMAP__THREADPROC hmap__buildjob(void* arg)
+{
+	struct hmap__job* job = (struct hmap__job*)arg;
+	size_t i, r;
+	if (job->phase == 0)
+	{
+		for (i = job->from; i != job->to; i++)
+			if (job->keys[i])
+				job->counts[HMAP__HOME(job->hdr, job->keys[i]) >> job->shift]++;
+	}
+	else if (job->phase == 1)
+	{
+		for (i = job->from; i != job->to; i++)
+			if (job->keys[i])
+			{
+				struct hmap__ent* ent = &job->ents[job->counts[HMAP__HOME(job->hdr, job->keys[i]) >> job->shift]++];
+				ent->key = job->keys[i];
+				ent->val = job->vals + i * job->elem_size;
+			}
 	}
 	else
 	{
+		for (job->stop_region = job->regions, r = job->t; r < job->regions; r += job->threads)
+			for (i = job->starts[r]; i != job->starts[r + 1]; i++)
+				if (!hmap__place(job, (r + 1) << job->shift, job->ents[i].key, job->ents[i].val))
+				{
+					/* the overflow is full, the rest gets set after all threads are done */
+					job->stop_region = r;
+					job->stop_ent = i;
+					return 0;
+				}
+	}
+	return 0;
+}
+
+/* Sets n keys with multiple threads which each fill the slots of separate regions, returns 0 if it didn't do anything */
+HMAP__UNUSED static int hmap__buildparallel(struct hmap__hdr* hdr, const uint32_t* keys, const char* in_vals, size_t n, size_t elem_size, size_t nthreads)
+{
+	struct hmap__job jobs[HMAP__MAXTHREADS];
+	size_t threads = (nthreads < HMAP__MAXTHREADS ? nthreads : HMAP__MAXTHREADS), regions = 1, bits = 0, rec = sizeof(uint32_t) + elem_size;
+	size_t ovcap = 65536 / rec + 16, shift, t, r, i, pos, *counts, *starts;
+	char *mem, *vals = ((char*)(hdr + 1)) + elem_size;
+	struct hmap__ent* ents;
+
+	/* about 4 regions per thread to even out the work, with at least 4096 slots each */
+	while (regions < 4 * threads && ((hdr->maxlen + 1) >> (bits + 1)) >= 4096)
+		regions <<= 1, bits++;
+	if (threads > regions)
+		threads = regions;
+	if (threads < 2)
+		return 0;
+	for (shift = 0; ((size_t)1 << shift) <= hdr->maxlen; shift++) {}
+	shift -= bits;
+
+	mem = (char*)TINYHASHMAP_MALLOC(hdr->allocctx, n * sizeof(struct hmap__ent) + (threads * regions + regions + 1) * sizeof(size_t) + threads * ovcap * rec);
+	if (!mem)
+		return 0; /* out of memory, set the keys without threads */
+	ents = (struct hmap__ent*)mem;
+	counts = (size_t*)(ents + n);
+	starts = counts + threads * regions;
+	memset(counts, 0, threads * regions * sizeof(size_t));
+	for (t = 0; t != threads; t++)
+	{
+		struct hmap__job* job = &jobs[t];
+		job->hdr = hdr;
+		job->keys = keys;
+		job->vals = in_vals;
+		job->ents = ents;
+		job->counts = counts + t * regions;
+		job->starts = starts;
+		job->ov = (char*)(starts + regions + 1) + t * ovcap * rec;
+		job->elem_size = elem_size;
+		job->phase = 0;
+		job->t = t;
+		job->threads = threads;
+		job->regions = regions;
+		job->shift = shift;
+		job->from = n / threads * t + (t < n % threads ? t : n % threads);
+		job->to = job->from + n / threads + (t < n % threads);
+		job->added = job->ovlen = 0;
+		job->ovcap = ovcap;
+	}
+	hmap__runjobs(hmap__buildjob, (char*)jobs, sizeof(jobs[0]), threads);
+
+	/* the keys of a region are sorted by thread so they stay in the order of the array and the last of equal keys wins */
+	for (pos = 0, r = 0; r != regions; r++)
+		for (starts[r] = pos, t = 0; t != threads; t++)
+		{
+			size_t count = counts[t * regions + r];
+			counts[t * regions + r] = pos;
+			pos += count;
+		}
+	starts[regions] = pos;
+	for (t = 0; t != threads; t++)
+		jobs[t].phase = 1;
+	hmap__runjobs(hmap__buildjob, (char*)jobs, sizeof(jobs[0]), threads);
+	for (t = 0; t != threads; t++)
+		jobs[t].phase = 2;
+	hmap__runjobs(hmap__buildjob, (char*)jobs, sizeof(jobs[0]), threads);
+
+	/* set the keys that went past the end of their region and the rest of a job with a full overflow */
+	for (t = 0; t != threads; t++)
+	{
+		struct hmap__job* job = &jobs[t];
+		hdr->len += job->added;
+		for (i = 0; i != job->ovlen; i++)
+		{
+			uint32_t k;
+			char* o = job->ov + i * rec;
+			memcpy(&k, o, sizeof(k));
+			memcpy(vals + hmap__probe(hdr, k, 1, 0, elem_size) * elem_size, o + sizeof(k), elem_size);
+		}
+		for (r = job->stop_region; r < regions; r += threads)
+			for (i = (r == job->stop_region ? job->stop_ent : starts[r]); i != starts[r + 1]; i++)
+				memcpy(vals + hmap__probe(hdr, ents[i].key, 1, 0, elem_size) * elem_size, ents[i].val, elem_size);
+	}
+	TINYHASHMAP_FREE(hdr->allocctx, mem);
+	return 1;
+}
+#endif
+
+/* Sets n keys after growing once to fit all of them, with TINYHASHMAP_THREADS this uses up to nthreads threads for large n */
+HMAP__UNUSED static void* hmap__build(struct hmap__hdr* hdr, void* ptr, const uint32_t* keys, const void* in_vals, size_t n, size_t elem_size, size_t nthreads)
+{
+	size_t i;
+	char* vals;
+	#ifdef TINYHASHMAP_STATS
+	struct hmap__counts counts;
+	size_t len;
+	#endif
+	if (!n)
+		return ptr;
+	if (!ptr || hdr->len + n > hdr->maxload)
+	{
+		void* grown = hmap__grow(hdr, ptr, elem_size, (ptr ? hdr->len : 0) + n, (ptr ? hdr->allocctx : NULL), 0);
+		if (grown == ptr)
+			return ptr; /* out of memory */
+		hdr = (struct hmap__hdr*)((char*)(ptr = grown) - elem_size) - 1;
+	}
+	if (hdr->old)
+		hmap__finishgrow(hdr, elem_size);
+	vals = ((char*)ptr);
+	#ifdef TINYHASHMAP_BLOOM
+	if (hdr->bloom)
+		for (i = 0; i != n; i++)
+			bloom__add(hdr->bloom, keys[i]);
+	#endif
+	#ifdef TINYHASHMAP_STATS
+	counts = hdr->counts; /* only count the added keys as inserts */
+	len = hdr->len;
+	#endif
+
+	#ifdef TINYHASHMAP_THREADS
+	if (nthreads > 1 && n >= 65536 && hmap__buildparallel(hdr, keys, (const char*)in_vals, n, elem_size, nthreads))
+		n = 0; /* all keys are set */
+	#else
+	(void)nthreads;
+	#endif
+	for (i = 0; i != n; i++)
+	{
+		ptrdiff_t j;
+		if (i + HMAP__BATCHAHEAD < n)
+		{
+			size_t home = HMAP__HOME(hdr, keys[i + HMAP__BATCHAHEAD]);
+			HMAP__PREFETCH(hdr->keys + home);
+			HMAP__PREFETCH(vals + home * elem_size);
+		}
+		if ((j = hmap__probe(hdr, keys[i], 1, 0, elem_size)) != -1)
+			memcpy(vals + j * elem_size, (const char*)in_vals + i * elem_size, elem_size);
+	}
+
+	#ifdef TINYHASHMAP_STATS
+	counts.inserts += hdr->len - len;
+	hdr->counts = counts;
+	#endif
+	return ptr;
+}
+
+/* Goes over the keys of a table in the order of their home slot in a table with maxlen or more slots */
+struct hmap__stream { const struct hmap__hdr* src; size_t part, parts, bits, i, wrapped; };
+
+HMAP__UNUSED static size_t hmap__next(struct hmap__stream* s, size_t maxlen)
+{
+	for (;;)
+	{
+		uint32_t k;
+		if (s->part == s->parts)
+			return (size_t)-1;
+		if (s->i > s->src->maxlen || (s->wrapped && !s->src->keys[s->i]))
+		{
+			/* the slots in order are followed by the keys which wrapped around to the first slots (before the first empty slot) */
+			if (!(s->wrapped ^= 1))
+				s->part++;
+			s->i = 0;
+			continue;
+		}
+		/* the larger table splits each home slot into parts, a pass over the slots for every part keeps the order */
+		if ((k = s->src->keys[s->i++]) != 0)
+		{
+			uint32_t h = hmap__hash(s->src->seed, k);
+			if (((size_t)(h & s->src->maxlen) >= s->i) == (s->wrapped != 0) && ((h & maxlen) >> s->bits) == s->part)
+				return s->i - 1;
+		}
+	}
+}
+
+/* Adds the entries of src (replacing the values of equal keys), a new table gets filled in order of the home slots of both */
+HMAP__UNUSED static void* hmap__merge(struct hmap__hdr* hdr, void* ptr, struct hmap__hdr* src, size_t elem_size)
+{
+	struct hmap__hdr* new_hdr;
+	struct hmap__stream a, b;
+	char *src_vals = ((char*)(src + 1)) + elem_size, *new_vals;
+	size_t i, j, pos, m, lf = (ptr ? hdr->loadfactor : 128), res = src->len + (ptr ? hdr->len : 0);
+	#ifdef TINYHASHMAP_STATS
+	struct hmap__counts counts;
+	#endif
+
+	if (!src->len || hdr == src)
+		return ptr;
+	if (ptr && hdr->old)
+		hmap__finishgrow(hdr, elem_size);
+	#ifdef TINYHASHMAP_BLOOM
+	if (ptr && hdr->bloom)
+		for (i = 0; i <= src->maxlen; i++)
+			if (src->keys[i])
+				bloom__add(hdr->bloom, src->keys[i]);
+	#endif
+	if (ptr && res <= hdr->maxload)
+	{
+		/* fits already, only the entries of src get added */
+		char* vals = (char*)ptr;
+		for (i = 0; i <= src->maxlen; i++)
+			if (src->keys[i])
+				memcpy(vals + hmap__probe(hdr, src->keys[i], 1, 0, elem_size) * elem_size, src_vals + i * elem_size, elem_size);
+		return ptr;
+	}
+
+	/* the new table has at least as many slots as both so their home slots split evenly into it */
+	m = (ptr && hdr->maxlen > src->maxlen ? hdr->maxlen : src->maxlen);
+	while (HMAP__MAXLOAD(m, lf) <= res)
+		if (!(m = m * 2 + 1))
+			return ptr; /* overflow */
+	if (!(new_hdr = hmap__alloc(m, lf, (ptr ? hdr->allocctx : NULL), elem_size)))
+		return ptr; /* overflow or out of memory */
+	new_vals = ((char*)(new_hdr + 1)) + elem_size;
+	if (ptr)
+	{
+		new_hdr->incremental = hdr->incremental;
+		memcpy(new_vals - elem_size, (char*)ptr - elem_size, elem_size);
+	}
+	else
 		memset(new_vals - elem_size, 0, elem_size);
-		new_hdr->len = 0;
+
+	/* the new table keeps the seed of map (or takes the one of src), home slots in order only exist with the same seed */
+	if (ptr)
+		new_hdr->seed = hdr->seed;
+	else
+		new_hdr->seed = src->seed;
+	memset(&a, 0, sizeof(a));
+	memset(&b, 0, sizeof(b));
+	if (ptr)
+		for (a.src = hdr, a.parts = (m + 1) / (hdr->maxlen + 1); ((size_t)1 << a.bits) <= hdr->maxlen; a.bits++) {}
+	if (src->seed == new_hdr->seed)
+		for (b.src = src, b.parts = (m + 1) / (src->maxlen + 1); ((size_t)1 << b.bits) <= src->maxlen; b.bits++) {}
+	i = hmap__next(&a, m);
+	j = hmap__next(&b, m);
+	for (pos = 0; i != (size_t)-1 || j != (size_t)-1;)
+	{
+		/* with keys in order of their home slot each goes into the first free slot from its home, no probing needed */
+		int from_src = (i == (size_t)-1 || (j != (size_t)-1 && HMAP__HOME(new_hdr, src->keys[j]) < HMAP__HOME(new_hdr, hdr->keys[i])));
+		uint32_t key = (from_src ? src->keys[j] : hdr->keys[i]);
+		const char* val = (from_src ? src_vals + j * elem_size : (char*)ptr + i * elem_size);
+		size_t home = HMAP__HOME(new_hdr, key), p;
+		if (from_src)
+			j = hmap__next(&b, m);
+		else
+			i = hmap__next(&a, m);
+
+		/* an equal key is one of the last slots with the same home slot */
+		for (p = pos; p > home && HMAP__HOME(new_hdr, new_hdr->keys[p - 1]) == home && new_hdr->keys[p - 1] != key; p--) {}
+		if (p > home && new_hdr->keys[p - 1] == key)
+		{
+			if (from_src)
+				memcpy(new_vals + (p - 1) * elem_size, val, elem_size);
+			continue;
+		}
+		if (pos < home)
+			pos = home;
+		if (pos > m)
+		{
+			/* past the last slot, wrap around to the first slots like normal */
+			size_t len = new_hdr->len;
+			ptrdiff_t k = hmap__probe(new_hdr, key, 1, 0, elem_size);
+			if (from_src || new_hdr->len != len)
+				memcpy(new_vals + k * elem_size, val, elem_size);
+			continue;
+		}
+		new_hdr->keys[pos] = key;
+		memcpy(new_vals + pos++ * elem_size, val, elem_size);
+		new_hdr->len++;
+	}
+	if (!b.src)
+		for (j = 0; j <= src->maxlen; j++)
+			if (src->keys[j])
+				memcpy(new_vals + hmap__probe(new_hdr, src->keys[j], 1, 0, elem_size) * elem_size, src_vals + j * elem_size, elem_size);
+
+	#ifdef TINYHASHMAP_STATS
+	if (ptr)
+		counts = hdr->counts;
+	else
+		memset(&counts, 0, sizeof(counts));
+	counts.grows++;
+	counts.grow_bytes += res * (sizeof(uint32_t) + elem_size);
+	new_hdr->counts = counts;
+	#endif
+	#ifdef TINYHASHMAP_BLOOM
+	if (ptr && hdr->bloom)
+	{
+		/* the filter already has the keys of src, it moves to the new table and gets made again for its size */
+		new_hdr->bloom = hdr->bloom;
+		hmap__bloomrebuild(new_hdr, new_hdr, 0);
 	}
+	#endif
+	if (ptr)
+		TINYHASHMAP_FREE(hdr->allocctx, hdr->mem);
 	return new_vals;
 }
 
-HMAP__UNUSED static ptrdiff_t hmap__idx(struct hmap__hdr* hdr, uint32_t key, int add, size_t del)
+HMAP__UNUSED static int hset__add(struct hmap__hdr* hdr, uint32_t key)
 {
-	uint32_t i;
+	size_t len = hdr->len;
+	hmap__idx(hdr, key, 1, 0, 0);
+	return (hdr->len != len);
+}
 
-	if (!key)
-		return (ptrdiff_t)-1;
+/* Adds the keys of other, growing when needed like hmap__setbatch */
+HMAP__UNUSED static void* hset__union(struct hmap__hdr* hdr, void* ptr, struct hmap__hdr* other)
+{
+	size_t i;
+	for (i = 0; i <= other->maxlen; i++)
+	{
+		if (!other->keys[i])
+			continue;
+		if (!ptr || hdr->len > hdr->maxload)
+		{
+			void* grown = hmap__grow(hdr, ptr, 0, 0, (ptr ? hdr->allocctx : NULL), 0);
+			if (grown == ptr)
+				return ptr; /* out of memory */
+			hdr = HSET__HDR(ptr = grown);
+		}
+		hmap__idx(hdr, other->keys[i], 1, 0, 0);
+	}
+	return ptr;
+}
 
-	for (i = key;; i++)
+/* Removes the keys not in other (all if other is NULL) */
+HMAP__UNUSED static void hset__intersect(struct hmap__hdr* hdr, struct hmap__hdr* other)
+{
+	size_t i = 0;
+	while (i <= hdr->maxlen)
+	{
+		uint32_t key = hdr->keys[i];
+		if (key && (!other || hmap__idx(other, key, 0, 0, 0) == -1))
+			hmap__idx(hdr, key, 0, 1, 0); /* the backward shift can move the next key into slot i, check it again */
+		else
+			i++;
+	}
+}
+
+#ifdef TINYHASHMAP_STATS
+/* Copies the counters and scans the table for the probe length histogram and the longest cluster */
+HMAP__UNUSED static void hmap__stats(const struct hmap__hdr* hdr, struct hmap_stats* out)
+{
+	size_t i, s, d, run = 0;
+	memset(out, 0, sizeof(*out));
+	if (!hdr)
+		return;
+	out->lookups = hdr->counter->lookups;
+	out->hits = hdr->counter->hits;
+	out->misses = hdr->counter->misses;
+	out->probes = hdr->counter->probes;
+	out->inserts = hdr->counter->inserts;
+	out->insert_shifts = hdr->counter->insert_shifts;
+	out->deletes = hdr->counter->deletes;
+	out->delete_shifts = hdr->counter->delete_shifts;
+	out->grows = hdr->counter->grows;
+	out->grow_bytes = hdr->counter->grow_bytes;
+	out->len = hdr->len;
+	out->cap = hdr->maxlen + 1;
+	/* start after an empty slot so no cluster wraps around the scan */
+	for (s = 0; s <= hdr->maxlen && hdr->keys[s]; s++) {}
+	for (i = 1; i <= hdr->maxlen + 1; i++)
 	{
-		if (hdr->keys[i &= hdr->maxlen] == key)
+		uint32_t k = hdr->keys[(s + i) & hdr->maxlen];
+		if (!k)
 		{
-			if (del)
+			run = 0;
+			continue;
+		}
+		d = (((s + i) & hdr->maxlen) - HMAP__HOME(hdr, k)) & hdr->maxlen;
+		out->probe_hist[d < 31 ? d : 31]++;
+		if (d > out->max_probe) out->max_probe = d;
+		if (++run > out->max_cluster) out->max_cluster = run;
+	}
+}
+#endif
+
+/* A frozen map has one allocation with the keys array, the header, the null value, the values and the displacements */
+struct hmapf__hdr { size_t len, slots, buckets; uint32_t *keys; unsigned int *disp; HMAP__U64 seed; void *allocctx, *mem; };
+#define HMAPF__HDR(f) (((struct hmapf__hdr *)&(f)[-1])-1)
+#define HMAPF__KEYSSIZE(slots) (((slots) * sizeof(uint32_t) + 15) & ~(size_t)15)
+#define HMAPF__DISPOFS(slots, elem_size) ((HMAPF__KEYSSIZE(slots) + sizeof(struct hmapf__hdr) + ((slots) + 1) * (elem_size) + sizeof(unsigned int) - 1) & ~(sizeof(unsigned int) - 1))
+#define HMAPF__SIZE(slots, buckets, elem_size) (HMAPF__DISPOFS(slots, elem_size) + (buckets) * sizeof(unsigned int))
+#define HMAPF__HASH(key, seed) hmap__wymix((HMAP__U64)(key) ^ (seed), (HMAP__U64)0xe7037ed1a0b428db)
+#define HMAPF__BUCKET(h, buckets) ((size_t)((((h) & 0xFFFFFFFF) * (buckets)) >> 32))
+#define HMAPF__PROBE(h) hmap__wymix((h), (HMAP__U64)0x8ebc6af09c88c6e3)
+#define HMAPF__SLOT(g, d, slots) ((size_t)(((((g) >> 32) + (HMAP__U64)(d) * (((g) & 0xFFFFFFFF) | 1)) & 0xFFFFFFFF) * (slots) >> 32))
+#define HMAPF__BUCKETS(n) ((n) / 3 + 1) /* smaller buckets need fewer tries to place when the table is almost full */
+#define HMAPF__DIRECT 0x80000000u /* displacement is the slot of the only key in the bucket */
+#define HMAPF__MAXTRIES 0x1000000 /* displacements tried for a bucket before starting over with another seed */
+#define HMAPF__TAKEN(bits, slot) ((bits)[(slot) >> 6] & ((HMAP__U64)1 << ((slot) & 63)))
+#define HMAPF__FLIP(bits, slot) ((bits)[(slot) >> 6] ^= ((HMAP__U64)1 << ((slot) & 63)))
+
+HMAP__UNUSED static ptrdiff_t hmapf__idx(const struct hmapf__hdr* hdr, uint32_t key)
+{
+	HMAP__U64 h = HMAPF__HASH(key, hdr->seed);
+	unsigned int d = hdr->disp[HMAPF__BUCKET(h, hdr->buckets)];
+	size_t slot = ((d & HMAPF__DIRECT) ? (size_t)(d & ~HMAPF__DIRECT) : HMAPF__SLOT(HMAPF__PROBE(h), d, hdr->slots));
+	return (hdr->keys[slot] == key && key ? (ptrdiff_t)slot : -1);
+}
+
+/* Builds a minimal perfect hash table with hash and displace (CHD): the keys get split into buckets of about 3, then
+   starting from the largest bucket each one searches a displacement that sends all its keys to free slots.
+   Buckets with a single key come last and get the remaining slots stored directly. */
+HMAP__UNUSED static void* hmapf__freeze(struct hmap__hdr* src, void* src_ptr, size_t elem_size)
+{
+	size_t n = (src_ptr ? src->len : 0), slots = (n ? n : 1), buckets = HMAPF__BUCKETS(n), i, j, b, size, maxsize, free_slot;
+	size_t *tmp_idx;
+	HMAP__U64 *tmp_h, *taken, seed = (HMAP__U64)0x589965cc75374cc3;
+	unsigned int *members, *start, d;
+	struct hmapf__hdr *hdr;
+	char *mem, *tmp, *vals, *src_vals = (char*)src_ptr;
+	void *ctx = (src_ptr ? src->allocctx : NULL);
+	if (n >= HMAPF__DIRECT || slots > ((size_t)-1 - HMAP__ALIGN - 16 - sizeof(struct hmapf__hdr)) / (sizeof(uint32_t) + elem_size + sizeof(unsigned int)) - 2)
+		return NULL; /* overflow */
+
+	mem = (char *)TINYHASHMAP_MALLOC(ctx, HMAP__ALIGN - 1 + HMAPF__SIZE(slots, buckets, elem_size));
+	if (!mem)
+		return NULL; /* out of memory */
+	tmp = (char *)TINYHASHMAP_MALLOC(ctx, n * (sizeof(HMAP__U64) + sizeof(size_t) + sizeof(unsigned int)) + (slots + 63) / 64 * sizeof(HMAP__U64) + (buckets + 1) * sizeof(unsigned int));
+	if (!tmp)
+	{
+		TINYHASHMAP_FREE(ctx, mem);
+		return NULL; /* out of memory */
+	}
+	tmp_h = (HMAP__U64 *)tmp;
+	taken = tmp_h + n; /* bitmap of the slots which is small enough to stay in the cache */
+	tmp_idx = (size_t *)(taken + (slots + 63) / 64);
+	members = (unsigned int *)(tmp_idx + n);
+	start = members + n;
+
+	hdr = (struct hmapf__hdr *)(mem + ((HMAP__ALIGN - (size_t)mem) & (HMAP__ALIGN - 1)) + HMAPF__KEYSSIZE(slots));
+	memset((char*)hdr - HMAPF__KEYSSIZE(slots), 0, HMAPF__SIZE(slots, buckets, elem_size));
+	hdr->len = n;
+	hdr->slots = slots;
+	hdr->buckets = buckets;
+	hdr->keys = (uint32_t *)((char*)hdr - HMAPF__KEYSSIZE(slots));
+	hdr->disp = (unsigned int *)((char*)hdr->keys + HMAPF__DISPOFS(slots, elem_size));
+	hdr->allocctx = ctx;
+	hdr->mem = mem;
+	vals = ((char*)(hdr + 1)) + elem_size;
+	if (src_ptr)
+		memcpy(vals - elem_size, src_vals - elem_size, elem_size);
+
+	for (i = j = 0; j != n; i++)
+		if (src->keys[i])
+			tmp_idx[j++] = i;
+
+	for (;; seed = hmap__wymix(seed, (HMAP__U64)0xa0761d6478bd642f))
+	{
+		/* sort the keys by bucket, tmp_h gets the probe hashes in that order so the bucket keys are next to each other */
+		memset(start, 0, (buckets + 1) * sizeof(unsigned int));
+		memset(taken, 0, (slots + 63) / 64 * sizeof(HMAP__U64));
+		for (i = 0; i != n; i++)
+			start[HMAPF__BUCKET(HMAPF__HASH(src->keys[tmp_idx[i]], seed), buckets) + 1]++;
+		for (b = maxsize = 0; b != buckets; b++)
+		{
+			if (start[b + 1] > maxsize) maxsize = start[b + 1];
+			start[b + 1] += start[b];
+		}
+		for (i = 0; i != n; i++)
+		{
+			HMAP__U64 h = HMAPF__HASH(src->keys[tmp_idx[i]], seed);
+			j = start[HMAPF__BUCKET(h, buckets)]++;
+			tmp_h[j] = HMAPF__PROBE(h);
+			members[j] = (unsigned int)i;
+		}
+		for (b = buckets; b; b--)
+			start[b] = start[b - 1];
+		start[0] = 0;
+
+		for (size = maxsize; size > 1; size--)
+		{
+			for (b = 0; b != buckets; b++)
 			{
-				hdr->len--;
-				hdr->keys[i] = 0;
-				while ((key = hdr->keys[i = (i + 1) & hdr->maxlen]) != 0)
+				HMAP__U64 *g = tmp_h + start[b];
+				if (start[b + 1] - start[b] != size)
+					continue;
+				for (d = 0; d != HMAPF__MAXTRIES; d++)
 				{
-					if ((key = (uint32_t)hmap__idx(hdr, key, 1, 0)) == i) continue;
-					hdr->len--;
-					hdr->keys[i] = 0;
-					memcpy(((char*)(hdr + 1)) + (key + 1) * del,
-						((char*)(hdr + 1)) + (i + 1) * del, del);
+					/* take the slots one by one, on a collision give back the ones taken so far */
+					for (j = 0; j != size && !HMAPF__TAKEN(taken, HMAPF__SLOT(g[j], d, slots)); j++)
+						HMAPF__FLIP(taken, HMAPF__SLOT(g[j], d, slots));
+					if (j == size)
+						break;
+					while (j--)
+						HMAPF__FLIP(taken, HMAPF__SLOT(g[j], d, slots));
 				}
+				if (d == HMAPF__MAXTRIES)
+					break;
+				hdr->disp[b] = d;
 			}
-			return (ptrdiff_t)i;
+			if (b != buckets)
+				break;
 		}
-		if (!hdr->keys[i])
+		if (size <= 1)
+			break;
+	}
+	hdr->seed = seed;
+
+	/* fill in keys and values, buckets with a single key get the remaining slots */
+	for (b = free_slot = 0; b != buckets; b++)
+	{
+		size_t slot;
+		for (j = start[b]; j != start[b + 1]; j++)
 		{
-			if (add) { hdr->len++; hdr->keys[i] = key; return (ptrdiff_t)i; }
-			return (ptrdiff_t)-1;
+			if (start[b + 1] - start[b] == 1)
+			{
+				while (HMAPF__TAKEN(taken, free_slot))
+					free_slot++;
+				hdr->disp[b] = (unsigned int)free_slot | HMAPF__DIRECT;
+				slot = free_slot++;
+			}
+			else
+				slot = HMAPF__SLOT(tmp_h[j], hdr->disp[b], slots);
+			hdr->keys[slot] = src->keys[tmp_idx[members[j]]];
+			memcpy(vals + slot * elem_size, src_vals + tmp_idx[members[j]] * elem_size, elem_size);
 		}
 	}
+	TINYHASHMAP_FREE(ctx, tmp);
+	return vals;
+}
+
+#ifdef TINYHASHMAP_MMAP
+/* File header, followed by the keys array, the header (with the pointers zeroed), the null value and the values */
+struct hmap__file { char magic[8]; HMAP__U64 version, key_size, elem_size, maxlen, len, loadfactor, hdr_size; };
+#define HMAP__FILESIZE(maxlen, elem_size) (sizeof(struct hmap__file) + ((maxlen) + 1) * sizeof(uint32_t) + sizeof(struct hmap__hdr) + ((maxlen) + 2) * (elem_size))
+
+HMAP__UNUSED static int hmap__write(int fd, const void* ptr, size_t size)
+{
+	const char* p = (const char*)ptr;
+	while (size)
+	{
+		#ifdef _WIN32
+		int n = _write(fd, p, (unsigned int)(size < 0x40000000 ? size : 0x40000000));
+		#else
+		ptrdiff_t n = write(fd, p, (size < 0x40000000 ? size : 0x40000000));
+		#endif
+		if (n <= 0)
+			return 0;
+		p += n;
+		size -= (size_t)n;
+	}
+	return 1;
+}
+
+HMAP__UNUSED static int hmap__save(struct hmap__hdr* hdr, size_t elem_size, int fd)
+{
+	struct hmap__file f;
+	struct hmap__hdr h = *hdr;
+	memset(&f, 0, sizeof(f));
+	memcpy(f.magic, "TINYHMAP", 8);
+	f.version = 2; /* version 2 added the seed */
+	f.key_size = sizeof(uint32_t);
+	f.elem_size = elem_size;
+	f.maxlen = hdr->maxlen;
+	f.len = hdr->len;
+	f.loadfactor = hdr->loadfactor;
+	f.hdr_size = sizeof(struct hmap__hdr);
+	/* pointers get set up again when loading so the file can be mapped at any address */
+	h.keys = NULL;
+	h.old = NULL;
+	h.incremental = h.cursor = 0;
+	h.allocctx = h.mem = NULL;
+	#ifdef TINYHASHMAP_STATS
+	memset(&h.counts, 0, sizeof(h.counts));
+	h.counter = NULL;
+	#endif
+	#ifdef TINYHASHMAP_BLOOM
+	h.bloom = NULL;
+	h.bloomstale = 0;
+	#endif
+	return (hmap__write(fd, &f, sizeof(f)) && hmap__write(fd, hdr->keys, (hdr->maxlen + 1) * sizeof(uint32_t))
+		&& hmap__write(fd, &h, sizeof(h)) && hmap__write(fd, hdr + 1, (hdr->maxlen + 2) * elem_size));
+}
+
+/* Checks a mapped file and points the header at the mapping, returns the values or NULL if the file doesn't match */
+HMAP__UNUSED static void* hmap__mapped(char* base, HMAP__U64 size, size_t elem_size)
+{
+	const struct hmap__file* f = (const struct hmap__file*)base;
+	struct hmap__hdr* hdr;
+	if (size < sizeof(struct hmap__file) || memcmp(f->magic, "TINYHMAP", 8) || f->version != 2 || f->key_size != sizeof(uint32_t)
+		|| f->elem_size != elem_size || f->hdr_size != sizeof(struct hmap__hdr) || (f->maxlen & (f->maxlen + 1))
+		|| f->maxlen >= size / (sizeof(uint32_t) + elem_size) || size != HMAP__FILESIZE((size_t)f->maxlen, elem_size))
+		return NULL;
+	hdr = (struct hmap__hdr *)(base + sizeof(struct hmap__file) + ((size_t)f->maxlen + 1) * sizeof(uint32_t));
+	if (hdr->maxlen != f->maxlen || hdr->len != f->len || hdr->len > hdr->maxload || hdr->maxload > hdr->maxlen)
+		return NULL;
+	#ifdef TINYHASHMAP_STATS
+	if (!(hdr->counter = (struct hmap__counts *)TINYHASHMAP_MALLOC(NULL, sizeof(struct hmap__counts))))
+		return NULL; /* out of memory */
+	memset(hdr->counter, 0, sizeof(struct hmap__counts));
+	#endif
+	hdr->keys = (uint32_t *)(base + sizeof(struct hmap__file));
+	hdr->mem = base;
+	#ifdef TINYHASHMAP_BLOOM
+	hdr->bloom = NULL;
+	#endif
+	return ((char*)(hdr + 1)) + elem_size;
+}
+
+/* File header of a frozen map, followed by the keys array, the header (with the pointers zeroed), the null value, the values and the displacements */
+struct hmapf__file { char magic[8]; HMAP__U64 version, key_size, elem_size, slots, len, buckets, hdr_size; };
+#define HMAPF__FILESIZE(slots, buckets, elem_size) (sizeof(struct hmapf__file) + HMAPF__SIZE(slots, buckets, elem_size))
+
+HMAP__UNUSED static int hmapf__save(struct hmapf__hdr* hdr, size_t elem_size, int fd)
+{
+	struct hmapf__file f;
+	struct hmapf__hdr h = *hdr;
+	memset(&f, 0, sizeof(f));
+	memcpy(f.magic, "TINYHMPF", 8);
+	f.version = 1;
+	f.key_size = sizeof(uint32_t);
+	f.elem_size = elem_size;
+	f.slots = hdr->slots;
+	f.len = hdr->len;
+	f.buckets = hdr->buckets;
+	f.hdr_size = sizeof(struct hmapf__hdr);
+	h.keys = NULL;
+	h.disp = NULL;
+	h.allocctx = h.mem = NULL;
+	return (hmap__write(fd, &f, sizeof(f)) && hmap__write(fd, hdr->keys, HMAPF__KEYSSIZE(hdr->slots)) && hmap__write(fd, &h, sizeof(h))
+		&& hmap__write(fd, hdr + 1, HMAPF__SIZE(hdr->slots, hdr->buckets, elem_size) - HMAPF__KEYSSIZE(hdr->slots) - sizeof(h)));
+}
+
+/* Checks a mapped frozen map file and points the header at the mapping, returns the values or NULL if the file doesn't match */
+HMAP__UNUSED static void* hmapf__mapped(char* base, HMAP__U64 size, size_t elem_size)
+{
+	const struct hmapf__file* f = (const struct hmapf__file*)base;
+	struct hmapf__hdr* hdr;
+	size_t b;
+	if (size < sizeof(struct hmapf__file) || memcmp(f->magic, "TINYHMPF", 8) || f->version != 1 || f->key_size != sizeof(uint32_t)
+		|| f->elem_size != elem_size || f->hdr_size != sizeof(struct hmapf__hdr) || !f->slots || f->slots >= HMAPF__DIRECT || f->len > f->slots
+		|| f->buckets != HMAPF__BUCKETS((size_t)f->len) || size != HMAPF__FILESIZE((size_t)f->slots, (size_t)f->buckets, elem_size))
+		return NULL;
+	hdr = (struct hmapf__hdr *)(base + sizeof(struct hmapf__file) + HMAPF__KEYSSIZE((size_t)f->slots));
+	if (hdr->slots != f->slots || hdr->len != f->len || hdr->buckets != f->buckets)
+		return NULL;
+	hdr->keys = (uint32_t *)(base + sizeof(struct hmapf__file));
+	hdr->disp = (unsigned int *)((char*)hdr->keys + HMAPF__DISPOFS(hdr->slots, elem_size));
+	hdr->mem = base;
+	for (b = 0; b != hdr->buckets; b++)
+		if ((hdr->disp[b] & HMAPF__DIRECT) && (hdr->disp[b] & ~HMAPF__DIRECT) >= hdr->slots)
+			return NULL; /* stored slot out of range */
+	return ((char*)(hdr + 1)) + elem_size;
+}
+
+/* Maps a file copy on write and hands it to the check function which sets up the header */
+HMAP__UNUSED static void* hmap__mmap(const char* path, size_t elem_size, void* (*check)(char* base, HMAP__U64 size, size_t elem_size))
+{
+	char* base;
+	void* vals;
+	#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL), mapping;
+	LARGE_INTEGER size;
+	DWORD old_protect;
+	if (file == INVALID_HANDLE_VALUE)
+		return NULL;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart < (LONGLONG)sizeof(struct hmap__file) || (HMAP__U64)size.QuadPart > (size_t)-1)
+	{
+		CloseHandle(file);
+		return NULL;
+	}
+	/* copy on write so the header can be set up, the rest stays shared with the page cache */
+	mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+	CloseHandle(file);
+	if (!mapping)
+		return NULL;
+	base = (char*)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+	CloseHandle(mapping);
+	if (!base)
+		return NULL;
+	if (!(vals = check(base, (HMAP__U64)size.QuadPart, elem_size)))
+	{
+		UnmapViewOfFile(base);
+		return NULL;
+	}
+	VirtualProtect(base, (size_t)size.QuadPart, PAGE_READONLY, &old_protect);
+	#else
+	struct stat st;
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+	if (fstat(fd, &st) || st.st_size < (off_t)sizeof(struct hmap__file) || (HMAP__U64)st.st_size > (size_t)-1)
+	{
+		close(fd);
+		return NULL;
+	}
+	/* private mapping so the header can be set up, the rest stays shared with the page cache */
+	base = (char*)mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (base == (char*)MAP_FAILED)
+		return NULL;
+	if (!(vals = check(base, (HMAP__U64)st.st_size, elem_size)))
+	{
+		munmap(base, (size_t)st.st_size);
+		return NULL;
+	}
+	mprotect(base, (size_t)st.st_size, PROT_READ);
+	#endif
+	return vals;
 }
 
+HMAP__UNUSED static void hmap__unmapfile(void* base, size_t size)
+{
+	#ifdef _WIN32
+	(void)size;
+	UnmapViewOfFile(base);
+	#else
+	munmap(base, size);
+	#endif
+}
+#endif
+
 #ifdef _MSC_VER
 #pragma warning(pop)
 #endif
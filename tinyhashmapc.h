@@ -0,0 +1,444 @@
+/* TinyHashMapC - concurrent hash map - public domain - Bernhard Schelling 2020
+   https://github.com/schellingb/c-data-structures
+         no warranty implied; use at your own risk
+
+   This file implements a hash map with 32-bit keys which can be read
+   by any number of threads without locking while one thread writes.
+   It uses the same table layout as TinyHashMap.
+
+   Readers load the map pointer atomically and check a sequence number
+   of the table before and after a lookup, retrying when the writer
+   changed the table in between. Readers never write shared memory so
+   lookups scale with the number of cores.
+   The writer increments the sequence number around every change. When
+   growing, the new table is built next to the old one and published
+   with one atomic pointer store. The old table stays readable and gets
+   freed later when no reader can use it anymore (see HMAPC_RECLAIM).
+
+   Values are returned by copy and can be of any POD type. Keys and
+   values share one allocation with the keys cache line aligned.
+   Collisions are resolved with linear probing in Robin Hood order from
+   a home slot which mixes the key with a seed like in TinyHashMap.
+   The writer changes keys and values with word sized atomic stores
+   and readers load them the same way, so a lookup that overlaps a
+   change reads a mix of old and new words (and retries) but never
+   makes a data race.
+   Needs GCC/Clang atomic builtins or MSVC.
+
+   Be careful not to supply modifying statements to the macro arguments.
+   Something like HMAPC_FIT(map, i++); would have unintended results.
+
+   Sample usage:
+
+   -- Shared between threads:
+   mytype_t* map = NULL;
+
+   -- Writer thread (only one at a time):
+   HMAPC_SET(map, my_uint32_hash(key1), some_element);
+   bool removed = HMAPC_DEL(map, my_uint32_hash(key2));
+   -- The value expression of SET must not read the map itself
+
+   -- Reader threads (any number at the same time as the writer):
+   mytype_t elem;
+   bool found = HMAPC_GET(map, my_uint32_hash(key1), &elem);
+   bool has_key = HMAPC_HAS(map, my_uint32_hash(key2));
+   -- now elem == some_element (or the null value if not found)
+
+   -- Free tables replaced by growing (in the writer thread):
+   size_t gen = HMAPC_GEN(map);
+   -- each reader stores the value of HMAPC_GEN(map) into its own
+   -- variable at a point where it holds no pointers into the map
+   -- (for example between two requests). Then with the smallest one:
+   HMAPC_RECLAIM(map, min_gen_seen_by_all_readers);
+   -- Without active readers HMAPC_RECLAIM(map, HMAPC_GEN(map)); frees
+   -- all old tables. HMAPC_RETIRED(map) counts tables not yet freed.
+
+   -- Writer only (like TinyHashMap):
+   HMAPC_LEN(map), HMAPC_CAP(map), HMAPC_KEY(map, i) for iterating
+   HMAPC_CLEAR(map);
+   HMAPC_FIT(map, 30);
+   HMAPC_SETLOADFACTOR(map, 0.875);
+   HMAPC_SETNULLVAL(map, map_null);
+   HMAPC_FREE(map); -- also frees old tables, no reader may be active
+   bool ran_out_of_memory = !HMAPC_TRYFIT(map, 1000);
+
+   -- Use a custom allocator:
+   #define TINYHASHMAP_MALLOC(ctx, size) my_malloc(ctx, size)
+   #define TINYHASHMAP_FREE(ctx, ptr) my_free(ctx, ptr)
+   -- before including this file (ctx is always NULL)
+
+   PUBLIC DOMAIN (UNLICENSE)
+
+   This is free and unencumbered software released into the public domain.
+
+   Anyone is free to copy, modify, publish, use, compile, sell, or
+   distribute this software, either in source code form or as a compiled
+   binary, for any purpose, commercial or non-commercial, and by any
+   means.
+
+   In jurisdictions that recognize copyright laws, the author or authors
+   of this software dedicate any and all copyright interest in the
+   software to the public domain. We make this dedication for the benefit
+   of the public at large and to the detriment of our heirs and
+   successors. We intend this dedication to be an overt act of
+   relinquishment in perpetuity of all present and future rights to this
+   software under copyright law.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+   OTHER DEALINGS IN THE SOFTWARE.
+
+   For more information, please refer to <http://unlicense.org/>
+*/
+
+#ifndef TINYHASHMAPC_H
+#define TINYHASHMAPC_H
+
+#include "tinyhashmap.h" /* for the seeded home slots (hmap__hash and TINYHASHMAP_SEED) */
+#if !defined(__GNUC__) && defined(_MSC_VER)
+#include <intrin.h> /* for _ReadWriteBarrier, __dmb */
+#elif !defined(__GNUC__)
+#error TinyHashMapC needs GCC/Clang atomic builtins or MSVC
+#endif
+
+#define HMAPC_LEN(b) ((b) ? HMAPC__HDR(b)->len : 0)
+#define HMAPC_MAX(b) ((b) ? HMAPC__HDR(b)->maxlen : 0)
+#define HMAPC_CAP(b) ((b) ? HMAPC__HDR(b)->maxlen + 1 : 0)
+#define HMAPC_KEY(b, idx) (HMAPC__HDR(b)->keys[idx])
+#define HMAPC_GEN(b) hmapc__gen((void* const*)(void*)&(b), sizeof(*(b)))
+#define HMAPC_RETIRED(b) ((b) ? hmapc__retired(HMAPC__HDR(b)) : 0)
+#define HMAPC_RECLAIM(b, min_gen) ((b) ? hmapc__reclaim(HMAPC__HDR(b), (size_t)(min_gen)) : 0)
+#define HMAPC_SETNULLVAL(b, val) (HMAPC__FIT1(b), hmapc__begin(HMAPC__HDR(b)), HMAPC__SCRATCH(b) = (val), hmapc__storevals((char*)((b) - 1), (const char*)&HMAPC__SCRATCH(b), sizeof(*(b))), hmapc__end(HMAPC__HDR(b)))
+#define HMAPC_CLEAR(b) ((b) ? (hmapc__begin(HMAPC__HDR(b)), hmapc__clear(HMAPC__HDR(b)), hmapc__end(HMAPC__HDR(b)), 0) : 0)
+#define HMAPC_FREE(b) ((b) ? (hmapc__reclaim(HMAPC__HDR(b), (size_t)-1), TINYHASHMAP_FREE(NULL, HMAPC__HDR(b)->mem), (b) = NULL) : 0)
+#define HMAPC_FIT(b, n) ((!(n) || ((b) && (size_t)(n) <= HMAPC__HDR(b)->maxload)) ? 0 : HMAPC__GROW(b, n))
+#define HMAPC_TRYFIT(b, n) (HMAPC_FIT((b), (n)), (!(n) || ((b) && (size_t)(n) <= HMAPC__HDR(b)->maxload)))
+#define HMAPC_SETLOADFACTOR(b, lf) (HMAPC__FIT1(b), hmapc__setloadfactor(HMAPC__HDR(b), (lf)))
+
+#define HMAPC_SET(b, key, val) (HMAPC__FIT1(b), hmapc__begin(HMAPC__HDR(b)), HMAPC__SCRATCH(b) = (val), hmapc__set(HMAPC__HDR(b), (key), sizeof(*(b))), hmapc__end(HMAPC__HDR(b)))
+#define HMAPC_DEL(b, key) ((b) ? hmapc__del(HMAPC__HDR(b), (key), sizeof(*(b))) : 0)
+#define HMAPC_GET(b, key, out) hmapc__get((void* const*)(void*)&(b), (key), (0 ? (b) : (out)), sizeof(*(b)))
+#define HMAPC_HAS(b, key) hmapc__get((void* const*)(void*)&(b), (key), NULL, sizeof(*(b)))
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable:4505) //unreferenced local function has been removed
+#endif
+
+struct hmapc__hdr { size_t len, maxlen, maxload, loadfactor; uint32_t *keys; struct hmapc__hdr *retired; size_t seq, gen; HMAP__U64 seed; void *allocctx, *mem; };
+#define HMAPC__HDR(b) (((struct hmapc__hdr *)&(b)[-1])-1)
+#define HMAPC__ALIGN 64 /* cache line alignment of the keys */
+#define HMAPC__GROW(b, n) hmapc__publish((void**)(void*)&(b), hmapc__grow(HMAPC__HDR(b), (void*)(b), sizeof(*(b)), (size_t)(n)))
+#define HMAPC__FIT1(b) ((b) && HMAPC_LEN(b) <= HMAPC__HDR(b)->maxload ? 0 : HMAPC__GROW(b, 0))
+#define HMAPC__HOME(hdr, key) ((uint32_t)(hmap__hash((hdr)->seed, (key)) & (hdr)->maxlen))
+#define HMAPC__SCRATCH(b) (b)[HMAPC__HDR(b)->maxlen + 1] /* a value slot after the table only the writer uses */
+
+/* Atomic accesses, the table pointer is loaded with acquire and stored with release, the rest is relaxed and ordered by fences */
+#ifdef __GNUC__
+#define HMAPC__LOADKEY(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define HMAPC__LOADSEQ(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define HMAPC__LOADBYTE(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define HMAPC__STOREKEY(p, v) __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define HMAPC__STOREWORD(p, v) __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define HMAPC__STOREBYTE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define HMAPC__LOADPTR(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define HMAPC__STOREPTR(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define HMAPC__STORESEQ(p, v) __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define HMAPC__FENCEACQ() __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define HMAPC__FENCEREL() __atomic_thread_fence(__ATOMIC_RELEASE)
+#else
+#if defined(_M_ARM64)
+#define HMAPC__FENCEACQ() __dmb(_ARM64_BARRIER_ISH)
+#elif defined(_M_ARM)
+#define HMAPC__FENCEACQ() __dmb(_ARM_BARRIER_ISH)
+#else
+#define HMAPC__FENCEACQ() _ReadWriteBarrier() /* x86 only reorders loads before older stores */
+#endif
+#define HMAPC__FENCEREL() HMAPC__FENCEACQ()
+#define HMAPC__LOADKEY(p) (*(volatile const uint32_t*)(p))
+#define HMAPC__LOADSEQ(p) (*(volatile const size_t*)(p))
+#define HMAPC__LOADBYTE(p) (*(volatile const unsigned char*)(p))
+#define HMAPC__STOREKEY(p, v) (*(volatile uint32_t*)(p) = (v))
+#define HMAPC__STOREWORD(p, v) (*(volatile size_t*)(p) = (v))
+#define HMAPC__STOREBYTE(p, v) (*(volatile unsigned char*)(p) = (v))
+#define HMAPC__LOADPTR(p) hmapc__loadptr((void* const volatile*)(p))
+#define HMAPC__STOREPTR(p, v) (HMAPC__FENCEREL(), *(void* volatile*)(p) = (v))
+#define HMAPC__STORESEQ(p, v) (*(volatile size_t*)(p) = (v))
+HMAP__UNUSED static void* hmapc__loadptr(void* const volatile* p)
+{
+	void* v = *p;
+	HMAPC__FENCEACQ();
+	return v;
+}
+#endif
+
+HMAP__UNUSED static ptrdiff_t hmapc__probe(struct hmapc__hdr* hdr, uint32_t key, int add, int del, size_t elem_size);
+
+/* Copies values into the table with word (or smaller) stores which readers can load at the same time */
+HMAP__UNUSED static void hmapc__storevals(char* dst, const char* src, size_t size)
+{
+	size_t i, w;
+	uint32_t k;
+	if (!(((size_t)dst | (size_t)src | size) & (sizeof(size_t) - 1)))
+		for (i = 0; i != size; i += sizeof(size_t)) { memcpy(&w, src + i, sizeof(size_t)); HMAPC__STOREWORD((size_t*)(dst + i), w); }
+	else if (!(((size_t)dst | (size_t)src | size) & 3))
+		for (i = 0; i != size; i += 4) { memcpy(&k, src + i, 4); HMAPC__STOREKEY((uint32_t*)(dst + i), k); }
+	else
+		for (i = 0; i != size; i++) HMAPC__STOREBYTE((unsigned char*)(dst + i), (unsigned char)src[i]);
+}
+
+/* Copies a value out of the table for a reader with the same word size as hmapc__storevals */
+HMAP__UNUSED static void hmapc__loadvals(char* dst, const char* src, size_t size)
+{
+	size_t i, w;
+	uint32_t k;
+	if (!(((size_t)dst | (size_t)src | size) & (sizeof(size_t) - 1)))
+		for (i = 0; i != size; i += sizeof(size_t)) { w = HMAPC__LOADSEQ((const size_t*)(src + i)); memcpy(dst + i, &w, sizeof(size_t)); }
+	else if (!(((size_t)dst | (size_t)src | size) & 3))
+		for (i = 0; i != size; i += 4) { k = HMAPC__LOADKEY((const uint32_t*)(src + i)); memcpy(dst + i, &k, 4); }
+	else
+		for (i = 0; i != size; i++) dst[i] = (char)HMAPC__LOADBYTE((const unsigned char*)(src + i));
+}
+
+HMAP__UNUSED static void hmapc__setloadfactor(struct hmapc__hdr* hdr, double lf)
+{
+	hdr->loadfactor = (lf < 0.0625 ? 16 : (lf > 0.9375 ? 240 : (size_t)(lf * 256 + 0.5)));
+	hdr->maxload = HMAP__MAXLOAD(hdr->maxlen, hdr->loadfactor);
+}
+
+HMAP__UNUSED static void* hmapc__grow(struct hmapc__hdr *old_hdr, void* old_ptr, size_t elem_size, size_t reserve)
+{
+	struct hmapc__hdr *new_hdr;
+	char *mem, *new_vals;
+	size_t new_max = (old_ptr ? old_hdr->maxlen * 2 + 1 : 15), lf = (old_ptr ? old_hdr->loadfactor : 128);
+	if (old_ptr && reserve < old_hdr->len) reserve = old_hdr->len;
+	while (new_max && HMAP__MAXLOAD(new_max, lf) <= reserve)
+		if (!(new_max = new_max * 2 + 1))
+			return old_ptr; /* overflow */
+	if (new_max > ((size_t)-1 - HMAPC__ALIGN - sizeof(struct hmapc__hdr)) / (sizeof(uint32_t) + elem_size) - 2)
+		return old_ptr; /* overflow */
+
+	/* one allocation with the aligned keys array followed by the header, the null value, the values and the scratch value */
+	mem = (char *)TINYHASHMAP_MALLOC(NULL, HMAPC__ALIGN - 1 + (new_max + 1) * sizeof(uint32_t) + sizeof(struct hmapc__hdr) + (new_max + 3) * elem_size);
+	if (!mem)
+		return old_ptr; /* out of memory */
+	new_hdr = (struct hmapc__hdr *)(mem + ((HMAPC__ALIGN - (size_t)mem) & (HMAPC__ALIGN - 1)) + (new_max + 1) * sizeof(uint32_t));
+
+	new_hdr->len = 0;
+	new_hdr->maxlen = new_max;
+	new_hdr->maxload = HMAP__MAXLOAD(new_max, lf);
+	new_hdr->loadfactor = lf;
+	new_hdr->keys = (uint32_t *)new_hdr - (new_max + 1);
+	memset(new_hdr->keys, 0, (new_max + 1) * sizeof(uint32_t));
+	new_hdr->mem = mem;
+	new_hdr->allocctx = NULL;
+	new_hdr->seq = 0;
+
+	new_vals = ((char*)(new_hdr + 1)) + elem_size;
+	if (old_ptr)
+	{
+		size_t i;
+		char* old_vals = ((char*)(old_hdr + 1)) + elem_size;
+		memcpy(new_vals - elem_size, old_vals - elem_size, elem_size);
+		new_hdr->seed = old_hdr->seed; /* home slots stay the same */
+		for (i = 0; i <= old_hdr->maxlen; i++)
+		{
+			ptrdiff_t j;
+			if (!old_hdr->keys[i])
+				continue;
+			j = hmapc__probe(new_hdr, old_hdr->keys[i], 1, 0, elem_size);
+			memcpy(new_vals + j * elem_size, old_vals + i * elem_size, elem_size);
+		}
+		/* readers can still be using the old table, it gets freed by hmapc__reclaim */
+		new_hdr->retired = old_hdr;
+		new_hdr->gen = old_hdr->gen + 1;
+	}
+	else
+	{
+		memset(new_vals - elem_size, 0, elem_size);
+		new_hdr->seed = (HMAP__U64)(TINYHASHMAP_SEED(mem));
+		new_hdr->retired = NULL;
+		new_hdr->gen = 1;
+	}
+	return new_vals;
+}
+
+/* Makes a new table visible to readers after all its contents */
+HMAP__UNUSED static void* hmapc__publish(void** pb, void* new_ptr)
+{
+	if (*pb != new_ptr)
+		HMAPC__STOREPTR(pb, new_ptr);
+	return new_ptr;
+}
+
+/* The sequence number is odd while the writer changes the table */
+HMAP__UNUSED static void hmapc__begin(struct hmapc__hdr* hdr)
+{
+	HMAPC__STORESEQ(&hdr->seq, hdr->seq + 1);
+	HMAPC__FENCEREL();
+}
+
+HMAP__UNUSED static void hmapc__end(struct hmapc__hdr* hdr)
+{
+	HMAPC__FENCEREL();
+	HMAPC__STORESEQ(&hdr->seq, hdr->seq + 1);
+}
+
+/* Readers can load keys and values while the writer changes them, so all changes are word stores (hmapc__storevals) */
+HMAP__UNUSED static ptrdiff_t hmapc__probe(struct hmapc__hdr* hdr, uint32_t key, int add, int del, size_t elem_size)
+{
+	uint32_t i, home, k, *keys = hdr->keys;
+	char* vals = ((char*)(hdr + 1)) + elem_size;
+
+	if (!key)
+		return (ptrdiff_t)-1;
+
+	for (i = home = HMAPC__HOME(hdr, key);; i++)
+	{
+		if ((k = keys[i &= hdr->maxlen]) == key)
+		{
+			if (del)
+			{
+				/* move the following keys which are not in their home slot one slot back */
+				uint32_t s = i, n;
+				while ((k = keys[n = (s + 1) & hdr->maxlen]) != 0 && n != HMAPC__HOME(hdr, k))
+				{
+					HMAPC__STOREKEY(keys + s, k);
+					hmapc__storevals(vals + s * elem_size, vals + n * elem_size, elem_size);
+					s = n;
+				}
+				HMAPC__STOREKEY(keys + s, 0);
+				hdr->len--;
+			}
+			return (ptrdiff_t)i;
+		}
+		/* keys are ordered by distance from their home slot, stop at an empty slot or a key closer to home */
+		if (!k || ((i - HMAPC__HOME(hdr, k)) & hdr->maxlen) < ((i - home) & hdr->maxlen))
+		{
+			if (!add)
+				return (ptrdiff_t)-1;
+			if (k)
+			{
+				/* move all keys up to the next empty slot one slot further to make room, starting with the last */
+				uint32_t e = i, p;
+				while (keys[e = (e + 1) & hdr->maxlen]) {}
+				for (; e != i; e = p)
+				{
+					p = (e - 1) & hdr->maxlen;
+					HMAPC__STOREKEY(keys + e, keys[p]);
+					hmapc__storevals(vals + e * elem_size, vals + p * elem_size, elem_size);
+				}
+			}
+			hdr->len++;
+			HMAPC__STOREKEY(keys + i, key);
+			return (ptrdiff_t)i;
+		}
+	}
+}
+
+/* Sets the key to the scratch value (the null value for key 0) */
+HMAP__UNUSED static void hmapc__set(struct hmapc__hdr* hdr, uint32_t key, size_t elem_size)
+{
+	char* vals = ((char*)(hdr + 1)) + elem_size;
+	ptrdiff_t i = hmapc__probe(hdr, key, 1, 0, elem_size);
+	hmapc__storevals(vals + i * (ptrdiff_t)elem_size, vals + (hdr->maxlen + 1) * elem_size, elem_size);
+}
+
+HMAP__UNUSED static void hmapc__clear(struct hmapc__hdr* hdr)
+{
+	size_t i;
+	for (i = 0; i <= hdr->maxlen; i++)
+		if (hdr->keys[i])
+			HMAPC__STOREKEY(hdr->keys + i, 0);
+	hdr->len = 0;
+}
+
+HMAP__UNUSED static int hmapc__del(struct hmapc__hdr* hdr, uint32_t key, size_t elem_size)
+{
+	ptrdiff_t i;
+	if (hmapc__probe(hdr, key, 0, 0, elem_size) == -1)
+		return 0; /* nothing to change, readers don't need to retry */
+	hmapc__begin(hdr);
+	i = hmapc__probe(hdr, key, 0, 1, elem_size);
+	hmapc__end(hdr);
+	return (i != -1);
+}
+
+/* Lookup for readers, copies the value (or the null value) to out if not NULL and retries if the writer changed the table meanwhile */
+HMAP__UNUSED static int hmapc__get(void* const* pb, uint32_t key, void* out, size_t elem_size)
+{
+	for (;;)
+	{
+		const char* b = (const char*)HMAPC__LOADPTR(pb);
+		const struct hmapc__hdr* hdr;
+		const uint32_t* keys;
+		size_t seq, mask, i, n;
+		ptrdiff_t found = -1;
+		if (!b)
+		{
+			if (out) memset(out, 0, elem_size);
+			return 0;
+		}
+		hdr = (const struct hmapc__hdr*)(b - elem_size) - 1;
+		keys = hdr->keys;
+		mask = hdr->maxlen;
+		if ((seq = HMAPC__LOADSEQ(&hdr->seq)) & 1)
+			continue; /* writer is busy */
+		HMAPC__FENCEACQ();
+		if (key)
+		{
+			/* a table being modified can be inconsistent, so the probe is limited to the table size */
+			size_t home = HMAPC__HOME(hdr, key);
+			for (i = home, n = 0; n <= mask; i = (i + 1) & mask, n++)
+			{
+				uint32_t k = HMAPC__LOADKEY(keys + i);
+				if (k == key) { found = (ptrdiff_t)i; break; }
+				if (!k || ((i - HMAPC__HOME(hdr, k)) & mask) < ((i - home) & mask)) break;
+			}
+		}
+		if (out)
+			hmapc__loadvals((char*)out, b + found * (ptrdiff_t)elem_size, elem_size);
+		HMAPC__FENCEACQ();
+		if (HMAPC__LOADSEQ(&hdr->seq) == seq)
+			return (found != -1);
+	}
+}
+
+HMAP__UNUSED static size_t hmapc__gen(void* const* pb, size_t elem_size)
+{
+	const char* b = (const char*)HMAPC__LOADPTR(pb);
+	return (b ? ((const struct hmapc__hdr*)(b - elem_size) - 1)->gen : 0);
+}
+
+HMAP__UNUSED static size_t hmapc__retired(struct hmapc__hdr* hdr)
+{
+	size_t n = 0;
+	for (hdr = hdr->retired; hdr; hdr = hdr->retired) n++;
+	return n;
+}
+
+/* Frees the old tables which were replaced at generation min_gen or before, newer ones are first in the list */
+HMAP__UNUSED static size_t hmapc__reclaim(struct hmapc__hdr* hdr, size_t min_gen)
+{
+	struct hmapc__hdr **link = &hdr->retired, *old;
+	size_t n = 0;
+	while (*link && (*link)->gen + 1 > min_gen)
+		link = &(*link)->retired;
+	for (old = *link, *link = NULL; old; n++)
+	{
+		struct hmapc__hdr* next = old->retired;
+		TINYHASHMAP_FREE(NULL, old->mem);
+		old = next;
+	}
+	return n;
+}
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#endif
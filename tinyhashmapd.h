@@ -0,0 +1,231 @@
+/* TinyHashMapD - insertion ordered hash map - public domain - Bernhard Schelling 2020
+   https://github.com/schellingb/c-data-structures
+         no warranty implied; use at your own risk
+
+   This file implements a hash map with 32-bit keys which keeps its
+   keys and values in dense arrays in insertion order, like the compact
+   dict of CPython. The hash table is a TinyHashMap which only stores
+   the position of each key in the dense arrays.
+
+   The map is a pointer to the dense values so iterating touches only
+   the entries themselves (in insertion order) and values are not
+   duplicated into a table twice the size. This uses less memory than
+   TinyHashMap for larger value types. Lookups cost one extra memory
+   access from the table to the dense arrays.
+   Deleting leaves a hole (key 0) so positions stay valid while
+   iterating, holes get squeezed out when the map needs to grow or with
+   HMAPD_COMPACT. Can be used in C++ with POD types.
+
+   Be careful not to supply modifying statements to the macro arguments.
+   Something like HMAPD_SET(map, i++, val); would have unintended results.
+
+   Sample usage:
+
+   -- Set elements with string keys and mytype_t values:
+   mytype_t* map = NULL;
+   HMAPD_SET_STR(map, "foo", foo_element);
+   HMAPD_SET_STR(map, "bar", bar_element);
+   -- now HMAPD_LEN(map) == 2, map[0] == foo_element, map[1] == bar_element
+   -- _GET/_HAS/_DEL/_PTR/_IDX exist for _STR, _BYTES and custom hash keys
+   -- like in TinyHashMap. Setting an existing key keeps its position.
+   -- The key 0 is not allowed (it marks the holes of deleted keys)
+
+   -- Iterate elements in insertion order:
+   for (size_t i = 0; i != HMAPD_END(map); i++)
+     if (HMAPD_KEY(map, i))
+   ------ here map[i] is the value of key HMAPD_KEY(map, i)
+   -- HMAPD_END(map) is HMAPD_LEN(map) plus the holes of deleted keys
+   -- Deleting during iteration is fine, adding is not
+
+   -- Squeeze out holes (positions of later keys move down):
+   HMAPD_COMPACT(map);
+   -- now HMAPD_END(map) == HMAPD_LEN(map)
+
+   -- Also like TinyHashMap:
+   HMAPD_CAP(map), HMAPD_CLEAR(map), HMAPD_FIT(map, 30),
+   HMAPD_SETNULLVAL(map, map_null), HMAPD_FREE(map),
+   bool ran_out_of_memory = !HMAPD_TRYFIT(map, 1000);
+
+   PUBLIC DOMAIN (UNLICENSE)
+
+   This is free and unencumbered software released into the public domain.
+
+   Anyone is free to copy, modify, publish, use, compile, sell, or
+   distribute this software, either in source code form or as a compiled
+   binary, for any purpose, commercial or non-commercial, and by any
+   means.
+
+   In jurisdictions that recognize copyright laws, the author or authors
+   of this software dedicate any and all copyright interest in the
+   software to the public domain. We make this dedication for the benefit
+   of the public at large and to the detriment of our heirs and
+   successors. We intend this dedication to be an overt act of
+   relinquishment in perpetuity of all present and future rights to this
+   software under copyright law.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+   OTHER DEALINGS IN THE SOFTWARE.
+
+   For more information, please refer to <http://unlicense.org/>
+*/
+
+#ifndef TINYHASHMAPD_H
+#define TINYHASHMAPD_H
+
+#include "tinyhashmap.h"
+
+#define HMAPD_LEN(b) ((b) ? HMAPD__HDR(b)->len : 0)
+#define HMAPD_END(b) ((b) ? HMAPD__HDR(b)->end : 0)
+#define HMAPD_CAP(b) ((b) ? HMAPD__HDR(b)->cap : 0)
+#define HMAPD_KEY(b, idx) (HMAPD__HDR(b)->keys[idx])
+#define HMAPD_SETNULLVAL(b, val) (HMAPD__FIT0(b), (b)[-1] = (val))
+#define HMAPD_CLEAR(b) ((b) ? (HMAP_CLEAR(HMAPD__HDR(b)->index), HMAPD__HDR(b)->len = HMAPD__HDR(b)->end = 0) : 0)
+#define HMAPD_FREE(b) ((b) ? (HMAP_FREE(HMAPD__HDR(b)->index), TINYHASHMAP_FREE(NULL, HMAPD__HDR(b)), (b) = NULL) : 0)
+#define HMAPD_FIT(b, n) ((!(n) || ((b) && (size_t)(n) <= HMAPD__HDR(b)->cap)) ? 0 : HMAPD__GROW(b, n))
+#define HMAPD_TRYFIT(b, n) (HMAPD_FIT((b), (n)), (!(n) || ((b) && (size_t)(n) <= HMAPD__HDR(b)->cap && HMAP_TRYFIT(HMAPD__HDR(b)->index, (n)))))
+#define HMAPD_COMPACT(b) ((b) ? (hmapd__compact(HMAPD__HDR(b), sizeof(*(b))), 0) : 0)
+
+#define HMAPD_SET(b, key, val) (HMAPD__FIT1(b), (b)[hmapd__idx(HMAPD__HDR(b), (key), 1, 0, sizeof(*(b)))] = (val))
+#define HMAPD_GET(b, key) (HMAPD__FIT0(b), (b)[hmapd__idx(HMAPD__HDR(b), (key), 0, 0, sizeof(*(b)))])
+#define HMAPD_HAS(b, key) ((b) ? hmapd__idx(HMAPD__HDR(b), (key), 0, 0, sizeof(*(b))) != -1 : 0)
+#define HMAPD_DEL(b, key) ((b) ? hmapd__idx(HMAPD__HDR(b), (key), 0, 1, sizeof(*(b))) != -1 : 0)
+#define HMAPD_PTR(b, key) (HMAPD__FIT1(b), &(b)[hmapd__idx(HMAPD__HDR(b), (key), 1, 0, sizeof(*(b)))])
+#define HMAPD_IDX(b, key) ((b) ? hmapd__idx(HMAPD__HDR(b), (key), 0, 0, sizeof(*(b))) : -1)
+
+#define HMAPD_SET_STR(b, string_key, val) HMAPD_SET(b, hash_string(string_key), val)
+#define HMAPD_GET_STR(b, string_key)      HMAPD_GET(b, hash_string(string_key))
+#define HMAPD_HAS_STR(b, string_key)      HMAPD_HAS(b, hash_string(string_key))
+#define HMAPD_DEL_STR(b, string_key)      HMAPD_DEL(b, hash_string(string_key))
+#define HMAPD_PTR_STR(b, string_key)      HMAPD_PTR(b, hash_string(string_key))
+#define HMAPD_IDX_STR(b, string_key)      HMAPD_IDX(b, hash_string(string_key))
+#define HMAPD_SET_BYTES(b, ptr, len, val) HMAPD_SET(b, hash_bytes(ptr, len), val)
+#define HMAPD_GET_BYTES(b, ptr, len)      HMAPD_GET(b, hash_bytes(ptr, len))
+#define HMAPD_HAS_BYTES(b, ptr, len)      HMAPD_HAS(b, hash_bytes(ptr, len))
+#define HMAPD_DEL_BYTES(b, ptr, len)      HMAPD_DEL(b, hash_bytes(ptr, len))
+#define HMAPD_PTR_BYTES(b, ptr, len)      HMAPD_PTR(b, hash_bytes(ptr, len))
+#define HMAPD_IDX_BYTES(b, ptr, len)      HMAPD_IDX(b, hash_bytes(ptr, len))
+
+/* One allocation with the header, the null value, the values and the keys, index maps each key to its position */
+struct hmapd__hdr { size_t len, end, cap; uint32_t *keys, *index; void *pad; }; /* pad keeps values aligned to two size_t */
+#define HMAPD__HDR(b) (((struct hmapd__hdr *)&(b)[-1])-1)
+#define HMAPD__KEYSOFS(cap, elem_size) ((sizeof(struct hmapd__hdr) + ((cap) + 1) * (elem_size) + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1))
+#define HMAPD__GROW(b, n) (*(void**)(&(b)) = hmapd__grow(HMAPD__HDR(b), (void*)(b), sizeof(*(b)), (size_t)(n)))
+#define HMAPD__FIT1(b) ((b) && HMAPD__HDR(b)->end < HMAPD__HDR(b)->cap ? 0 : HMAPD__GROW(b, 0))
+#define HMAPD__FIT0(b) ((b) ? 0 : HMAPD__GROW(b, 0))
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable:4505) //unreferenced local function has been removed
+#endif
+
+/* Moves the entries after holes down and updates their positions in the index */
+HMAP__UNUSED static void hmapd__compact(struct hmapd__hdr* hdr, size_t elem_size)
+{
+	char* vals = ((char*)(hdr + 1)) + elem_size;
+	size_t i, j;
+	for (i = j = 0; i != hdr->end; i++)
+	{
+		if (!hdr->keys[i])
+			continue;
+		if (i != j)
+		{
+			hdr->keys[j] = hdr->keys[i];
+			memcpy(vals + j * elem_size, vals + i * elem_size, elem_size);
+			HMAP_SET(hdr->index, hdr->keys[j], (uint32_t)j);
+		}
+		j++;
+	}
+	hdr->end = j;
+}
+
+/* Makes room for reserve or at least one more entry, when a quarter of the entries are holes they get squeezed out instead of growing */
+HMAP__UNUSED static void* hmapd__grow(struct hmapd__hdr* hdr, void* ptr, size_t elem_size, size_t reserve)
+{
+	struct hmapd__hdr* new_hdr;
+	size_t i, j, new_cap = (ptr ? hdr->cap * 2 : 16);
+	char *vals = (char*)ptr, *new_vals;
+	if (ptr && reserve <= hdr->len) reserve = hdr->len + 1;
+	if (ptr && reserve <= hdr->cap && hdr->end - hdr->len >= hdr->cap / 4)
+	{
+		hmapd__compact(hdr, elem_size);
+		return ptr;
+	}
+	while (new_cap < reserve)
+	{
+		if (new_cap > ((size_t)-1 >> 1))
+			return ptr; /* overflow */
+		new_cap *= 2;
+	}
+	if ((HMAP__U64)new_cap > 0xFFFFFFFF || new_cap > ((size_t)-1 - sizeof(struct hmapd__hdr) - 2 * sizeof(uint32_t)) / (elem_size + sizeof(uint32_t)) - 1)
+		return ptr; /* positions are stored as 32-bit or overflow */
+
+	new_hdr = (struct hmapd__hdr *)TINYHASHMAP_MALLOC(NULL, HMAPD__KEYSOFS(new_cap, elem_size) + new_cap * sizeof(uint32_t));
+	if (!new_hdr)
+		return ptr; /* out of memory */
+	new_vals = ((char*)(new_hdr + 1)) + elem_size;
+	new_hdr->cap = new_cap;
+	new_hdr->keys = (uint32_t *)((char*)new_hdr + HMAPD__KEYSOFS(new_cap, elem_size));
+	if (!ptr)
+	{
+		new_hdr->len = new_hdr->end = 0;
+		new_hdr->index = NULL;
+		memset(new_vals - elem_size, 0, elem_size);
+		HMAP_FIT(new_hdr->index, reserve);
+		return new_vals;
+	}
+
+	/* copy the entries over without the holes */
+	new_hdr->len = hdr->len;
+	new_hdr->index = hdr->index;
+	memcpy(new_vals - elem_size, vals - elem_size, elem_size);
+	for (i = j = 0; i != hdr->end; i++)
+	{
+		if (!hdr->keys[i])
+			continue;
+		new_hdr->keys[j] = hdr->keys[i];
+		memcpy(new_vals + j * elem_size, vals + i * elem_size, elem_size);
+		if (i != j)
+			HMAP_SET(new_hdr->index, hdr->keys[i], (uint32_t)j);
+		j++;
+	}
+	new_hdr->end = j;
+	HMAP_FIT(new_hdr->index, reserve);
+	TINYHASHMAP_FREE(NULL, hdr);
+	return new_vals;
+}
+
+HMAP__UNUSED static ptrdiff_t hmapd__idx(struct hmapd__hdr* hdr, uint32_t key, int add, int del, size_t elem_size)
+{
+	ptrdiff_t i = HMAP_IDX(hdr->index, key);
+	size_t pos;
+	(void)elem_size;
+	if (i != -1)
+	{
+		pos = hdr->index[i];
+		if (del)
+		{
+			(void)HMAP_DEL(hdr->index, key);
+			hdr->keys[pos] = 0; /* leave a hole so the positions of the other keys stay */
+			hdr->len--;
+		}
+		return (ptrdiff_t)pos;
+	}
+	if (!add || !key || hdr->end == hdr->cap || !HMAP_TRYFIT(hdr->index, HMAP_LEN(hdr->index) + 1))
+		return -1; /* not found, key 0 (marks holes) or out of memory (setting goes to the null value) */
+	pos = hdr->end++;
+	hdr->keys[pos] = key;
+	HMAP_SET(hdr->index, key, (uint32_t)pos);
+	hdr->len++;
+	return (ptrdiff_t)pos;
+}
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#endif
@@ -0,0 +1,385 @@
+/* TinyHashMapS - hash map with full byte string keys - public domain - Bernhard Schelling 2020
+   https://github.com/schellingb/c-data-structures
+         no warranty implied; use at your own risk
+
+   This file implements a hash map with byte string keys that are
+   compared in full, so different keys never alias like they can with
+   the hashed keys of TinyHashMap (HMAP_SET_STR and friends).
+   Each slot stores a pointer and length of its key together with the
+   cached 32-bit hash (wyhash). A lookup compares the hash first and
+   confirms a hit with memcmp. Key memory is not copied, it needs to stay
+   valid while the key is in the map (string literals, an interning arena).
+
+   Works like TinyHashMap but every key is passed as data and length.
+   By default allocates memory for twice the amount of max elements
+   so larger structs should be stored as pointers or indices to an array.
+   Collisions are resolved with linear probing in Robin Hood order.
+   Can be used in C++ with POD types (without any constructor/destructor).
+
+   Be careful not to supply modifying statements to the macro arguments.
+   Something like HMAPS_FIT(map, i++); would have unintended results.
+
+   Sample usage:
+
+   -- Set 2 elements with string keys and mytype_t values:
+   mytype_t* map = NULL;
+   HMAPS_SET_STR(map, "foo", foo_element);
+   HMAPS_SET(map, "bar", 3, bar_element);
+   -- now HMAPS_LEN(map) == 2, HMAPS_GET_STR(map, "foo") == foo_element
+
+   -- Check if keys exist:
+   bool has_foo = HMAPS_HAS_STR(map, "foo");
+   bool has_baz = HMAPS_HAS(map, "bazinga", 3);
+   -- now has_foo == true, has_baz == false
+
+   -- Removing a key:
+   bool removed = HMAPS_DEL_STR(map, "bar");
+   bool removed_again = HMAPS_DEL_STR(map, "bar");
+   -- now HMAPS_LEN(map) == 1, removed == true, removed_again == false
+
+   -- Add/modify via pointer:
+   mytype_t* p_elem = HMAPS_PTR_STR(map, "qux");
+   p_elem->a = 123;
+   -- New keys initially have memory uninitialized
+   -- Pointers can get invalidated when a key is added/removed
+
+   -- Looking up the index for a given key:
+   ptrdiff_t idx_foo = HMAPS_IDX_STR(map, "foo");
+   ptrdiff_t idx_invalid = HMAPS_IDX_STR(map, "invalid");
+   -- now idx_foo >= 0, idx_invalid == -1, map[idx_foo] == foo_element
+   -- Indices can change when a key is added/removed
+
+   -- Iterate elements (random order, order can change on insert):
+   for (size_t i = 0, cap = HMAPS_CAP(map); i != cap, i++)
+     if (HMAPS_KEY(map, i))
+   ------ here map[i] is the value of the HMAPS_KEYLEN(map, i) bytes at HMAPS_KEY(map, i)
+
+   -- Clear all elements, reserve memory, set the load factor, set the
+   -- null value, free and handle running out of memory:
+   HMAPS_CLEAR(map);
+   HMAPS_FIT(map, 30);
+   HMAPS_SETLOADFACTOR(map, 0.875);
+   HMAPS_SETNULLVAL(map, map_null);
+   HMAPS_FREE(map);
+   bool ran_out_of_memory = !HMAPS_TRYFIT(map, 1000);
+   -- all work the same as with TinyHashMap
+
+   -- Use a custom allocator (for example an arena):
+   #define TINYHASHMAP_MALLOC(ctx, size) my_malloc(ctx, size)
+   #define TINYHASHMAP_FREE(ctx, ptr) my_free(ctx, ptr)
+   -- before including this file, then per map:
+   HMAPS_SETALLOC(map, my_arena);
+   -- now all memory of map comes from my_arena (ctx is NULL by default)
+
+   PUBLIC DOMAIN (UNLICENSE)
+
+   This is free and unencumbered software released into the public domain.
+
+   Anyone is free to copy, modify, publish, use, compile, sell, or
+   distribute this software, either in source code form or as a compiled
+   binary, for any purpose, commercial or non-commercial, and by any
+   means.
+
+   In jurisdictions that recognize copyright laws, the author or authors
+   of this software dedicate any and all copyright interest in the
+   software to the public domain. We make this dedication for the benefit
+   of the public at large and to the detriment of our heirs and
+   successors. We intend this dedication to be an overt act of
+   relinquishment in perpetuity of all present and future rights to this
+   software under copyright law.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+   OTHER DEALINGS IN THE SOFTWARE.
+
+   For more information, please refer to <http://unlicense.org/>
+*/
+
+#ifndef TINYHASHMAPS_H
+#define TINYHASHMAPS_H
+
+#include <stdlib.h> /* for malloc, free */
+#include <string.h> /* for memcpy, memcmp, memmove, memset, strlen */
+#include <stddef.h> /* for ptrdiff_t, size_t */
+#if defined(_MSC_VER) && (_MSC_VER < 1600)
+typedef unsigned __int32 uint32_t;
+#else
+#include <stdint.h> /* for uint32_t */
+#endif
+
+#ifndef TINYHASHMAP_MALLOC
+#define TINYHASHMAP_MALLOC(ctx, size) malloc(size)
+#define TINYHASHMAP_FREE(ctx, ptr) free(ptr)
+#endif
+
+#define HMAPS_LEN(b) ((b) ? HMAPS__HDR(b)->len : 0)
+#define HMAPS_MAX(b) ((b) ? HMAPS__HDR(b)->maxlen : 0)
+#define HMAPS_CAP(b) ((b) ? HMAPS__HDR(b)->maxlen + 1 : 0)
+#define HMAPS_KEY(b, idx) (HMAPS__HDR(b)->skeys[idx].ptr)
+#define HMAPS_KEYLEN(b, idx) (HMAPS__HDR(b)->skeys[idx].len)
+#define HMAPS_SETNULLVAL(b, val) (HMAPS__FIT1(b), b[-1] = (val))
+#define HMAPS_CLEAR(b) ((b) ? (memset(HMAPS__HDR(b)->keys, 0, HMAPS_CAP(b) * (sizeof(uint32_t) + sizeof(struct hmaps__key))), HMAPS__HDR(b)->len = 0) : 0)
+#define HMAPS_FREE(b) ((b) ? (TINYHASHMAP_FREE(HMAPS__HDR(b)->allocctx, HMAPS__HDR(b)->mem), (b) = NULL) : 0)
+#define HMAPS_FIT(b, n) ((!(n) || ((b) && (size_t)(n) <= HMAPS__HDR(b)->maxload)) ? 0 : HMAPS__GROW(b, n))
+#define HMAPS_TRYFIT(b, n) (HMAPS_FIT((b), (n)), (!(n) || ((b) && (size_t)(n) <= HMAPS__HDR(b)->maxload)))
+#define HMAPS_SETLOADFACTOR(b, lf) (HMAPS__FIT1(b), hmaps__setloadfactor(HMAPS__HDR(b), (lf)))
+#define HMAPS_SETALLOC(b, ctx) ((b) && HMAPS__HDR(b)->allocctx == (ctx) ? 0 : (*(void**)(&(b)) = hmaps__grow(HMAPS__HDR(b), (void*)(b), sizeof(*(b)), 0, (ctx))))
+
+#define HMAPS_SET(b, key, len, val) (HMAPS__FIT1(b), b[hmaps__idx(HMAPS__HDR(b), (key), (len), 1, 0, sizeof(*(b)))] = (val))
+#define HMAPS_GET(b, key, len) (HMAPS__FIT1(b), b[hmaps__idx(HMAPS__HDR(b), (key), (len), 0, 0, sizeof(*(b)))])
+#define HMAPS_HAS(b, key, len) ((b) ? hmaps__idx(HMAPS__HDR(b), (key), (len), 0, 0, sizeof(*(b))) != -1 : 0)
+#define HMAPS_DEL(b, key, len) ((b) ? hmaps__idx(HMAPS__HDR(b), (key), (len), 0, 1, sizeof(*(b))) != -1 : 0)
+#define HMAPS_PTR(b, key, len) (HMAPS__FIT1(b), &b[hmaps__idx(HMAPS__HDR(b), (key), (len), 1, 0, sizeof(*(b)))])
+#define HMAPS_IDX(b, key, len) ((b) ? hmaps__idx(HMAPS__HDR(b), (key), (len), 0, 0, sizeof(*(b))) : -1)
+
+#define HMAPS_SET_STR(b, string_key, val) HMAPS_SET(b, string_key, strlen(string_key), val)
+#define HMAPS_GET_STR(b, string_key)      HMAPS_GET(b, string_key, strlen(string_key))
+#define HMAPS_HAS_STR(b, string_key)      HMAPS_HAS(b, string_key, strlen(string_key))
+#define HMAPS_DEL_STR(b, string_key)      HMAPS_DEL(b, string_key, strlen(string_key))
+#define HMAPS_PTR_STR(b, string_key)      HMAPS_PTR(b, string_key, strlen(string_key))
+#define HMAPS_IDX_STR(b, string_key)      HMAPS_IDX(b, string_key, strlen(string_key))
+
+#ifdef __GNUC__
+#define HMAP__UNUSED __attribute__((__unused__))
+#else
+#define HMAP__UNUSED
+#endif
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable:4505) //unreferenced local function has been removed
+#endif
+
+struct hmaps__key { const char *ptr; size_t len; };
+struct hmaps__hdr { size_t len, maxlen, maxload, loadfactor; uint32_t *keys; struct hmaps__key *skeys; void *allocctx, *mem; };
+#define HMAPS__HDR(b) (((struct hmaps__hdr *)&(b)[-1])-1)
+#define HMAPS__ALIGN 64 /* cache line alignment of the keys */
+#define HMAPS__GROW(b, n) (*(void**)(&(b)) = hmaps__grow(HMAPS__HDR(b), (void*)(b), sizeof(*(b)), (size_t)(n), ((b) ? HMAPS__HDR(b)->allocctx : NULL)))
+#define HMAPS__FIT1(b) ((b) && HMAPS_LEN(b) <= HMAPS__HDR(b)->maxload ? 0 : HMAPS__GROW(b, 0))
+#define HMAP__MAXLOAD(maxlen, lf) ((((maxlen) >> 8) * (lf)) + ((((maxlen) & 0xFF) * (lf)) >> 8)) /* lf in 1/256 steps */
+
+#ifndef HMAP__WYHASH
+#define HMAP__WYHASH
+#if defined(_MSC_VER) && (_MSC_VER < 1600)
+#define HMAP__U64 unsigned __int64
+#else
+#define HMAP__U64 uint64_t
+#endif
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h> /* for _umul128 */
+#endif
+
+/* 64x64 to 128-bit multiply, a gets the low and b the high half */
+HMAP__UNUSED static void hmap__mum(HMAP__U64* a, HMAP__U64* b)
+{
+	#if defined(__SIZEOF_INT128__)
+	__uint128_t r = (__uint128_t)*a * *b;
+	*a = (HMAP__U64)r;
+	*b = (HMAP__U64)(r >> 64);
+	#elif defined(_MSC_VER) && defined(_M_X64)
+	*a = _umul128(*a, *b, b);
+	#else
+	HMAP__U64 ha = *a >> 32, hb = *b >> 32, la = *a & 0xFFFFFFFF, lb = *b & 0xFFFFFFFF;
+	HMAP__U64 rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32), c = (t < rl);
+	HMAP__U64 lo = t + (rm1 << 32);
+	c += (lo < t);
+	*a = lo;
+	*b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+	#endif
+}
+
+HMAP__UNUSED static HMAP__U64 hmap__wymix(HMAP__U64 a, HMAP__U64 b) { hmap__mum(&a, &b); return a ^ b; }
+HMAP__UNUSED static HMAP__U64 hmap__wyr8(const unsigned char* p) { HMAP__U64 v; memcpy(&v, p, 8); return v; }
+HMAP__UNUSED static HMAP__U64 hmap__wyr4(const unsigned char* p) { unsigned int v; memcpy(&v, p, 4); return v; }
+
+/* wyhash (public domain, by Wang Yi) reads 16 or 48 bytes per round and mixes them with 128-bit multiplies */
+HMAP__UNUSED static HMAP__U64 hmap__wyhash(const void* key, size_t len)
+{
+	const HMAP__U64 s0 = (HMAP__U64)0xa0761d6478bd642f, s1 = (HMAP__U64)0xe7037ed1a0b428db, s2 = (HMAP__U64)0x8ebc6af09c88c6e3, s3 = (HMAP__U64)0x589965cc75374cc3;
+	const unsigned char* p = (const unsigned char*)key;
+	HMAP__U64 seed = hmap__wymix(s0, s1), a, b;
+	if (len <= 16)
+	{
+		if (len >= 4)
+		{
+			a = (hmap__wyr4(p) << 32) | hmap__wyr4(p + ((len >> 3) << 2));
+			b = (hmap__wyr4(p + len - 4) << 32) | hmap__wyr4(p + len - 4 - ((len >> 3) << 2));
+		}
+		else if (len)
+		{
+			a = ((HMAP__U64)p[0] << 16) | ((HMAP__U64)p[len >> 1] << 8) | p[len - 1];
+			b = 0;
+		}
+		else
+			a = b = 0;
+	}
+	else
+	{
+		size_t i = len;
+		if (i > 48)
+		{
+			HMAP__U64 see1 = seed, see2 = seed;
+			do
+			{
+				seed = hmap__wymix(hmap__wyr8(p) ^ s1, hmap__wyr8(p + 8) ^ seed);
+				see1 = hmap__wymix(hmap__wyr8(p + 16) ^ s2, hmap__wyr8(p + 24) ^ see1);
+				see2 = hmap__wymix(hmap__wyr8(p + 32) ^ s3, hmap__wyr8(p + 40) ^ see2);
+				p += 48;
+				i -= 48;
+			} while (i > 48);
+			seed ^= see1 ^ see2;
+		}
+		for (; i > 16; i -= 16, p += 16)
+			seed = hmap__wymix(hmap__wyr8(p) ^ s1, hmap__wyr8(p + 8) ^ seed);
+		a = hmap__wyr8(p + i - 16);
+		b = hmap__wyr8(p + i - 8);
+	}
+	a ^= s1;
+	b ^= seed;
+	hmap__mum(&a, &b);
+	return hmap__wymix(a ^ s0 ^ (HMAP__U64)len, b ^ s1);
+}
+#endif
+
+HMAP__UNUSED static uint32_t hmaps__hash(const void* key, size_t len)
+{
+	HMAP__U64 h = hmap__wyhash(key, len);
+	uint32_t hash = (uint32_t)(h ^ (h >> 32));
+	return (hash ? hash : 1);
+}
+
+HMAP__UNUSED static ptrdiff_t hmaps__probe(struct hmaps__hdr* hdr, uint32_t key, const void* ptr, size_t len, int add, int del, size_t elem_size);
+
+HMAP__UNUSED static void hmaps__setloadfactor(struct hmaps__hdr* hdr, double lf)
+{
+	hdr->loadfactor = (lf < 0.0625 ? 16 : (lf > 0.9375 ? 240 : (size_t)(lf * 256 + 0.5)));
+	hdr->maxload = HMAP__MAXLOAD(hdr->maxlen, hdr->loadfactor);
+}
+
+HMAP__UNUSED static void* hmaps__grow(struct hmaps__hdr *old_hdr, void* old_ptr, size_t elem_size, size_t reserve, void* ctx)
+{
+	struct hmaps__hdr *new_hdr;
+	char *mem, *new_vals;
+	size_t slot_size = sizeof(uint32_t) + sizeof(struct hmaps__key) + elem_size;
+	int move = (old_ptr && old_hdr->allocctx != ctx); /* moving to another allocator keeps the size */
+	size_t new_max = (old_ptr ? (move ? old_hdr->maxlen : old_hdr->maxlen * 2 + 1) : 15), lf = (old_ptr ? old_hdr->loadfactor : 128);
+	if (old_ptr && reserve < old_hdr->len) reserve = old_hdr->len;
+	while (new_max && HMAP__MAXLOAD(new_max, lf) <= reserve)
+		if (!(new_max = new_max * 2 + 1))
+			return old_ptr; /* overflow */
+	if (new_max > ((size_t)-1 - HMAPS__ALIGN - sizeof(struct hmaps__hdr) - elem_size) / slot_size - 1)
+		return old_ptr; /* overflow */
+
+	/* one allocation with the aligned hashes, the key pointers, the header, the null value and the values */
+	mem = (char *)TINYHASHMAP_MALLOC(ctx, HMAPS__ALIGN - 1 + (new_max + 1) * slot_size + sizeof(struct hmaps__hdr) + elem_size);
+	if (!mem)
+		return old_ptr; /* out of memory */
+	new_hdr = (struct hmaps__hdr *)(mem + ((HMAPS__ALIGN - (size_t)mem) & (HMAPS__ALIGN - 1)) + (new_max + 1) * (sizeof(uint32_t) + sizeof(struct hmaps__key)));
+
+	new_hdr->len = 0;
+	new_hdr->maxlen = new_max;
+	new_hdr->maxload = HMAP__MAXLOAD(new_max, lf);
+	new_hdr->loadfactor = lf;
+	new_hdr->skeys = (struct hmaps__key *)new_hdr - (new_max + 1);
+	new_hdr->keys = (uint32_t *)new_hdr->skeys - (new_max + 1);
+	memset(new_hdr->keys, 0, (new_max + 1) * (sizeof(uint32_t) + sizeof(struct hmaps__key)));
+	new_hdr->mem = mem;
+	new_hdr->allocctx = ctx;
+
+	new_vals = ((char*)(new_hdr + 1)) + elem_size;
+	if (old_ptr)
+	{
+		size_t i;
+		char* old_vals = ((char*)(old_hdr + 1)) + elem_size;
+		memcpy(new_vals - elem_size, old_vals - elem_size, elem_size);
+		for (i = 0; i <= old_hdr->maxlen; i++)
+		{
+			ptrdiff_t j;
+			if (!old_hdr->keys[i])
+				continue;
+			j = hmaps__probe(new_hdr, old_hdr->keys[i], old_hdr->skeys[i].ptr, old_hdr->skeys[i].len, 1, 0, elem_size);
+			memcpy(new_vals + j * elem_size, old_vals + i * elem_size, elem_size);
+		}
+		TINYHASHMAP_FREE(old_hdr->allocctx, old_hdr->mem);
+	}
+	else
+		memset(new_vals - elem_size, 0, elem_size);
+	return new_vals;
+}
+
+/* Moves n slots (hashes, key pointers and values) from index fr to index to */
+HMAP__UNUSED static void hmaps__move(struct hmaps__hdr* hdr, uint32_t to, uint32_t fr, uint32_t n, size_t elem_size)
+{
+	char* vals = ((char*)(hdr + 1)) + elem_size;
+	memmove(hdr->keys + to, hdr->keys + fr, n * sizeof(uint32_t));
+	memmove(hdr->skeys + to, hdr->skeys + fr, n * sizeof(struct hmaps__key));
+	memmove(vals + to * elem_size, vals + fr * elem_size, n * elem_size);
+}
+
+HMAP__UNUSED static ptrdiff_t hmaps__probe(struct hmaps__hdr* hdr, uint32_t key, const void* ptr, size_t len, int add, int del, size_t elem_size)
+{
+	uint32_t i, k, *keys = hdr->keys;
+	struct hmaps__key *skeys = hdr->skeys;
+
+	for (i = key & hdr->maxlen;; i++)
+	{
+		/* the full key is only compared when the cached hash matches */
+		if ((k = keys[i &= hdr->maxlen]) == key && skeys[i].len == len && !memcmp(skeys[i].ptr, ptr, len))
+		{
+			if (del)
+			{
+				/* move the following keys which are not in their home slot one slot back */
+				uint32_t s = i, n;
+				while ((k = keys[n = (s + 1) & hdr->maxlen]) != 0 && ((n - k) & hdr->maxlen))
+				{
+					hmaps__move(hdr, s, n, 1, elem_size);
+					s = n;
+				}
+				keys[s] = 0;
+				skeys[s].ptr = NULL;
+				hdr->len--;
+			}
+			return (ptrdiff_t)i;
+		}
+		/* keys are ordered by distance from their home slot, stop at an empty slot or a key closer to home */
+		/* keys with the same hash have the same distance so all of them get checked */
+		if (!k || ((i - k) & hdr->maxlen) < ((i - key) & hdr->maxlen))
+		{
+			if (!add)
+				return (ptrdiff_t)-1;
+			if (k)
+			{
+				/* move all keys up to the next empty slot one slot further to make room */
+				uint32_t e = i;
+				while (keys[e = (e + 1) & hdr->maxlen]) {}
+				if (e < i)
+				{
+					hmaps__move(hdr, 1, 0, e, elem_size);
+					hmaps__move(hdr, 0, (uint32_t)hdr->maxlen, 1, elem_size);
+					e = (uint32_t)hdr->maxlen;
+				}
+				hmaps__move(hdr, i + 1, i, e - i, elem_size);
+			}
+			hdr->len++;
+			keys[i] = key;
+			skeys[i].ptr = (const char*)ptr;
+			skeys[i].len = len;
+			return (ptrdiff_t)i;
+		}
+	}
+}
+
+HMAP__UNUSED static ptrdiff_t hmaps__idx(struct hmaps__hdr* hdr, const void* ptr, size_t len, int add, int del, size_t elem_size)
+{
+	return hmaps__probe(hdr, hmaps__hash(ptr, len), ptr, len, add, del, elem_size);
+}
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#endif
@@ -0,0 +1,214 @@
+/* TinyHashMapSH - sharded concurrent hash map - public domain - Bernhard Schelling 2020
+   https://github.com/schellingb/c-data-structures
+         no warranty implied; use at your own risk
+
+   This file implements a hash map with 64-bit keys for many threads
+   writing at the same time. It is split into shards, each one an
+   independent TinyHashMap64 table with its own spinlock. The shard of
+   a key is picked from its high bits (the tables use the low bits)
+   so threads working on different keys rarely wait for each other.
+   Each shard table pointer and lock have their own cache line.
+
+   The map is an array of typed TinyHashMap64 pointers, so all HMAP64_
+   macros can be used on a shard while holding its lock.
+   Locks spin, so keep the work done while holding one short.
+   Needs GCC/Clang atomic builtins or MSVC.
+
+   Be careful not to supply modifying statements to the macro arguments.
+   Something like HMAPSH_SET(map, i++, val); would have unintended results.
+
+   Sample usage:
+
+   -- Create with 64 shards (rounded up to a power of 2) before sharing it:
+   mytype_t** map = NULL;
+   HMAPSH_INIT(map, 64);
+
+   -- From any thread:
+   HMAPSH_SET(map, my_uint64_hash(key1), some_element);
+   bool found = HMAPSH_GET(map, my_uint64_hash(key1), &elem);
+   bool has_key = HMAPSH_HAS(map, my_uint64_hash(key2));
+   bool removed = HMAPSH_DEL(map, my_uint64_hash(key2));
+   -- now elem == some_element (or the null value if not found)
+
+   -- Modify in place while holding the lock of the key's shard:
+   HMAPSH_LOCK(map, key);
+   HMAP64_PTR(HMAPSH_SHARD(map, key), key)->count++;
+   HMAPSH_UNLOCK(map, key);
+   -- HMAPSH_SHARD(map, key) is the TinyHashMap64 the key belongs to
+
+   -- Count and iterate elements of all shards:
+   size_t len = HMAPSH_LEN(map);
+   for (size_t s = 0; s != HMAPSH_SHARDS(map); s++)
+   {
+     HMAPSH_LOCKAT(map, s);
+     for (size_t i = 0, cap = HMAP64_CAP(HMAPSH_AT(map, s)); i != cap, i++)
+       if (HMAP64_KEY(HMAPSH_AT(map, s), i))
+   ------ here HMAPSH_AT(map, s)[i] is the value of key HMAP64_KEY(HMAPSH_AT(map, s), i)
+     HMAPSH_UNLOCKAT(map, s);
+   }
+
+   -- Free all memory (no other thread may use the map anymore):
+   HMAPSH_FREE(map);
+   -- now map == NULL
+
+   PUBLIC DOMAIN (UNLICENSE)
+
+   This is free and unencumbered software released into the public domain.
+
+   Anyone is free to copy, modify, publish, use, compile, sell, or
+   distribute this software, either in source code form or as a compiled
+   binary, for any purpose, commercial or non-commercial, and by any
+   means.
+
+   In jurisdictions that recognize copyright laws, the author or authors
+   of this software dedicate any and all copyright interest in the
+   software to the public domain. We make this dedication for the benefit
+   of the public at large and to the detriment of our heirs and
+   successors. We intend this dedication to be an overt act of
+   relinquishment in perpetuity of all present and future rights to this
+   software under copyright law.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+   OTHER DEALINGS IN THE SOFTWARE.
+
+   For more information, please refer to <http://unlicense.org/>
+*/
+
+#ifndef TINYHASHMAPSH_H
+#define TINYHASHMAPSH_H
+
+#include "tinyhashmap64.h"
+#if !defined(__GNUC__) && defined(_MSC_VER)
+#include <intrin.h> /* for _InterlockedExchange, _mm_pause */
+#elif !defined(__GNUC__)
+#error TinyHashMapSH needs GCC/Clang atomic builtins or MSVC
+#endif
+
+#define HMAPSH_INIT(b, shards) (HMAPSH_FREE(b), *(void**)(&(b)) = hmapsh__init((size_t)(shards)))
+#define HMAPSH_FREE(b) ((b) ? (hmapsh__free((void**)(b), sizeof(**(b))), (b) = NULL) : 0)
+#define HMAPSH_SHARDS(b) ((b) ? HMAPSH__HDR(b)->count : 0)
+#define HMAPSH_IDX(b, key) ((size_t)((uint64_t)(key) >> HMAPSH__HDR(b)->shift))
+#define HMAPSH_AT(b, s) (b)[(s) * HMAPSH__STRIDE]
+#define HMAPSH_LOCKAT(b, s) hmapsh__lock(HMAPSH__LOCKWORD(b, s))
+#define HMAPSH_UNLOCKAT(b, s) hmapsh__unlock(HMAPSH__LOCKWORD(b, s))
+#define HMAPSH_SHARD(b, key) HMAPSH_AT(b, HMAPSH_IDX(b, key))
+#define HMAPSH_LOCK(b, key) HMAPSH_LOCKAT(b, HMAPSH_IDX(b, key))
+#define HMAPSH_UNLOCK(b, key) HMAPSH_UNLOCKAT(b, HMAPSH_IDX(b, key))
+#define HMAPSH_LEN(b) ((b) ? hmapsh__len((void**)(b), sizeof(**(b))) : 0)
+
+#define HMAPSH_SET(b, key, val) (HMAPSH_LOCK(b, key), HMAP64_SET(HMAPSH_SHARD(b, key), (key), (val)), HMAPSH_UNLOCK(b, key))
+#define HMAPSH_GET(b, key, out) hmapsh__get((void**)(b), (key), (0 ? *(b) : (out)), sizeof(**(b)), 0)
+#define HMAPSH_HAS(b, key) hmapsh__get((void**)(b), (key), NULL, sizeof(**(b)), 0)
+#define HMAPSH_DEL(b, key) hmapsh__get((void**)(b), (key), NULL, sizeof(**(b)), 1)
+
+struct hmapsh__hdr { size_t count, shift; void *mem; };
+#define HMAPSH__HDR(b) (((struct hmapsh__hdr *)(void*)(b))-1)
+#define HMAPSH__LINE 64 /* each shard has a cache line with its table pointer and lock */
+#define HMAPSH__STRIDE (HMAPSH__LINE / sizeof(void*))
+#define HMAPSH__LOCKWORD(b, s) ((long*)(void*)&(b)[(s) * HMAPSH__STRIDE + 1])
+#define HMAPSH__TABLE(vals, elem_size) ((struct hmap64__hdr *)((char*)(vals) - (elem_size))-1)
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable:4505) //unreferenced local function has been removed
+#endif
+
+HMAP__UNUSED static void hmapsh__lock(long* l)
+{
+	#ifdef __GNUC__
+	while (__atomic_exchange_n(l, 1, __ATOMIC_ACQUIRE))
+		while (__atomic_load_n(l, __ATOMIC_RELAXED))
+		{
+			#if defined(__i386__) || defined(__x86_64__)
+			__builtin_ia32_pause();
+			#endif
+		}
+	#else
+	while (_InterlockedExchange((volatile long*)l, 1))
+		while (*(volatile long*)l)
+		{
+			#if defined(_M_IX86) || defined(_M_X64)
+			_mm_pause();
+			#endif
+		}
+	#endif
+}
+
+HMAP__UNUSED static void hmapsh__unlock(long* l)
+{
+	#ifdef __GNUC__
+	__atomic_store_n(l, 0, __ATOMIC_RELEASE);
+	#else
+	_InterlockedExchange((volatile long*)l, 0);
+	#endif
+}
+
+HMAP__UNUSED static void* hmapsh__init(size_t shards)
+{
+	size_t count = 2, shift = 63;
+	char *mem, *shard0;
+	while (count < shards && count < ((size_t)1 << 20)) { count <<= 1; shift--; }
+	/* the header goes right before the cache line aligned shards */
+	mem = (char *)TINYHASHMAP_MALLOC(NULL, HMAPSH__LINE - 1 + HMAPSH__LINE + count * HMAPSH__LINE);
+	if (!mem)
+		return NULL; /* out of memory */
+	shard0 = mem + ((HMAPSH__LINE - (size_t)mem) & (HMAPSH__LINE - 1)) + HMAPSH__LINE;
+	memset(shard0, 0, count * HMAPSH__LINE);
+	HMAPSH__HDR(shard0)->count = count;
+	HMAPSH__HDR(shard0)->shift = shift;
+	HMAPSH__HDR(shard0)->mem = mem;
+	return shard0;
+}
+
+HMAP__UNUSED static void hmapsh__free(void** b, size_t elem_size)
+{
+	size_t s;
+	for (s = 0; s != HMAPSH__HDR(b)->count; s++)
+	{
+		if (b[s * HMAPSH__STRIDE])
+			HMAP64__FREEHDR(HMAPSH__TABLE(b[s * HMAPSH__STRIDE], elem_size));
+	}
+	TINYHASHMAP_FREE(NULL, HMAPSH__HDR(b)->mem);
+}
+
+HMAP__UNUSED static size_t hmapsh__len(void** b, size_t elem_size)
+{
+	size_t s, len = 0;
+	for (s = 0; s != HMAPSH__HDR(b)->count; s++)
+	{
+		hmapsh__lock(HMAPSH__LOCKWORD(b, s));
+		if (b[s * HMAPSH__STRIDE])
+			len += HMAPSH__TABLE(b[s * HMAPSH__STRIDE], elem_size)->len;
+		hmapsh__unlock(HMAPSH__LOCKWORD(b, s));
+	}
+	return len;
+}
+
+/* Looks up (and deletes if del is set) a key under the lock of its shard, copies the value (or the null value) to out if not NULL */
+HMAP__UNUSED static int hmapsh__get(void** b, uint64_t key, void* out, size_t elem_size, int del)
+{
+	size_t s = (size_t)(key >> HMAPSH__HDR(b)->shift);
+	ptrdiff_t i = -1;
+	char* vals;
+	hmapsh__lock(HMAPSH__LOCKWORD(b, s));
+	if ((vals = (char*)b[s * HMAPSH__STRIDE]) != NULL)
+	{
+		i = hmap64__idx(HMAPSH__TABLE(vals, elem_size), key, 0, del, elem_size);
+		if (out) memcpy(out, vals + i * elem_size, elem_size);
+	}
+	else if (out)
+		memset(out, 0, elem_size);
+	hmapsh__unlock(HMAPSH__LOCKWORD(b, s));
+	return (i != -1);
+}
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#endif
@@ -0,0 +1,173 @@
+/* TinyHeap - d-ary heap priority queue - public domain - Bernhard Schelling 2020
+   https://github.com/schellingb/c-data-structures
+         no warranty implied; use at your own risk
+
+   This file implements a priority queue as a heap inside a TinyBuf
+   array, so the heap is a regular buffer and all BUF_ macros work on
+   it. Adding an element and removing the first element are O(log n)
+   instead of the O(n) of BUF_INSERT into a sorted buffer.
+   Every node has 4 children which are next to each other in memory,
+   which makes the tree half as deep as a binary heap and a node's
+   children mostly share a cache line.
+
+   The order is given by a comparison function like for qsort, the
+   element for which it returns less than 0 against all others is the
+   first one (so comparing ascending makes a min-heap). The macros that
+   take it can be given the name of a function or of a macro which
+   expands to one, like #define BY_TIME my_compare_time
+
+   Be careful not to supply modifying statements to the macro arguments.
+   Something like HEAP_PUSH(heap, vals[i++], cmp); would have unintended results.
+
+   Sample usage:
+
+   int cmp_int(const void* a, const void* b) { return (*(int*)a > *(int*)b) - (*(int*)a < *(int*)b); }
+
+   int* heap = NULL;
+   HEAP_PUSH(heap, 30, cmp_int);
+   HEAP_PUSH(heap, 10, cmp_int);
+   HEAP_PUSH(heap, 20, cmp_int);
+   -- now BUF_LEN(heap) == 3 and HEAP_TOP(heap) == 10
+
+   -- Remove the first element:
+   int first = HEAP_POP(heap, cmp_int);
+   -- now first == 10, BUF_LEN(heap) == 2 and HEAP_TOP(heap) == 20
+
+   -- Replace the first element (faster than POP followed by PUSH):
+   HEAP_REPLACETOP(heap, 25, cmp_int);
+   -- now HEAP_TOP(heap) == 25, 20 was removed
+   -- This keeps the k largest elements seen with a min-heap of size k:
+   if (BUF_LEN(heap) < k) HEAP_PUSH(heap, x, cmp_int);
+   else if (x > HEAP_TOP(heap)) HEAP_REPLACETOP(heap, x, cmp_int);
+
+   -- Turn any buffer into a heap in O(n):
+   int* buf = NULL;
+   BUF_PUSH(buf, 5); BUF_PUSH(buf, 3); ...
+   HEAP_HEAPIFY(buf, cmp_int);
+   -- now HEAP_TOP(buf) is the smallest element
+
+   -- The heap is a buffer, free it with:
+   BUF_FREE(heap);
+
+   PUBLIC DOMAIN (UNLICENSE)
+
+   This is free and unencumbered software released into the public domain.
+
+   Anyone is free to copy, modify, publish, use, compile, sell, or
+   distribute this software, either in source code form or as a compiled
+   binary, for any purpose, commercial or non-commercial, and by any
+   means.
+
+   In jurisdictions that recognize copyright laws, the author or authors
+   of this software dedicate any and all copyright interest in the
+   software to the public domain. We make this dedication for the benefit
+   of the public at large and to the detriment of our heirs and
+   successors. We intend this dedication to be an overt act of
+   relinquishment in perpetuity of all present and future rights to this
+   software under copyright law.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+   OTHER DEALINGS IN THE SOFTWARE.
+
+   For more information, please refer to <http://unlicense.org/>
+*/
+
+#ifndef TINYHEAP_H
+#define TINYHEAP_H
+
+#include "tinybuf.h"
+
+#define HEAP_TOP(b)                ((b)[0])
+#define HEAP_PUSH(b, val, cmp)     (BUF_PUSH((b), (val)), heap__up((b), BUF_LEN(b) - 1, sizeof(*(b)), (cmp)))
+#define HEAP_POP(b, cmp)           (heap__down(heap__swap((b), (b) + BUF_LEN(b) - 1, sizeof(*(b))), 0, BUF_LEN(b) - 1, sizeof(*(b)), (cmp)), BUF_POP(b))
+#define HEAP_REPLACETOP(b, val, cmp) ((b)[0] = (val), heap__down((b), 0, BUF_LEN(b), sizeof(*(b)), (cmp)))
+#define HEAP_HEAPIFY(b, cmp)       (heap__heapify((b), BUF_LEN(b), sizeof(*(b)), (cmp)))
+
+#define HEAP__D 4 /* number of children of each node */
+typedef int (*heap__cmp)(const void*, const void*);
+
+#if defined(_MSC_VER)
+#pragma warning(push)
+#pragma warning(disable:4505) //unreferenced local function has been removed
+#endif
+
+/* Swaps two elements in steps of up to 64 bytes, returns heap */
+#ifdef __GNUC__
+__attribute__((__unused__))
+#endif
+static void *heap__swap(void *heap, void *other, size_t elem_size)
+{
+	char tmp[64], *a = (char*)heap, *b = (char*)other;
+	size_t n;
+	if (a == b)
+		return heap;
+	for (; elem_size; elem_size -= n, a += n, b += n)
+	{
+		n = (elem_size < sizeof(tmp) ? elem_size : sizeof(tmp));
+		memcpy(tmp, a, n);
+		memcpy(a, b, n);
+		memcpy(b, tmp, n);
+	}
+	return heap;
+}
+
+/* Moves element i towards the root while it comes before its parent */
+#ifdef __GNUC__
+__attribute__((__unused__))
+#endif
+static void heap__up(void *heap, size_t i, size_t elem_size, heap__cmp cmp)
+{
+	char *elems = (char*)heap;
+	size_t parent;
+	for (; i; i = parent)
+	{
+		parent = (i - 1) / HEAP__D;
+		if (cmp(elems + i * elem_size, elems + parent * elem_size) >= 0)
+			break;
+		heap__swap(elems + i * elem_size, elems + parent * elem_size, elem_size);
+	}
+}
+
+/* Moves element i away from the root while one of its children comes before it, only elements below n are part of the heap */
+#ifdef __GNUC__
+__attribute__((__unused__))
+#endif
+static void heap__down(void *heap, size_t i, size_t n, size_t elem_size, heap__cmp cmp)
+{
+	char *elems = (char*)heap;
+	size_t child, end, first;
+	for (; (child = i * HEAP__D + 1) < n; i = first)
+	{
+		end = (n - child < HEAP__D ? n : child + HEAP__D);
+		for (first = child++; child != end; child++)
+			if (cmp(elems + child * elem_size, elems + first * elem_size) < 0)
+				first = child;
+		if (cmp(elems + first * elem_size, elems + i * elem_size) >= 0)
+			break;
+		heap__swap(elems + i * elem_size, elems + first * elem_size, elem_size);
+	}
+}
+
+/* Orders n elements into a heap by moving down every node that has children, starting with the last one */
+#ifdef __GNUC__
+__attribute__((__unused__))
+#endif
+static void heap__heapify(void *heap, size_t n, size_t elem_size, heap__cmp cmp)
+{
+	size_t i;
+	if (n < 2)
+		return;
+	for (i = (n - 2) / HEAP__D + 1; i--;)
+		heap__down(heap, i, n, elem_size, cmp);
+}
+
+#if defined(_MSC_VER)
+#pragma warning(pop)
+#endif
+
+#endif
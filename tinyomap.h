@@ -0,0 +1,598 @@
+/* TinyOMap - ordered map as a B+tree - public domain - Bernhard Schelling 2020
+   https://github.com/schellingb/c-data-structures
+         no warranty implied; use at your own risk
+
+   This file implements an ordered map with 64-bit keys as a B+tree,
+   which can find the first key not less than any key and go over the
+   keys in order from there. It is the companion to TinyHashMap for
+   range queries and ordered scans (for example over time stamps).
+
+   Keys are kept sorted in leaves of 14 keys which are linked in order,
+   a leaf with its links fills two cache lines. Inner nodes have up to
+   16 children which fill three cache lines. A lookup goes down one
+   node per level (about 5 levels for 10 million keys) and scanning a
+   range reads whole leaves one after another.
+   Values are in a separate pool with room for the 14 values of every
+   leaf, the map is a pointer to it so map[i] is the value of position
+   i. All nodes and values come from TINYOMAP_MALLOC/TINYOMAP_FREE.
+   Appending keys larger than all keys fills the leaves completely,
+   otherwise splitting a full node leaves it half full.
+   Can be used in C++ with POD types (without any constructor/destructor).
+
+   Be careful not to supply modifying statements to the macro arguments.
+   Something like OMAP_SET(map, i++, val); would have unintended results.
+
+   Sample usage:
+
+   -- Set elements with uint64_t keys and mytype_t values:
+   mytype_t* map = NULL;
+   OMAP_SET(map, 30, some_element);
+   OMAP_SET(map, 10, other_element);
+   -- now OMAP_LEN(map) == 2, OMAP_GET(map, 10) == other_element
+   -- OMAP_HAS/DEL/PTR/IDX work like for TinyHashMap
+
+   -- Iterate elements in order of their keys:
+   size_t i;
+   OMAP_ITER(map, i)
+   ------ here map[i] is the value of key OMAP_KEY(map, i) (10 then 30)
+   -- OMAP_ITER(map, i) is for (i = OMAP_FIRST(map); i != OMAP_END; i = OMAP_NEXT(map, i))
+   -- Backwards from OMAP_LAST(map) with OMAP_PREV(map, i)
+
+   -- Go over a range of keys:
+   for (i = OMAP_LOWER_BOUND(map, 5); i != OMAP_END && OMAP_KEY(map, i) < 20; i = OMAP_NEXT(map, i))
+   ------ here OMAP_KEY(map, i) is 10
+   -- OMAP_LOWER_BOUND is OMAP_END if there is no key not less than the given key
+   -- Setting a new key or deleting a key can move other keys to other
+   -- positions, setting an existing key or writing map[i] does not
+   -- Keys are sorted as unsigned, for int64_t keys add 0x8000000000000000
+
+   -- Set a custom null value (is zeroed by default):
+   OMAP_SETNULLVAL(map, map_null);
+   -- now OMAP_GET(map, 12345) == map_null
+
+   -- Remove all elements (keep memory allocated), free allocated memory:
+   OMAP_CLEAR(map);
+   OMAP_FREE(map);
+   -- now map == NULL, OMAP_LEN(map) == 0
+
+   -- To handle running out of memory:
+   bool ran_out_of_memory = !OMAP_TRYFIT(map, 1000);
+   -- before setting an element, makes room for 1000 keys in half full
+   -- leaves. When out of memory, map will stay unmodified. If memory
+   -- runs out while setting, the new key is not added and SET and PTR
+   -- go to the null value (like for TinyHashMapD)
+
+   -- Use a custom allocator (for example an arena):
+   #define TINYOMAP_MALLOC(ctx, size) my_malloc(ctx, size)
+   #define TINYOMAP_FREE(ctx, ptr) my_free(ctx, ptr)
+   -- before including this file, then per map:
+   OMAP_SETALLOC(map, my_arena);
+   -- now all memory of map comes from my_arena (ctx is NULL by default)
+
+   PUBLIC DOMAIN (UNLICENSE)
+
+   This is free and unencumbered software released into the public domain.
+
+   Anyone is free to copy, modify, publish, use, compile, sell, or
+   distribute this software, either in source code form or as a compiled
+   binary, for any purpose, commercial or non-commercial, and by any
+   means.
+
+   In jurisdictions that recognize copyright laws, the author or authors
+   of this software dedicate any and all copyright interest in the
+   software to the public domain. We make this dedication for the benefit
+   of the public at large and to the detriment of our heirs and
+   successors. We intend this dedication to be an overt act of
+   relinquishment in perpetuity of all present and future rights to this
+   software under copyright law.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+   OTHER DEALINGS IN THE SOFTWARE.
+
+   For more information, please refer to <http://unlicense.org/>
+*/
+
+#ifndef TINYOMAP_H
+#define TINYOMAP_H
+
+#include <stdlib.h> /* for malloc, free */
+#include <string.h> /* for memcpy, memmove, memset */
+#include <stddef.h> /* for ptrdiff_t, size_t */
+#if defined(_MSC_VER) && (_MSC_VER < 1600)
+typedef unsigned __int32 uint32_t;
+typedef unsigned __int64 uint64_t;
+#else
+#include <stdint.h> /* for uint32_t, uint64_t */
+#endif
+
+#ifndef TINYOMAP_MALLOC
+#define TINYOMAP_MALLOC(ctx, size) malloc(size)
+#define TINYOMAP_FREE(ctx, ptr) free(ptr)
+#endif
+
+#define OMAP_END ((size_t)-1)
+#define OMAP_LEN(b) ((b) ? OMAP__HDR(b)->len : 0)
+#define OMAP_KEY(b, idx) (OMAP__HDR(b)->leafpool[(size_t)(idx) / OMAP__LEAFN].keys[(size_t)(idx) % OMAP__LEAFN])
+#define OMAP_SETNULLVAL(b, val) (OMAP__FIT0(b), (b)[-1] = (val))
+#define OMAP_CLEAR(b) ((b) ? (omap__clear(OMAP__HDR(b)), 0) : 0)
+#define OMAP_FREE(b) ((b) ? (omap__free(OMAP__HDR(b)), (b) = NULL) : 0)
+#define OMAP_FIT(b, n) ((!(n) || ((b) && omap__fits(OMAP__HDR(b), (size_t)(n)))) ? 0 : OMAP__GROW(b, n))
+#define OMAP_TRYFIT(b, n) (OMAP_FIT((b), (n)), (!(n) || ((b) && omap__fits(OMAP__HDR(b), (size_t)(n)))))
+#define OMAP_SETALLOC(b, ctx) ((b) && OMAP__HDR(b)->allocctx == (ctx) ? 0 : (*(void**)(&(b)) = omap__grow(((b) ? OMAP__HDR(b) : NULL), (void*)(b), sizeof(*(b)), 0, (ctx))))
+
+#define OMAP_SET(b, key, val) (OMAP__FIT1(b), (b)[omap__idx(OMAP__HDR(b), (uint64_t)(key), 1, 0, sizeof(*(b)))] = (val))
+#define OMAP_GET(b, key) (OMAP__FIT0(b), (b)[omap__idx(OMAP__HDR(b), (uint64_t)(key), 0, 0, sizeof(*(b)))])
+#define OMAP_HAS(b, key) ((b) ? omap__idx(OMAP__HDR(b), (uint64_t)(key), 0, 0, sizeof(*(b))) != -1 : 0)
+#define OMAP_DEL(b, key) ((b) ? omap__idx(OMAP__HDR(b), (uint64_t)(key), 0, 1, sizeof(*(b))) != -1 : 0)
+#define OMAP_PTR(b, key) (OMAP__FIT1(b), &(b)[omap__idx(OMAP__HDR(b), (uint64_t)(key), 1, 0, sizeof(*(b)))])
+#define OMAP_IDX(b, key) ((b) ? omap__idx(OMAP__HDR(b), (uint64_t)(key), 0, 0, sizeof(*(b))) : -1)
+
+#define OMAP_LOWER_BOUND(b, key) ((b) ? omap__lowerbound(OMAP__HDR(b), (uint64_t)(key)) : OMAP_END)
+#define OMAP_FIRST(b) ((b) && OMAP__HDR(b)->len ? (size_t)OMAP__HDR(b)->first * OMAP__LEAFN : OMAP_END)
+#define OMAP_LAST(b) ((b) && OMAP__HDR(b)->len ? (size_t)OMAP__HDR(b)->last * OMAP__LEAFN + OMAP__HDR(b)->leafpool[OMAP__HDR(b)->last].len - 1 : OMAP_END)
+#define OMAP_NEXT(b, idx) omap__next(OMAP__HDR(b), (size_t)(idx), sizeof(*(b)))
+#define OMAP_PREV(b, idx) omap__prev(OMAP__HDR(b), (size_t)(idx))
+#define OMAP_ITER(b, idx) for ((idx) = OMAP_FIRST(b); (idx) != OMAP_END; (idx) = OMAP_NEXT((b), (idx)))
+
+#define OMAP__LEAFN 14 /* keys per leaf, with the links a leaf fills two cache lines */
+#define OMAP__INNERN 16 /* children per inner node, with 15 keys between them a node fills three cache lines */
+#define OMAP__MAXHEIGHT 32 /* levels of inner nodes, far more than 32-bit node numbers can fill */
+#define OMAP__NONE 0xFFFFFFFF /* number of no node */
+#define OMAP__ALIGN 64 /* cache line alignment of the nodes */
+
+/* Leaves are linked in order of their keys, free leaves are linked by next */
+struct omap__leaf { uint64_t keys[OMAP__LEAFN]; uint32_t len, next, prev, pad; };
+/* Child i has keys not less than keys[i - 1] and less than keys[i], free inner nodes are linked by kids[0] */
+struct omap__inner { uint64_t keys[OMAP__INNERN - 1]; uint32_t len, pad, kids[OMAP__INNERN]; };
+
+/* The header is followed by the null value and the values of all leaves, the nodes are in two more allocations */
+struct omap__hdr
+{
+	size_t len, height, leaves, leafend, leafcap, inners, innerend, innercap;
+	uint32_t root, first, last, freeleaf, freeinner, pad[3];
+	struct omap__leaf *leafpool; struct omap__inner *innerpool; void *allocctx, *mem, *leafmem, *innermem;
+};
+#define OMAP__HDR(b) (((struct omap__hdr *)&(b)[-1])-1)
+#define OMAP__GROW(b, n) (*(void**)(&(b)) = omap__grow(((b) ? OMAP__HDR(b) : NULL), (void*)(b), sizeof(*(b)), (size_t)(n), ((b) ? OMAP__HDR(b)->allocctx : NULL)))
+#define OMAP__ROOM(hdr) ((hdr)->leaves < (hdr)->leafcap && (hdr)->inners + (hdr)->height + 1 < (hdr)->innercap) /* a split of all levels fits */
+#define OMAP__FIT1(b) ((b) && OMAP__ROOM(OMAP__HDR(b)) ? 0 : OMAP__GROW(b, 0))
+#define OMAP__FIT0(b) ((b) ? 0 : OMAP__GROW(b, 0))
+#define OMAP__VALS(hdr, elem_size) (((char*)((hdr) + 1)) + (elem_size))
+
+#if defined(__GNUC__)
+#define OMAP__PREFETCH(p) __builtin_prefetch(p)
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h> /* for _mm_prefetch */
+#define OMAP__PREFETCH(p) _mm_prefetch((const char*)(p), _MM_HINT_T0)
+#else
+#define OMAP__PREFETCH(p) ((void)0)
+#endif
+
+#ifdef __GNUC__
+#define OMAP__UNUSED __attribute__((__unused__))
+#else
+#define OMAP__UNUSED
+#endif
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable:4505) //unreferenced local function has been removed
+#endif
+
+/* Returns the number of leaves and inner nodes needed for n keys in half full leaves (and one more insert) */
+OMAP__UNUSED static size_t omap__needleaves(const struct omap__hdr* hdr, size_t n)
+{
+	size_t want = n / (OMAP__LEAFN / 2) + 1;
+	return (hdr && want <= hdr->leaves ? hdr->leaves + 1 : want);
+}
+
+OMAP__UNUSED static size_t omap__needinners(const struct omap__hdr* hdr, size_t n)
+{
+	size_t want = omap__needleaves(hdr, n) / (OMAP__INNERN / 2) + (hdr ? hdr->height : 0) + 2;
+	return (hdr && want <= hdr->inners + hdr->height + 2 ? hdr->inners + hdr->height + 2 : want);
+}
+
+OMAP__UNUSED static int omap__fits(const struct omap__hdr* hdr, size_t n)
+{
+	return hdr->leafcap >= omap__needleaves(hdr, n) && hdr->innercap >= omap__needinners(hdr, n);
+}
+
+/* Makes room for n keys (and at least one more insert), with another allocator ctx all memory moves over, returns ptr unchanged on overflow or when out of memory */
+OMAP__UNUSED static void* omap__grow(struct omap__hdr* hdr, void* ptr, size_t elem_size, size_t n, void* ctx)
+{
+	struct omap__hdr* new_hdr;
+	int move = (ptr && hdr->allocctx != ctx);
+	size_t leafcap = (ptr ? hdr->leafcap : 0), innercap = (ptr ? hdr->innercap : 0), want;
+	char *mem = NULL, *leafmem = NULL, *innermem = NULL;
+	int newleaves, newinners;
+	if (!ptr) hdr = NULL;
+	for (want = omap__needleaves(hdr, n); leafcap < want; leafcap = (leafcap ? leafcap * 2 : 16))
+		if (leafcap >= OMAP__NONE / 2 || leafcap > ((size_t)-1 / 2 - OMAP__ALIGN - sizeof(struct omap__hdr)) / (OMAP__LEAFN * elem_size + sizeof(struct omap__leaf)))
+			return ptr; /* node numbers are 32-bit or overflow */
+	for (want = omap__needinners(hdr, n); innercap < want; innercap = (innercap ? innercap * 2 : 4))
+		if (innercap >= OMAP__NONE / 2 || innercap > ((size_t)-1 / 2 - OMAP__ALIGN) / sizeof(struct omap__inner))
+			return ptr; /* node numbers are 32-bit or overflow */
+
+	/* allocate everything first so the map stays unmodified when out of memory, the values are in the allocation of the header */
+	newleaves = (!ptr || move || leafcap != hdr->leafcap);
+	newinners = (!ptr || move || innercap != hdr->innercap);
+	if (newleaves && (mem = (char*)TINYOMAP_MALLOC(ctx, sizeof(struct omap__hdr) + (1 + leafcap * OMAP__LEAFN) * elem_size)) != NULL)
+		leafmem = (char*)TINYOMAP_MALLOC(ctx, OMAP__ALIGN - 1 + leafcap * sizeof(struct omap__leaf));
+	if (newinners)
+		innermem = (char*)TINYOMAP_MALLOC(ctx, OMAP__ALIGN - 1 + innercap * sizeof(struct omap__inner));
+	if ((newleaves && !leafmem) || (newinners && !innermem))
+	{
+		if (leafmem) TINYOMAP_FREE(ctx, leafmem);
+		if (mem) TINYOMAP_FREE(ctx, mem);
+		if (innermem) TINYOMAP_FREE(ctx, innermem);
+		return ptr; /* out of memory */
+	}
+
+	new_hdr = (mem ? (struct omap__hdr*)mem : hdr);
+	if (!ptr)
+	{
+		memset(new_hdr, 0, sizeof(struct omap__hdr));
+		new_hdr->root = new_hdr->first = new_hdr->last = new_hdr->freeleaf = new_hdr->freeinner = OMAP__NONE;
+		memset(OMAP__VALS(new_hdr, elem_size) - elem_size, 0, elem_size);
+	}
+	else if (mem)
+	{
+		*new_hdr = *hdr;
+		memcpy(OMAP__VALS(new_hdr, elem_size) - elem_size, (char*)ptr - elem_size, (1 + hdr->leafend * OMAP__LEAFN) * elem_size);
+	}
+	if (leafmem)
+	{
+		struct omap__leaf* pool = (struct omap__leaf*)(leafmem + ((OMAP__ALIGN - (size_t)leafmem) & (OMAP__ALIGN - 1)));
+		if (ptr)
+		{
+			memcpy(pool, hdr->leafpool, hdr->leafend * sizeof(struct omap__leaf));
+			TINYOMAP_FREE(hdr->allocctx, hdr->leafmem);
+		}
+		new_hdr->leafpool = pool;
+		new_hdr->leafmem = leafmem;
+		new_hdr->leafcap = leafcap;
+	}
+	if (innermem)
+	{
+		struct omap__inner* pool = (struct omap__inner*)(innermem + ((OMAP__ALIGN - (size_t)innermem) & (OMAP__ALIGN - 1)));
+		if (ptr)
+		{
+			memcpy(pool, new_hdr->innerpool, new_hdr->innerend * sizeof(struct omap__inner));
+			TINYOMAP_FREE(new_hdr->allocctx, new_hdr->innermem);
+		}
+		new_hdr->innerpool = pool;
+		new_hdr->innermem = innermem;
+		new_hdr->innercap = innercap;
+	}
+	if (mem)
+	{
+		if (ptr)
+			TINYOMAP_FREE(hdr->allocctx, hdr->mem);
+		new_hdr->mem = mem;
+	}
+	new_hdr->allocctx = ctx;
+	return OMAP__VALS(new_hdr, elem_size);
+}
+
+OMAP__UNUSED static void omap__clear(struct omap__hdr* hdr)
+{
+	hdr->len = hdr->height = hdr->leaves = hdr->leafend = hdr->inners = hdr->innerend = 0;
+	hdr->root = hdr->first = hdr->last = hdr->freeleaf = hdr->freeinner = OMAP__NONE;
+}
+
+OMAP__UNUSED static void omap__free(struct omap__hdr* hdr)
+{
+	TINYOMAP_FREE(hdr->allocctx, hdr->leafmem);
+	TINYOMAP_FREE(hdr->allocctx, hdr->innermem);
+	TINYOMAP_FREE(hdr->allocctx, hdr->mem);
+}
+
+OMAP__UNUSED static uint32_t omap__newleaf(struct omap__hdr* hdr)
+{
+	uint32_t l = hdr->freeleaf;
+	if (l != OMAP__NONE)
+		hdr->freeleaf = hdr->leafpool[l].next;
+	else
+		l = (uint32_t)hdr->leafend++;
+	hdr->leaves++;
+	hdr->leafpool[l].len = 0;
+	return l;
+}
+
+OMAP__UNUSED static uint32_t omap__newinner(struct omap__hdr* hdr)
+{
+	uint32_t n = hdr->freeinner;
+	if (n != OMAP__NONE)
+		hdr->freeinner = hdr->innerpool[n].kids[0];
+	else
+		n = (uint32_t)hdr->innerend++;
+	hdr->inners++;
+	return n;
+}
+
+OMAP__UNUSED static void omap__freeinner(struct omap__hdr* hdr, uint32_t n)
+{
+	hdr->innerpool[n].kids[0] = hdr->freeinner;
+	hdr->freeinner = n;
+	hdr->inners--;
+}
+
+/* Goes down to the leaf which can have key, with nodes set the inner node and child taken on each level get stored (level 0 above the leaves) */
+OMAP__UNUSED static uint32_t omap__descend(const struct omap__hdr* hdr, uint64_t key, uint32_t* nodes, uint32_t* kids)
+{
+	uint32_t n = hdr->root, c, i;
+	size_t h;
+	for (h = hdr->height; h--; n = hdr->innerpool[n].kids[c])
+	{
+		/* counting the keys not greater than key compiles to compares without branches */
+		const struct omap__inner* in = hdr->innerpool + n;
+		for (c = i = 0; i + 1 < in->len; i++)
+			c += (in->keys[i] <= key);
+		if (nodes)
+		{
+			nodes[h] = n;
+			kids[h] = c;
+		}
+	}
+	return n;
+}
+
+/* Returns the position of the first key in the leaf not less than key */
+OMAP__UNUSED static size_t omap__leafpos(const struct omap__leaf* leaf, uint64_t key)
+{
+	size_t pos = 0, i;
+	for (i = 0; i != leaf->len; i++)
+		pos += (leaf->keys[i] < key);
+	return pos;
+}
+
+/* Moves n keys and values from position spos of leaf src to position dpos of leaf dst */
+OMAP__UNUSED static void omap__leafmove(struct omap__hdr* hdr, uint32_t dst, size_t dpos, uint32_t src, size_t spos, size_t n, size_t elem_size)
+{
+	char* vals = OMAP__VALS(hdr, elem_size);
+	memmove(hdr->leafpool[dst].keys + dpos, hdr->leafpool[src].keys + spos, n * sizeof(uint64_t));
+	memmove(vals + ((size_t)dst * OMAP__LEAFN + dpos) * elem_size, vals + ((size_t)src * OMAP__LEAFN + spos) * elem_size, n * elem_size);
+}
+
+/* Adds child node with its smallest key sep right of the child taken on level 0, full nodes get split up to the root */
+OMAP__UNUSED static void omap__addkid(struct omap__hdr* hdr, const uint32_t* nodes, const uint32_t* kids, uint64_t sep, uint32_t node, int append)
+{
+	uint64_t tkeys[OMAP__INNERN];
+	uint32_t tkids[OMAP__INNERN + 1], n;
+	struct omap__inner *in, *rn;
+	size_t h, c, keep;
+	for (h = 0; h != hdr->height; h++)
+	{
+		in = hdr->innerpool + nodes[h];
+		c = kids[h] + 1;
+		if (in->len < OMAP__INNERN)
+		{
+			memmove(in->keys + c, in->keys + c - 1, (in->len - c) * sizeof(uint64_t));
+			memmove(in->kids + c + 1, in->kids + c, (in->len - c) * sizeof(uint32_t));
+			in->keys[c - 1] = sep;
+			in->kids[c] = node;
+			in->len++;
+			return;
+		}
+
+		/* split the full node in half (keep it full when appending), the key between the halves goes up a level */
+		memcpy(tkeys, in->keys, (c - 1) * sizeof(uint64_t));
+		memcpy(tkeys + c, in->keys + c - 1, (OMAP__INNERN - c) * sizeof(uint64_t));
+		memcpy(tkids, in->kids, c * sizeof(uint32_t));
+		memcpy(tkids + c + 1, in->kids + c, (OMAP__INNERN - c) * sizeof(uint32_t));
+		tkeys[c - 1] = sep;
+		tkids[c] = node;
+		keep = (append ? OMAP__INNERN : OMAP__INNERN / 2);
+		rn = hdr->innerpool + (n = omap__newinner(hdr));
+		in->len = (uint32_t)keep;
+		memcpy(in->keys, tkeys, (keep - 1) * sizeof(uint64_t));
+		memcpy(in->kids, tkids, keep * sizeof(uint32_t));
+		rn->len = (uint32_t)(OMAP__INNERN + 1 - keep);
+		memcpy(rn->keys, tkeys + keep, (rn->len - 1) * sizeof(uint64_t));
+		memcpy(rn->kids, tkids + keep, rn->len * sizeof(uint32_t));
+		sep = tkeys[keep - 1];
+		node = n;
+	}
+
+	/* the root got split, a new root above it has both halves */
+	rn = hdr->innerpool + (n = omap__newinner(hdr));
+	rn->len = 2;
+	rn->keys[0] = sep;
+	rn->kids[0] = hdr->root;
+	rn->kids[1] = node;
+	hdr->root = n;
+	hdr->height++;
+}
+
+/* Removes child c from the inner node on level h, nodes left without children get removed from their parents */
+OMAP__UNUSED static void omap__delkid(struct omap__hdr* hdr, const uint32_t* nodes, const uint32_t* kids, size_t h, size_t c)
+{
+	struct omap__inner* in;
+	size_t k;
+	for (;; h++)
+	{
+		in = hdr->innerpool + nodes[h];
+		if (in->len != 1)
+			break;
+		omap__freeinner(hdr, nodes[h]);
+		if (h + 1 == hdr->height)
+		{
+			/* that was the last key */
+			hdr->root = hdr->first = hdr->last = OMAP__NONE;
+			hdr->height = 0;
+			return;
+		}
+		c = kids[h + 1];
+	}
+	k = (c ? c - 1 : 0);
+	memmove(in->keys + k, in->keys + k + 1, (in->len - 2 - k) * sizeof(uint64_t));
+	memmove(in->kids + c, in->kids + c + 1, (in->len - 1 - c) * sizeof(uint32_t));
+	in->len--;
+
+	/* a root with a single child gets replaced by it */
+	while (hdr->height && hdr->innerpool[hdr->root].len == 1)
+	{
+		uint32_t old = hdr->root;
+		hdr->root = hdr->innerpool[old].kids[0];
+		omap__freeinner(hdr, old);
+		hdr->height--;
+	}
+}
+
+/* Unlinks leaf l which is child c of its parent and removes it from the tree */
+OMAP__UNUSED static void omap__dropleaf(struct omap__hdr* hdr, uint32_t l, const uint32_t* nodes, const uint32_t* kids, size_t c)
+{
+	struct omap__leaf* leaf = hdr->leafpool + l;
+	if (leaf->prev != OMAP__NONE)
+		hdr->leafpool[leaf->prev].next = leaf->next;
+	else
+		hdr->first = leaf->next;
+	if (leaf->next != OMAP__NONE)
+		hdr->leafpool[leaf->next].prev = leaf->prev;
+	else
+		hdr->last = leaf->prev;
+	leaf->next = hdr->freeleaf;
+	hdr->freeleaf = l;
+	hdr->leaves--;
+	omap__delkid(hdr, nodes, kids, 0, c);
+}
+
+/* Removes position pos of leaf l, a leaf with few keys left gets merged with a neighbour under the same parent if both fit in one */
+OMAP__UNUSED static void omap__leafdel(struct omap__hdr* hdr, uint32_t l, size_t pos, const uint32_t* nodes, const uint32_t* kids, size_t elem_size)
+{
+	struct omap__leaf* leaf = hdr->leafpool + l;
+	const struct omap__inner* in;
+	uint32_t other;
+	omap__leafmove(hdr, l, pos, l, pos + 1, leaf->len - pos - 1, elem_size);
+	leaf->len--;
+	hdr->len--;
+	if (!hdr->height || leaf->len >= OMAP__LEAFN / 4)
+		return;
+	in = hdr->innerpool + nodes[0];
+	if (kids[0] + 1 < in->len && leaf->len + hdr->leafpool[other = in->kids[kids[0] + 1]].len <= OMAP__LEAFN)
+	{
+		omap__leafmove(hdr, l, leaf->len, other, 0, hdr->leafpool[other].len, elem_size);
+		leaf->len += hdr->leafpool[other].len;
+		omap__dropleaf(hdr, other, nodes, kids, kids[0] + 1);
+	}
+	else if (kids[0] && hdr->leafpool[other = in->kids[kids[0] - 1]].len + leaf->len <= OMAP__LEAFN)
+	{
+		omap__leafmove(hdr, other, hdr->leafpool[other].len, l, 0, leaf->len, elem_size);
+		hdr->leafpool[other].len += leaf->len;
+		omap__dropleaf(hdr, l, nodes, kids, kids[0]);
+	}
+	else if (!leaf->len)
+		omap__dropleaf(hdr, l, nodes, kids, kids[0]); /* the only child of its parent */
+}
+
+OMAP__UNUSED static ptrdiff_t omap__idx(struct omap__hdr* hdr, uint64_t key, int add, int del, size_t elem_size)
+{
+	uint32_t nodes[OMAP__MAXHEIGHT], kids[OMAP__MAXHEIGHT], l, r;
+	struct omap__leaf *leaf, *right;
+	size_t pos, keep;
+	int append;
+	if (hdr->root == OMAP__NONE)
+	{
+		if (!add || !OMAP__ROOM(hdr))
+			return -1; /* not found or out of memory (setting goes to the null value) */
+		hdr->root = hdr->first = hdr->last = l = omap__newleaf(hdr);
+		hdr->leafpool[l].next = hdr->leafpool[l].prev = OMAP__NONE;
+	}
+	l = omap__descend(hdr, key, nodes, kids);
+	leaf = hdr->leafpool + l;
+	pos = omap__leafpos(leaf, key);
+	if (pos != leaf->len && leaf->keys[pos] == key)
+	{
+		if (del)
+			omap__leafdel(hdr, l, pos, nodes, kids, elem_size);
+		return (ptrdiff_t)((size_t)l * OMAP__LEAFN + pos);
+	}
+	if (!add || !OMAP__ROOM(hdr) || hdr->height == OMAP__MAXHEIGHT)
+		return -1; /* not found or out of memory (setting goes to the null value) */
+
+	if (leaf->len == OMAP__LEAFN)
+	{
+		/* split the full leaf in half, when appending after the last key it stays full and the new leaf gets only the new key */
+		append = (pos == OMAP__LEAFN && leaf->next == OMAP__NONE);
+		keep = (append ? OMAP__LEAFN : OMAP__LEAFN / 2);
+		right = hdr->leafpool + (r = omap__newleaf(hdr));
+		omap__leafmove(hdr, r, 0, l, keep, OMAP__LEAFN - keep, elem_size);
+		right->len = (uint32_t)(OMAP__LEAFN - keep);
+		leaf->len = (uint32_t)keep;
+		right->prev = l;
+		right->next = leaf->next;
+		if (leaf->next != OMAP__NONE)
+			hdr->leafpool[leaf->next].prev = r;
+		else
+			hdr->last = r;
+		leaf->next = r;
+		if (pos >= keep)
+		{
+			l = r;
+			leaf = right;
+			pos -= keep;
+		}
+		omap__leafmove(hdr, l, pos + 1, l, pos, leaf->len - pos, elem_size);
+		leaf->keys[pos] = key;
+		leaf->len++;
+		hdr->len++;
+		omap__addkid(hdr, nodes, kids, right->keys[0], r, append);
+		return (ptrdiff_t)((size_t)l * OMAP__LEAFN + pos);
+	}
+	omap__leafmove(hdr, l, pos + 1, l, pos, leaf->len - pos, elem_size);
+	leaf->keys[pos] = key;
+	leaf->len++;
+	hdr->len++;
+	return (ptrdiff_t)((size_t)l * OMAP__LEAFN + pos);
+}
+
+/* Returns the position of the first key not less than key, or OMAP_END */
+OMAP__UNUSED static size_t omap__lowerbound(const struct omap__hdr* hdr, uint64_t key)
+{
+	uint32_t l;
+	size_t pos;
+	if (!hdr->len)
+		return OMAP_END;
+	l = omap__descend(hdr, key, NULL, NULL);
+	if ((pos = omap__leafpos(hdr->leafpool + l, key)) != hdr->leafpool[l].len)
+		return (size_t)l * OMAP__LEAFN + pos;
+	l = hdr->leafpool[l].next; /* all keys of the next leaf are larger */
+	return (l == OMAP__NONE ? OMAP_END : (size_t)l * OMAP__LEAFN);
+}
+
+/* Moving to the next leaf fetches the one after it and its values, so scans of leaves spread over the pool don't wait for each leaf */
+OMAP__UNUSED static size_t omap__next(const struct omap__hdr* hdr, size_t idx, size_t elem_size)
+{
+	size_t l = idx / OMAP__LEAFN, ahead;
+	if (idx - l * OMAP__LEAFN + 1 < hdr->leafpool[l].len)
+		return idx + 1;
+	if ((l = hdr->leafpool[l].next) == OMAP__NONE)
+		return OMAP_END;
+	if ((ahead = hdr->leafpool[l].next) != OMAP__NONE)
+	{
+		OMAP__PREFETCH(hdr->leafpool + ahead);
+		OMAP__PREFETCH((char*)(hdr->leafpool + ahead) + OMAP__ALIGN);
+		OMAP__PREFETCH(OMAP__VALS(hdr, elem_size) + ahead * OMAP__LEAFN * elem_size);
+	}
+	return l * OMAP__LEAFN;
+}
+
+OMAP__UNUSED static size_t omap__prev(const struct omap__hdr* hdr, size_t idx)
+{
+	size_t l = idx / OMAP__LEAFN;
+	if (idx - l * OMAP__LEAFN)
+		return idx - 1;
+	l = hdr->leafpool[l].prev;
+	return (l == OMAP__NONE ? OMAP_END : l * OMAP__LEAFN + hdr->leafpool[l].len - 1);
+}
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#endif
@@ -0,0 +1,165 @@
+/* TinyRBuf - ring buffer deque - public domain - Bernhard Schelling 2020
+   https://github.com/schellingb/c-data-structures
+         no warranty implied; use at your own risk
+
+   This file implements a circular double-ended queue. Elements can be
+   added and removed at both ends in O(1) without moving any of the other
+   elements, unlike BUF_REMOVE(buf, 0) of TinyBuf which shifts the whole
+   array. The capacity is a power of two so the slot of an element is the
+   position of the first element plus its index masked by capacity - 1.
+   Growing doubles the capacity and moves the smaller of the two wrapped
+   parts so the elements stay in a row from the first element.
+   The buffer is a pointer to the typed slots, memory comes from
+   TINYBUF_MALLOC/TINYBUF_REALLOC/TINYBUF_FREE of TinyBuf.
+
+   Be careful not to supply modifying statements to the macro arguments.
+   Something like RBUF_AT(buf, i++); would have unintended results.
+
+   Sample usage:
+
+   mytype_t* queue = NULL;
+   RBUF_PUSH_BACK(queue, some_element);
+   RBUF_PUSH_BACK(queue, other_element);
+   RBUF_PUSH_FRONT(queue, first_element);
+   -- now RBUF_LEN(queue) == 3, RBUF_AT(queue, 0) == first_element,
+   -- RBUF_AT(queue, 1) == some_element, RBUF_AT(queue, 2) == other_element
+
+   -- Remove elements at either end:
+   mytype_t first = RBUF_POP_FRONT(queue);
+   mytype_t last = RBUF_POP_BACK(queue);
+   -- now RBUF_LEN(queue) == 1, first == first_element, last == other_element
+
+   -- Explicitly allocate memory for at least N elements:
+   RBUF_FIT(queue, 100);
+   -- now RBUF_CAP(queue) == 128 (always a power of two, at least 16)
+
+   -- Drain the queue in batches of elements next to each other in memory:
+   while (RBUF_LEN(queue))
+   {
+     size_t n = RBUF_SPANLEN(queue);
+     process(RBUF_SPAN(queue), n);
+     RBUF_DROP_FRONT(queue, n);
+   }
+   -- RBUF_SPAN points at the first element and RBUF_SPANLEN is the number
+   -- of elements until the end of the memory or the last element, so the
+   -- loop above runs at most twice
+   -- RBUF_DROP_BACK(queue, n) removes the last n elements
+
+   -- Remove all elements (keep memory allocated):
+   RBUF_CLEAR(queue);
+   -- now RBUF_LEN(queue) == 0, RBUF_CAP(queue) == 128
+
+   -- Free allocated memory:
+   RBUF_FREE(queue);
+   -- now queue == NULL, RBUF_LEN(queue) == 0, RBUF_CAP(queue) == 0
+
+   -- To handle running out of memory:
+   bool ran_out_of_memory = !RBUF_TRYFIT(queue, 1000);
+   -- before PUSH_BACK or PUSH_FRONT. When out of memory, queue will stay unmodified.
+
+   PUBLIC DOMAIN (UNLICENSE)
+
+   This is free and unencumbered software released into the public domain.
+
+   Anyone is free to copy, modify, publish, use, compile, sell, or
+   distribute this software, either in source code form or as a compiled
+   binary, for any purpose, commercial or non-commercial, and by any
+   means.
+
+   In jurisdictions that recognize copyright laws, the author or authors
+   of this software dedicate any and all copyright interest in the
+   software to the public domain. We make this dedication for the benefit
+   of the public at large and to the detriment of our heirs and
+   successors. We intend this dedication to be an overt act of
+   relinquishment in perpetuity of all present and future rights to this
+   software under copyright law.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+   OTHER DEALINGS IN THE SOFTWARE.
+
+   For more information, please refer to <http://unlicense.org/>
+*/
+
+#ifndef TINYRBUF_H
+#define TINYRBUF_H
+
+#include "tinybuf.h"
+
+/* Query functions */
+#define RBUF_LEN(b) ((b) ? RBUF__HDR(b)->len : 0)
+#define RBUF_CAP(b) ((b) ? RBUF__HDR(b)->mask + 1 : 0)
+#define RBUF_AT(b, idx) ((b)[(RBUF__HDR(b)->head + (size_t)(idx)) & RBUF__HDR(b)->mask])
+#define RBUF_SPAN(b) ((b) ? (b) + RBUF__HDR(b)->head : (b))
+#define RBUF_SPANLEN(b) ((b) ? (RBUF__HDR(b)->len < RBUF__HDR(b)->mask + 1 - RBUF__HDR(b)->head ? RBUF__HDR(b)->len : RBUF__HDR(b)->mask + 1 - RBUF__HDR(b)->head) : 0)
+
+/* Modifying functions */
+#define RBUF_FREE(b)           ((b) ? (TINYBUF_FREE((void*)0, RBUF__HDR(b)), (*(void**)(&(b)) = (void*)0)) : 0)
+#define RBUF_FIT(b, n)         ((size_t)(n) <= RBUF_CAP(b) ? 0 : (*(void**)(&(b)) = rbuf__grow((b), (size_t)(n), sizeof(*(b)))))
+#define RBUF_PUSH_BACK(b, val) (RBUF_FIT((b), RBUF_LEN(b) + 1), (b)[(RBUF__HDR(b)->head + RBUF__HDR(b)->len++) & RBUF__HDR(b)->mask] = (val))
+#define RBUF_PUSH_FRONT(b, val) (RBUF_FIT((b), RBUF_LEN(b) + 1), RBUF__HDR(b)->len++, (b)[RBUF__HDR(b)->head = (RBUF__HDR(b)->head - 1) & RBUF__HDR(b)->mask] = (val))
+#define RBUF_POP_FRONT(b)      (RBUF__HDR(b)->len--, RBUF__HDR(b)->head = (RBUF__HDR(b)->head + 1) & RBUF__HDR(b)->mask, (b)[(RBUF__HDR(b)->head - 1) & RBUF__HDR(b)->mask])
+#define RBUF_POP_BACK(b)       ((b)[(RBUF__HDR(b)->head + --RBUF__HDR(b)->len) & RBUF__HDR(b)->mask])
+#define RBUF_DROP_FRONT(b, n)  ((b) ? (RBUF__HDR(b)->len -= (size_t)(n), RBUF__HDR(b)->head = (RBUF__HDR(b)->head + (size_t)(n)) & RBUF__HDR(b)->mask) : 0)
+#define RBUF_DROP_BACK(b, n)   ((b) ? RBUF__HDR(b)->len -= (size_t)(n) : 0)
+#define RBUF_CLEAR(b)          ((b) ? RBUF__HDR(b)->len = RBUF__HDR(b)->head = 0 : 0)
+#define RBUF_TRYFIT(b, n)      (RBUF_FIT((b), (n)), (RBUF_CAP(b) >= (size_t)(n) || !(n)))
+
+/* The header is followed by the slots, the elements are at head to head + len - 1 (masked) */
+struct rbuf__hdr { size_t len, mask, head, pad; /* pad keeps elements aligned to two size_t */ };
+#define RBUF__HDR(b) (((struct rbuf__hdr *)(void*)(b))-1)
+
+#ifdef __GNUC__
+__attribute__((__unused__))
+#elif defined(_MSC_VER)
+#pragma warning(push)
+#pragma warning(disable:4505) //unreferenced local function has been removed
+#endif
+static void *rbuf__grow(void *buf, size_t n, size_t elem_size)
+{
+	struct rbuf__hdr *hdr;
+	size_t cap = RBUF_CAP(buf), new_cap = (cap ? cap * 2 : 16), tail;
+	char *elems;
+	while (new_cap < n)
+		if (!(new_cap *= 2))
+			return buf; /* overflow, return unchanged */
+	if (new_cap > ((size_t)-1 - sizeof(struct rbuf__hdr)) / elem_size)
+		return buf; /* overflow, return unchanged */
+	if (!buf)
+	{
+		hdr = (struct rbuf__hdr *)TINYBUF_MALLOC((void*)0, sizeof(struct rbuf__hdr) + new_cap * elem_size);
+		if (!hdr)
+			return (void*)0; /* out of memory */
+		hdr->len = hdr->head = 0;
+		hdr->mask = new_cap - 1;
+		return hdr + 1;
+	}
+	hdr = (struct rbuf__hdr *)TINYBUF_REALLOC((void*)0, RBUF__HDR(buf), sizeof(struct rbuf__hdr) + cap * elem_size, sizeof(struct rbuf__hdr) + new_cap * elem_size);
+	if (!hdr)
+		return buf; /* out of memory, return unchanged */
+	elems = (char*)(hdr + 1);
+	if (hdr->head + hdr->len > cap)
+	{
+		/* the elements wrapped around the old end, move the shorter part so they are in a row again */
+		size_t wrapped = hdr->head + hdr->len - cap;
+		tail = cap - hdr->head;
+		if (wrapped <= tail)
+			memcpy(elems + cap * elem_size, elems, wrapped * elem_size);
+		else
+		{
+			memcpy(elems + (new_cap - tail) * elem_size, elems + hdr->head * elem_size, tail * elem_size);
+			hdr->head = new_cap - tail;
+		}
+	}
+	hdr->mask = new_cap - 1;
+	return hdr + 1;
+}
+#if defined(_MSC_VER)
+#pragma warning(pop)
+#endif
+
+#endif
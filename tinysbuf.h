@@ -0,0 +1,188 @@
+/* TinySBuf - segmented dynamic array - public domain - Bernhard Schelling 2020
+   https://github.com/schellingb/c-data-structures
+         no warranty implied; use at your own risk
+
+   This file implements a dynamic array which never moves its elements.
+   Elements are stored in chunks that double in size (16, 32, 64, ...)
+   and a small fixed directory points to the chunks. Growing allocates
+   a new chunk instead of reallocating, so pointers to elements stay
+   valid until the array is freed and nothing ever gets copied.
+
+   Looking up an element is O(1), the chunk is the position of the
+   highest set bit of (index + 16) which is a single instruction on
+   most CPUs. The array is a pointer to the typed chunk directory.
+   Memory comes from TINYBUF_MALLOC/TINYBUF_FREE of TinyBuf.
+
+   Be careful not to supply modifying statements to the macro arguments.
+   Something like SBUF_AT(buf, i++); would have unintended results.
+
+   Sample usage:
+
+   mytype_t** buf = NULL;
+   SBUF_PUSH(buf, some_element);
+   SBUF_PUSH(buf, other_element);
+   -- now SBUF_LEN(buf) == 2, SBUF_AT(buf, 0) == some_element, SBUF_AT(buf, 1) == other_element
+
+   -- Add an element at the end (uninitialized):
+   mytype_t* p_elem = SBUF_ADD(buf);
+   -- now SBUF_LEN(buf) == 3, p_elem == &SBUF_AT(buf, 2)
+   -- p_elem stays valid while more elements are added
+
+   -- Remove the last element:
+   mytype_t last = SBUF_POP(buf);
+   -- now SBUF_LEN(buf) == 2
+
+   -- Explicitly allocate chunks for at least N elements:
+   SBUF_FIT(buf, 100);
+   -- now SBUF_LEN(buf) == 2, SBUF_CAP(buf) == 112 (16 + 32 + 64)
+
+   -- Iterate elements:
+   for (size_t i = 0; i != SBUF_LEN(buf); i++)
+   ------ here SBUF_AT(buf, i) is element i
+
+   -- Remove all elements (keep memory allocated):
+   SBUF_CLEAR(buf);
+   -- now SBUF_LEN(buf) == 0, SBUF_CAP(buf) == 112
+
+   -- Free allocated memory:
+   SBUF_FREE(buf);
+   -- now buf == NULL, SBUF_LEN(buf) == 0, SBUF_CAP(buf) == 0
+
+   -- To handle running out of memory:
+   bool ran_out_of_memory = !SBUF_TRYFIT(buf, 1000);
+   -- before PUSH or ADD. When out of memory, buf will stay unmodified.
+
+   PUBLIC DOMAIN (UNLICENSE)
+
+   This is free and unencumbered software released into the public domain.
+
+   Anyone is free to copy, modify, publish, use, compile, sell, or
+   distribute this software, either in source code form or as a compiled
+   binary, for any purpose, commercial or non-commercial, and by any
+   means.
+
+   In jurisdictions that recognize copyright laws, the author or authors
+   of this software dedicate any and all copyright interest in the
+   software to the public domain. We make this dedication for the benefit
+   of the public at large and to the detriment of our heirs and
+   successors. We intend this dedication to be an overt act of
+   relinquishment in perpetuity of all present and future rights to this
+   software under copyright law.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+   OTHER DEALINGS IN THE SOFTWARE.
+
+   For more information, please refer to <http://unlicense.org/>
+*/
+
+#ifndef TINYSBUF_H
+#define TINYSBUF_H
+
+#include "tinybuf.h"
+#if !defined(__GNUC__) && defined(_MSC_VER)
+#include <intrin.h> /* for _BitScanReverse */
+#endif
+
+/* Query functions */
+#define SBUF_LEN(b) ((b) ? SBUF__HDR(b)->len : 0)
+#define SBUF_CAP(b) ((b) ? SBUF__CAPOF(SBUF__HDR(b)->chunks) : 0)
+#define SBUF_AT(b, idx) ((b)[sbuf__chunk(idx)][(size_t)(idx) + SBUF__FIRST - (SBUF__FIRST << sbuf__chunk(idx))])
+
+/* Modifying functions */
+#define SBUF_FREE(b)      ((b) ? (sbuf__free((void**)(b)), (*(void**)(&(b)) = (void*)0)) : 0)
+#define SBUF_FIT(b, n)    ((size_t)(n) <= SBUF_CAP(b) ? 0 : (*(void**)(&(b)) = sbuf__grow((void**)(b), (size_t)(n), sizeof(**(b)))))
+#define SBUF_PUSH(b, val) (SBUF_FIT((b), SBUF_LEN(b) + 1), SBUF__HDR(b)->len++, SBUF_AT((b), SBUF__HDR(b)->len - 1) = (val))
+#define SBUF_ADD(b)       (SBUF_FIT((b), SBUF_LEN(b) + 1), SBUF__HDR(b)->len++, &SBUF_AT((b), SBUF__HDR(b)->len - 1))
+#define SBUF_POP(b)       (SBUF__HDR(b)->len--, SBUF_AT((b), SBUF__HDR(b)->len))
+#define SBUF_CLEAR(b)     ((b) ? SBUF__HDR(b)->len = 0 : 0)
+#define SBUF_TRYFIT(b, n) (SBUF_FIT((b), (n)), (SBUF_CAP(b) >= (size_t)(n) || !(n)))
+
+/* The header is followed by a fixed directory of chunk pointers, chunk k holds SBUF__FIRST << k elements */
+struct sbuf__hdr { size_t len, chunks; };
+#define SBUF__HDR(b) (((struct sbuf__hdr *)(void*)(b))-1)
+#define SBUF__FIRST ((size_t)16)
+#define SBUF__MAXCHUNKS (sizeof(size_t) * 8 - 5)
+#define SBUF__CAPOF(chunks) ((SBUF__FIRST << (chunks)) - SBUF__FIRST)
+
+#ifdef __GNUC__
+__attribute__((__unused__))
+#elif defined(_MSC_VER)
+#pragma warning(push)
+#pragma warning(disable:4505) //unreferenced local function has been removed
+#endif
+static size_t sbuf__chunk(size_t idx)
+{
+	size_t v = idx + SBUF__FIRST;
+	#if defined(__GNUC__) && defined(__SIZEOF_SIZE_T__) && (__SIZEOF_SIZE_T__ == __SIZEOF_LONG__)
+	return (sizeof(unsigned long) * 8 - 1 - (size_t)__builtin_clzl((unsigned long)v)) - 4;
+	#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+	unsigned long bit;
+	_BitScanReverse64(&bit, (unsigned __int64)v);
+	return (size_t)bit - 4;
+	#elif defined(_MSC_VER)
+	unsigned long bit;
+	_BitScanReverse(&bit, (unsigned long)v);
+	return (size_t)bit - 4;
+	#else
+	size_t bit = 0;
+	while (v >>= 1) bit++;
+	return bit - 4;
+	#endif
+}
+
+#ifdef __GNUC__
+__attribute__((__unused__))
+#endif
+static void *sbuf__grow(void **buf, size_t n, size_t elem_size)
+{
+	struct sbuf__hdr *hdr;
+	size_t start;
+	if (!buf)
+	{
+		hdr = (struct sbuf__hdr *)TINYBUF_MALLOC((void*)0, sizeof(struct sbuf__hdr) + SBUF__MAXCHUNKS * sizeof(void*));
+		if (!hdr)
+			return (void*)0; /* out of memory */
+		hdr->len = hdr->chunks = 0;
+		buf = (void**)(hdr + 1);
+	}
+	hdr = SBUF__HDR(buf);
+	start = hdr->chunks;
+	while (SBUF__CAPOF(hdr->chunks) < n)
+	{
+		/* existing chunks are never touched so all elements keep their address */
+		size_t count = SBUF__FIRST << hdr->chunks;
+		if (hdr->chunks == SBUF__MAXCHUNKS || count > (size_t)-1 / elem_size || (buf[hdr->chunks] = TINYBUF_MALLOC((void*)0, count * elem_size)) == (void*)0)
+		{
+			/* out of memory, free the chunks added here and return unchanged */
+			while (hdr->chunks != start)
+				TINYBUF_FREE((void*)0, buf[--hdr->chunks]);
+			if (start)
+				return buf;
+			TINYBUF_FREE((void*)0, hdr);
+			return (void*)0;
+		}
+		hdr->chunks++;
+	}
+	return buf;
+}
+
+#ifdef __GNUC__
+__attribute__((__unused__))
+#endif
+static void sbuf__free(void **buf)
+{
+	size_t k;
+	for (k = 0; k != SBUF__HDR(buf)->chunks; k++)
+		TINYBUF_FREE((void*)0, buf[k]);
+	TINYBUF_FREE((void*)0, SBUF__HDR(buf));
+}
+#if defined(_MSC_VER)
+#pragma warning(pop)
+#endif
+
+#endif
@@ -0,0 +1,238 @@
+/* TinySort - radix sort and sorted search for TinyBuf - public domain - Bernhard Schelling 2020
+   https://github.com/schellingb/c-data-structures
+         no warranty implied; use at your own risk
+
+   This file implements sorting buffers of unsigned 32-bit or 64-bit
+   integer keys (or of structs by such a member) with an LSD radix sort,
+   which needs no comparison function and is many times faster than
+   qsort for large buffers. Keys are sorted one byte at a time from the
+   lowest byte, bytes that are the same in all keys are skipped.
+   Sorting is stable (elements with the same key keep their order).
+   A temporary copy of the elements is made with TINYBUF_MALLOC of the
+   allocator of the buffer (see TinyBuf), small buffers are sorted with
+   an insertion sort instead.
+
+   A sorted buffer can then be searched with a binary search that
+   compiles to conditional moves instead of branches, which is a
+   compact alternative to a hash map for data that is read much more
+   often than it is changed.
+
+   Be careful not to supply modifying statements to the macro arguments.
+   Something like BUF_LOWER_BOUND(buf, keys[i++]); would have unintended results.
+
+   Sample usage:
+
+   uint32_t* buf = NULL;
+   BUF_PUSH(buf, 30);
+   BUF_PUSH(buf, 10);
+   BUF_PUSH(buf, 20);
+   BUF_SORT_U32(buf);
+   -- now buf[0] == 10, buf[1] == 20, buf[2] == 30
+   -- BUF_SORT_U64 does the same for a buffer of uint64_t
+
+   -- Sort structs by a uint32_t or uint64_t member:
+   typedef struct { uint64_t id; float score; } entry_t;
+   entry_t* entries = ...;
+   BUF_SORT_BY(entries, id);
+   -- Members of other sizes don't compile, signed members would sort in
+   -- unsigned order (add 0x80000000 or 0x8000000000000000 to keep them)
+
+   -- To handle running out of memory:
+   bool ran_out_of_memory = !BUF_SORT_U32(buf);
+   -- When out of memory for the temporary copy, buf stays unmodified
+
+   -- Find the position of the first element not less than a key:
+   size_t i = BUF_LOWER_BOUND(buf, 15);
+   -- now i == 1, i is BUF_LEN(buf) if all elements are less than the key
+   bool found = (i != BUF_LEN(buf) && buf[i] == 15);
+   -- With a buffer of structs sorted by a member:
+   size_t j = BUF_LOWER_BOUND_BY(entries, id, 12345);
+
+   PUBLIC DOMAIN (UNLICENSE)
+
+   This is free and unencumbered software released into the public domain.
+
+   Anyone is free to copy, modify, publish, use, compile, sell, or
+   distribute this software, either in source code form or as a compiled
+   binary, for any purpose, commercial or non-commercial, and by any
+   means.
+
+   In jurisdictions that recognize copyright laws, the author or authors
+   of this software dedicate any and all copyright interest in the
+   software to the public domain. We make this dedication for the benefit
+   of the public at large and to the detriment of our heirs and
+   successors. We intend this dedication to be an overt act of
+   relinquishment in perpetuity of all present and future rights to this
+   software under copyright law.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+   OTHER DEALINGS IN THE SOFTWARE.
+
+   For more information, please refer to <http://unlicense.org/>
+*/
+
+#ifndef TINYSORT_H
+#define TINYSORT_H
+
+#include "tinybuf.h"
+#if defined(_MSC_VER) && (_MSC_VER < 1600)
+typedef unsigned __int32 uint32_t;
+typedef unsigned __int64 uint64_t;
+#else
+#include <stdint.h> /* for uint32_t, uint64_t */
+#endif
+
+#define BUF_SORT_U32(b)   (BUF_LEN(b) > 1 ? buf__radixsort((0 ? (uint32_t*)0 : (b)), BUF_LEN(b), sizeof(*(b)), 0, 4) : 1)
+#define BUF_SORT_U64(b)   (BUF_LEN(b) > 1 ? buf__radixsort((0 ? (uint64_t*)0 : (b)), BUF_LEN(b), sizeof(*(b)), 0, 8) : 1)
+#define BUF_SORT_BY(b, member) (BUF_LEN(b) > 1 ? buf__radixsort((b), BUF_LEN(b), sizeof(*(b)), BUF__OFS(b, member), BUF__KEYBYTES(sizeof((b)->member))) : 1)
+#define BUF_LOWER_BOUND(b, key) ((b) ? buf__lowerbound((b), BUF_LEN(b), sizeof(*(b)), 0, BUF__KEYBYTES(sizeof(*(b))), (uint64_t)(key)) : 0)
+#define BUF_LOWER_BOUND_BY(b, member, key) ((b) ? buf__lowerbound((b), BUF_LEN(b), sizeof(*(b)), BUF__OFS(b, member), BUF__KEYBYTES(sizeof((b)->member)), (uint64_t)(key)) : 0)
+
+#define BUF__OFS(b, member) ((size_t)((char*)&(b)->member - (char*)(b)))
+#define BUF__KEYBYTES(size) (sizeof(char[((size) == 4 || (size) == 8) ? 1 : -1]) * (size)) /* fails to compile for keys other than 4 or 8 bytes */
+#define BUF__SMALLSORT 32 /* buffers up to this length get sorted with an insertion sort */
+#define BUF__COPY(dst, src, size) ((size) == 4 ? memcpy((dst), (src), 4) : (size) == 8 ? memcpy((dst), (src), 8) : (size) == 16 ? memcpy((dst), (src), 16) : memcpy((dst), (src), (size)))
+
+#if defined(_MSC_VER)
+#pragma warning(push)
+#pragma warning(disable:4505) //unreferenced local function has been removed
+#endif
+
+/* Reads a key of key_bytes (4 or 8) bytes which can be unaligned */
+#ifdef __GNUC__
+__attribute__((__unused__))
+#endif
+static uint64_t buf__key(const char *p, size_t key_bytes)
+{
+	uint32_t k32;
+	uint64_t k64;
+	if (key_bytes == 4)
+		return (memcpy(&k32, p, 4), k32);
+	return (memcpy(&k64, p, 8), k64);
+}
+
+/* Sorts small buffers by moving each element down past all elements with a larger key */
+#ifdef __GNUC__
+__attribute__((__unused__))
+#endif
+static void buf__insertionsort(char *elems, size_t n, size_t elem_size, size_t key_ofs, size_t key_bytes)
+{
+	char tmp[64];
+	size_t i, j;
+	uint64_t key;
+	for (i = 1; i < n; i++)
+	{
+		key = buf__key(elems + i * elem_size + key_ofs, key_bytes);
+		for (j = i; j && buf__key(elems + (j - 1) * elem_size + key_ofs, key_bytes) > key; j--) {}
+		if (j == i)
+			continue;
+		memcpy(tmp, elems + i * elem_size, elem_size);
+		memmove(elems + (j + 1) * elem_size, elems + j * elem_size, (i - j) * elem_size);
+		memcpy(elems + j * elem_size, tmp, elem_size);
+	}
+}
+
+/* Sorts n elements by their key at key_ofs with one counting pass per byte of the key, returns 0 when out of memory */
+#ifdef __GNUC__
+__attribute__((__unused__))
+#endif
+static int buf__radixsort(void *buf, size_t n, size_t elem_size, size_t key_ofs, size_t key_bytes)
+{
+	size_t counts[8][256], i, d, sum, passes = 0;
+	char *src = (char*)buf, *dst, *tmp, *p;
+	uint64_t key, first;
+	if (n <= BUF__SMALLSORT && elem_size <= 64)
+	{
+		buf__insertionsort(src, n, elem_size, key_ofs, key_bytes);
+		return 1;
+	}
+
+	/* count the values of every byte of the keys in one pass */
+	memset(counts, 0, sizeof(counts));
+	if (key_bytes == 4)
+		for (p = src + key_ofs, i = 0; i != n; i++, p += elem_size)
+		{
+			key = buf__key(p, 4);
+			counts[0][key & 0xFF]++; counts[1][(key >> 8) & 0xFF]++; counts[2][(key >> 16) & 0xFF]++; counts[3][key >> 24]++;
+		}
+	else
+		for (p = src + key_ofs, i = 0; i != n; i++, p += elem_size)
+			for (key = buf__key(p, 8), d = 0; d != 8; d++, key >>= 8)
+				counts[d][key & 0xFF]++;
+
+	/* bytes that are the same in all keys don't need a pass */
+	first = buf__key(src + key_ofs, key_bytes);
+	for (d = 0; d != key_bytes; d++)
+		if (counts[d][(first >> (d * 8)) & 0xFF] != n)
+			passes++;
+	if (!passes)
+		return 1;
+	tmp = (char*)TINYBUF_MALLOC(BUF__CTX(buf), n * elem_size);
+	if (!tmp)
+		return 0; /* out of memory, buf stays unmodified */
+
+	for (dst = tmp, d = 0; d != key_bytes; d++)
+	{
+		size_t *pos = counts[d];
+		if (pos[(first >> (d * 8)) & 0xFF] == n)
+			continue;
+		for (sum = 0, i = 0; i != 256; i++)
+		{
+			size_t c = pos[i];
+			pos[i] = sum;
+			sum += c;
+		}
+		for (p = src, i = 0; i != n; i++, p += elem_size)
+			BUF__COPY(dst + pos[(buf__key(p + key_ofs, key_bytes) >> (d * 8)) & 0xFF]++ * elem_size, p, elem_size);
+		p = src, src = dst, dst = p;
+	}
+	if (src != (char*)buf)
+		memcpy(buf, src, n * elem_size);
+	TINYBUF_FREE(BUF__CTX(buf), tmp);
+	return 1;
+}
+
+/* Returns the first of n sorted elements whose key at key_ofs is not less than key (or n), halving the range without branching */
+#ifdef __GNUC__
+__attribute__((__unused__))
+#endif
+static size_t buf__lowerbound(const void *buf, size_t n, size_t elem_size, size_t key_ofs, size_t key_bytes, uint64_t key)
+{
+	const char *p = (const char*)buf + key_ofs;
+	size_t lo = 0, half;
+	if (key_bytes == 4)
+	{
+		uint32_t k32 = (uint32_t)key, e;
+		if (key > 0xFFFFFFFF)
+			return n;
+		for (; n > 1; n -= half)
+		{
+			half = n / 2;
+			memcpy(&e, p + (lo + half) * elem_size, 4);
+			lo = (e < k32 ? lo + half : lo);
+		}
+		return (n ? (memcpy(&e, p + lo * elem_size, 4), lo + (e < k32)) : lo);
+	}
+	else
+	{
+		uint64_t e;
+		for (; n > 1; n -= half)
+		{
+			half = n / 2;
+			memcpy(&e, p + (lo + half) * elem_size, 8);
+			lo = (e < key ? lo + half : lo);
+		}
+		return (n ? (memcpy(&e, p + lo * elem_size, 8), lo + (e < key)) : lo);
+	}
+}
+
+#if defined(_MSC_VER)
+#pragma warning(pop)
+#endif
+
+#endif